@@ -0,0 +1,293 @@
+// Benchmark the time and register writes for the library methods.
+//
+// Example program for the MD_YM2413 library.
+//
+// Each method is called a number of times and the results are printed
+// on the Serial Monitor as
+// - the average time for each call in microseconds. On AVR boards each
+//   call is also timed in CPU clock cycles using Timer1, which gives cycle
+//   exact numbers (apart from the millis() interrupt) for comparing changes.
+// - the average register writes (data) and address writes for each call,
+//   counted using the register write hook.
+// - the bus time, which is the least time the YM2413 needs to latch the
+//   address and data writes. The library only waits for the part of this
+//   time that has not been used by the digitalWrite() calls and the library
+//   processing since the last write.
+//
+// The register writes for each method are fixed by the library code, so
+// they are checked against the expected number and the method is flagged
+// FAIL if there are more. This allows changes to the library to be
+// checked for extra writes before they are used in applications.
+//
+// The sustained write rate is also measured, for writes to changing and
+// to the same register, and checked against the most writes per second
+// allowed by the YM2413 datasheet minimum waits of 12 master clock cycles
+// after an address write and 84 cycles after a data write, at the CLOCK_HZ
+// master clock. A rate higher than the datasheet allows is a FAIL. The same
+// writes are also timed with the fixed 4us and 25us waits the library used
+// before its waits were paced by the time since the last write, which gives
+// the before and after rates for this board.
+//
+// The flash and static RAM used by the library are shown by the IDE when
+// the sketch is compiled. The free RAM at run time is printed on AVR boards.
+//
+// The YM2413 does not need to be connected to run this sketch.
+//
+
+#include <MD_YM2413.h>
+
+// Hardware Definitions ---------------
+// All the pins directly connected to D0-D7 on the IC, in sequential order
+// so that pin D_PIN[0] is connected to D0, D_PIN[1] to D1, etc.
+const uint8_t D_PIN[] = { 8, 9, 7, 6, A0, A1, A2, A3 };
+const uint8_t WE_PIN = 5;     // Arduino pin connected to the IC WE pin
+const uint8_t A0_PIN = 4;     // Arduino pin connected to the A0 pin
+
+// Datasheet minimum waits in master clock cycles
+const uint8_t CYCLES_ADDR = 12;   // after an address write
+const uint8_t CYCLES_DATA = 84;   // after a data write
+
+const uint16_t CALLS = 100;       // number of calls timed for each method
+const uint16_t WRITES = 1000;     // number of writes timed for the write rate
+
+// Global Data ------------------------
+MD_YM2413 S(D_PIN, WE_PIN, A0_PIN);
+
+uint32_t countData = 0;     // data writes counted by the hook
+uint32_t countAddr = 0;     // address writes counted by the hook
+uint8_t lastAddr = 0xff;    // last address written, as the library only writes an address when it changes
+bool fail = false;          // true if any method failed its check
+
+// Code -------------------------------
+void countWrite(uint8_t addr, uint8_t data)
+// Register write hook to count the writes
+{
+  if (addr != lastAddr) countAddr++;
+  lastAddr = addr;
+  countData++;
+}
+
+// Methods to benchmark, called with the call number
+void bWrite(uint16_t i)     { S.write(0x10, i & 0xff); }
+void bNoteOnF(uint16_t i)   { S.noteOn(i % 6, (uint16_t)(220 + i), MD_YM2413::VOL_MAX); }
+void bNoteOnN(uint16_t i)   { S.noteOn(i % 6, (uint8_t)4, (uint8_t)(i % 12), MD_YM2413::VOL_MAX); }
+void bNoteOff(uint16_t i)   { S.noteOff(i % 6); }
+void bBend(uint16_t i)      { S.bendNote(0, (i & 0x3f) << 2); }
+void bVolume(uint16_t i)    { S.setVolume(i % 6, i & 0xf); }
+void bVolumeAll(uint16_t i) { S.setVolume(i & 0xf); }
+void bPercussion(uint16_t i){ S.setPercussion(i & 1); }
+void bRunIdle(uint16_t i)   { S.run(); }
+void bRunNotes(uint16_t i)  { S.run(); }
+
+// Full register image 0x00-0x38 for the block writes, with all 9
+// channels keyed on and the custom instrument loaded.
+uint8_t state[0x39] =
+{
+  0x61, 0x61, 0x1e, 0x17, 0xf0, 0x7f, 0x00, 0x17,       // 0x00 custom instrument
+  0, 0, 0, 0, 0, 0, 0x00, 0x00,                         // 0x08 rhythm and test
+  0xac, 0xb7, 0xc1, 0xcd, 0xd9, 0xe6, 0xf3, 0x02, 0x11, // 0x10 F-Num
+  0, 0, 0, 0, 0, 0, 0,
+  0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x19, 0x19, // 0x20 block and key on
+  0, 0, 0, 0, 0, 0, 0,
+  0x00, 0x10, 0x30, 0x40, 0x50, 0x60, 0x70, 0x80, 0x90, // 0x30 instrument and volume
+};
+
+void bBlock(uint16_t i)     { S.writeBlock(0x00, state, sizeof(state)); }
+void bBlockOpt(uint16_t i)  { S.writeBlock(0x00, state, sizeof(state), true); }
+
+// Untimed set up before a method call
+void pNoteEnd(uint16_t i)   { S.noteOn(0, (uint8_t)4, (uint8_t)0, MD_YM2413::VOL_MAX, 1); delay(2); }
+
+#ifdef __AVR__
+void timerStart(void)
+// Set Timer1 to count CPU clock cycles
+{
+  TCCR1A = 0;
+  TCCR1B = _BV(CS10);   // no prescaler
+}
+
+inline void timerReset(void) { TCNT1 = 0; }
+inline uint16_t timerRead(void) { return(TCNT1); }
+
+int freeRAM(void)
+// Space between the heap and the stack
+{
+  extern int __heap_start, *__brkval;
+  int v;
+
+  return((int)&v - (__brkval == 0 ? (int)&__heap_start : (int)__brkval));
+}
+#endif
+
+void bench(const __FlashStringHelper* name, void (*f)(uint16_t), uint16_t maxWrites, void (*prep)(uint16_t) = nullptr)
+// Time the method with the hook off, then count the writes with the hook on.
+// The prep function is called before each method call and is not timed.
+// The maxWrites value is the expected data writes for each call x 10.
+{
+  uint32_t t = 0, bus, writes;
+#ifdef __AVR__
+  uint32_t cycles = 0;
+#endif
+
+  S.setPercussion(true);
+  S.setWriteHook(nullptr);
+  for (uint16_t i = 0; i < CALLS; i++)
+  {
+    uint32_t tStart;
+
+    if (prep != nullptr) prep(i);
+#ifdef __AVR__
+    timerReset();
+#endif
+    tStart = micros();
+    f(i);
+#ifdef __AVR__
+    cycles += timerRead();
+#endif
+    t += micros() - tStart;
+  }
+
+  S.setPercussion(true);
+  countData = countAddr = 0;
+  lastAddr = 0xff;
+  for (uint16_t i = 0; i < CALLS; i++)
+  {
+    if (prep != nullptr) prep(i);
+    S.setWriteHook(countWrite);
+    f(i);
+    S.setWriteHook(nullptr);
+  }
+
+  // print in tenths per call
+  writes = (countData * 10) / CALLS;
+  bus = (((countAddr * CYCLES_ADDR) + (countData * CYCLES_DATA)) * 1000UL) / (CLOCK_HZ / 1000) / CALLS;
+
+  Serial.print(F("\n"));
+  Serial.print(name);
+  Serial.print(F("\t"));
+  Serial.print(t / CALLS);
+  Serial.print(F("\t"));
+#ifdef __AVR__
+  Serial.print(cycles / CALLS);
+  Serial.print(F("\t"));
+#endif
+  Serial.print(writes / 10);
+  Serial.print(F("."));
+  Serial.print(writes % 10);
+  Serial.print(F("\t"));
+  Serial.print(countAddr / CALLS);
+  Serial.print(F("\t"));
+  Serial.print(bus);
+  Serial.print(F("\t"));
+  if (writes > maxWrites)
+  {
+    Serial.print(F("FAIL"));
+    fail = true;
+  }
+  else
+    Serial.print(F("ok"));
+}
+
+uint8_t fixedAddr = 0xff;   // last address written by fixedWrite()
+
+void fixedWrite(uint8_t addr, uint8_t data)
+// Register write with the fixed waits in each strobe (4us after an 
+// address and 25us after data, with WE held LOW) that the library used
+// before the waits were paced.
+{
+  if (fixedAddr != addr)
+  {
+    digitalWrite(A0_PIN, LOW);
+    for (uint8_t i = 0; i < 8; i++)
+      digitalWrite(D_PIN[i], (addr & (1 << i)) ? HIGH : LOW);
+    digitalWrite(WE_PIN, LOW);
+    delayMicroseconds(4);
+    digitalWrite(WE_PIN, HIGH);
+    fixedAddr = addr;
+  }
+
+  digitalWrite(A0_PIN, HIGH);
+  for (uint8_t i = 0; i < 8; i++)
+    digitalWrite(D_PIN[i], (data & (1 << i)) ? HIGH : LOW);
+  digitalWrite(WE_PIN, LOW);
+  delayMicroseconds(25);
+  digitalWrite(WE_PIN, HIGH);
+}
+
+void writeRate(const __FlashStringHelper* name, uint8_t addrCount, uint8_t cycles)
+// Time a run of writes to addrCount different registers and check the
+// rate against the datasheet maximum for the bus cycles for each write.
+// The rate with the old fixed waits is shown for comparison.
+{
+  uint32_t t, rate, rateFixed, rateMax = CLOCK_HZ / cycles;
+
+  t = micros();
+  for (uint16_t i = 0; i < WRITES; i++)
+    S.write(0x10 + (i % addrCount), i & 0xff);
+  t = micros() - t;
+  rate = (WRITES * 1000000UL) / t;
+
+  fixedAddr = 0xff;
+  t = micros();
+  for (uint16_t i = 0; i < WRITES; i++)
+    fixedWrite(0x10 + (i % addrCount), i & 0xff);
+  t = micros() - t;
+  rateFixed = (WRITES * 1000000UL) / t;
+
+  Serial.print(F("\n"));
+  Serial.print(name);
+  Serial.print(F("\t"));
+  Serial.print(rate);
+  Serial.print(F(" writes/s, fixed waits "));
+  Serial.print(rateFixed);
+  Serial.print(F(", datasheet maximum "));
+  Serial.print(rateMax);
+  Serial.print(F("\t"));
+  if (rate > rateMax)
+  {
+    Serial.print(F("FAIL"));
+    fail = true;
+  }
+  else
+    Serial.print(F("ok"));
+}
+
+void setup(void)
+{
+  Serial.begin(57600);
+  Serial.print(F("\n[MD_YM2413 Benchmark]"));
+
+  S.begin();
+
+  Serial.print(F("\n\nClock "));
+  Serial.print(CLOCK_HZ);
+  Serial.print(F("Hz"));
+  writeRate(F("Changing register"), 9, CYCLES_ADDR + CYCLES_DATA);
+  writeRate(F("Same register"), 1, CYCLES_DATA);
+#ifdef __AVR__
+  Serial.print(F("\nFree RAM "));
+  Serial.print(freeRAM());
+
+  timerStart();
+  Serial.print(F("\n\nMethod\t\tus/call\tcycles\twrites\taddr\tbus us\tcheck"));
+#else
+  Serial.print(F("\n\nMethod\t\tus/call\twrites\taddr\tbus us\tcheck"));
+#endif
+
+  bench(F("write()\t"), bWrite, 10);
+  bench(F("noteOn(freq)"), bNoteOnF, 30);
+  bench(F("noteOn(note)"), bNoteOnN, 30);
+  bench(F("noteOff()"), bNoteOff, 20);
+  bench(F("bendNote()"), bBend, 20);
+  bench(F("setVolume(ch)"), bVolume, 10);
+  bench(F("setVolume()"), bVolumeAll, 110);
+  bench(F("setPercussion()"), bPercussion, 85);
+  bench(F("run() idle"), bRunIdle, 0);
+  bench(F("run() notes"), bRunNotes, 20, pNoteEnd);
+  bench(F("writeBlock()"), bBlock, 570);
+  bench(F("writeBlock(opt)"), bBlockOpt, 370);
+
+  Serial.print(fail ? F("\n\nFAILED") : F("\n\nPASSED"));
+}
+
+void loop(void) {}
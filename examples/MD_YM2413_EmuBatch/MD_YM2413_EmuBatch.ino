@@ -0,0 +1,105 @@
+// Render a batch of software YM2413s, each playing its own clip.
+//
+// Example program for the MD_YM2413 library.
+//
+// Each MD_YM2413_Emu object in the batch is fed from its own stream of
+// register writes by the event callback. Here each stream is a short
+// arpeggio on a different instrument, starting on a different note, but
+// it could equally be read from a VGM file or a MIDI sequence for each
+// object. The objects are rendered in step and mixed into one output.
+//
+// The batch is rendered for 1 to BATCH_MAX objects until all the clips
+// have finished. For each batch size the Serial Monitor shows the time to
+// render the batch and the throughput in chip-seconds per second (the
+// seconds of audio rendered for all the objects in one second). This is
+// the number of YM2413s that could play in real time on the board.
+//
+// The synthesizer uses 32 bit integer arithmetic, so this is meant for
+// 32 bit MCUs. On dual core MCUs, a batch object can be run on each core
+// with its own set of MD_YM2413_Emu objects.
+//
+
+#include <MD_YM2413.h>
+#include <MD_YM2413_Emu.h>
+#include <MD_YM2413_EmuBatch.h>
+
+// Global Data ------------------------
+const uint16_t BLOCK_SIZE = 64;       // samples rendered in each block
+const uint8_t NOTES = 12;             // notes in each clip
+const uint16_t NOTE_ON = 4000;        // note on time in samples
+const uint16_t NOTE_OFF = 2000;       // time between notes in samples
+
+MD_YM2413_Emu E[MD_YM2413_EmuBatch::BATCH_MAX];
+
+int16_t buf[BLOCK_SIZE];
+uint8_t step[MD_YM2413_EmuBatch::BATCH_MAX];    // position in each event stream
+
+// Code -------------------------------
+uint16_t nextEvent(uint8_t inst, MD_YM2413_Emu& emu)
+// Event stream for each object, an arpeggio on channel 0 using its own
+// instrument. The writes are the same as MD_YM2413 would make.
+{
+  const uint16_t fnum[] = { 172, 217, 258 };   // C, E and G F-Num for block 4
+  uint8_t s = step[inst]++;
+  uint8_t n, block;
+
+  if (s == 0)   // instrument and volume
+    emu.write(0x30, ((inst % 15) + 1) << 4);
+
+  if (s >= NOTES * 2)
+    return(MD_YM2413_EmuBatch::END);
+
+  n = (s / 2) + inst;
+  block = 3 + ((n / ARRAY_SIZE(fnum)) % 3);
+  if (s & 1)    // key off
+  {
+    emu.write(0x20, block << 1);
+    return(NOTE_OFF);
+  }
+
+  // key on
+  n = n % ARRAY_SIZE(fnum);
+  emu.write(0x10, fnum[n] & 0xff);
+  emu.write(0x20, 0x10 | (block << 1) | (fnum[n] >> 8));
+  return(NOTE_ON);
+}
+
+void setup(void)
+{
+  Serial.begin(57600);
+  Serial.print(F("\n[MD_YM2413 Emulator Batch]"));
+  Serial.print(F("\n\nChips\tclip s\trender ms\tchip-s/s"));
+
+  for (uint8_t count = 1; count <= MD_YM2413_EmuBatch::BATCH_MAX; count++)
+  {
+    MD_YM2413_EmuBatch B(E, count, nextEvent);
+    uint32_t t, clip, rate;
+
+    memset(step, 0, sizeof(step));
+    B.begin();
+
+    t = micros();
+    while (!B.isDone())
+      B.mix(buf, BLOCK_SIZE);
+    t = micros() - t;
+
+    clip = (B.getTime() * 100UL) / E[0].getSampleRate();   // hundredths of a second
+
+    Serial.print(F("\n"));
+    Serial.print(count);
+    Serial.print(F("\t"));
+    Serial.print(clip / 100);
+    Serial.print(F("."));
+    if (clip % 100 < 10) Serial.print(F("0"));
+    Serial.print(clip % 100);
+    Serial.print(F("\t"));
+    Serial.print(t / 1000);
+    Serial.print(F("\t\t"));
+    rate = (count * clip * 1000UL) / ((t / 100) + 1);     // tenths
+    Serial.print(rate / 10);
+    Serial.print(F("."));
+    Serial.print(rate % 10);
+  }
+}
+
+void loop(void) {}
@@ -0,0 +1,232 @@
+// Benchmark the software YM2413 rendering the VGM files on the SD card.
+//
+// Example program for the MD_YM2413 library.
+//
+// Each VGM file in the VGM_FOLDER folder on the SD card (for example, the
+// files from the VGM Player example VGM_TUNES folder) is played on the
+// software YM2413 as fast as it can be rendered. The register writes are
+// sent directly to the MD_YM2413_Emu object and the VGM waits are rendered
+// as samples, so the time measured is the render time only.
+//
+// For each file the Serial Monitor shows
+// - the length of the tune in seconds.
+// - the time to render the tune in ms and how many times faster than real
+//   time this is. This must be well over 1 for the tune to play on the board.
+// - the average number of active channels. Silent channels are skipped
+//   when rendering (see EMU_SKIP_IDLE in the library documentation).
+// - a hash (32 bit FNV-1a) of all the samples rendered for the tune.
+//
+// Compile the library with EMU_SKIP_IDLE set to 0 and run this again to see
+// the time saved by skipping the silent channels. The hash for each file
+// must be the same both times, as the samples are the same. The hash is
+// the same one shown by the host build YM2413_EmuBench, so the samples
+// on the board can also be checked against those on the host.
+//
+// Dependencies
+// SDFat at https://github.com/greiman?tab=repositories
+//
+// VGM file format at https://vgmrips.net/wiki/VGM_Specification
+//
+
+#include <SdFat.h>
+#include <MD_YM2413.h>
+#include <MD_YM2413_Emu.h>
+
+// Hardware Definitions ---------------
+// SD chip select pin for SPI comms.
+const uint8_t SD_SELECT = 10;
+
+// Miscellaneous
+const char VGM_FOLDER[] = "/VGM_TUNES";     // folder with the VGM files
+const uint32_t VGM_SAMPLE_RATE = 44100;     // VGM wait commands are in 44100 samples/sec
+const uint16_t BLOCK_SIZE = 64;             // samples rendered in each block
+
+// Global Data ------------------------
+SdFat SD;
+SdFile FD;    // file descriptor
+MD_YM2413_Emu E;
+
+int16_t buf[BLOCK_SIZE];
+
+uint32_t vgmSamples;    // VGM samples waited since the start of the tune
+uint32_t emuSamples;    // emulator samples rendered since the start of the tune
+uint32_t renderTime;    // us spent rendering
+uint32_t activeSum;     // active channels for each block rendered
+uint32_t blockCount;    // blocks rendered
+uint32_t hash;          // FNV-1a hash of the samples
+
+// Code -------------------------------
+void waitVGM(uint32_t samples)
+// Render the emulator samples up to the end of the wait
+{
+  uint32_t target;
+
+  vgmSamples += samples;
+  target = ((uint64_t)vgmSamples * E.getSampleRate()) / VGM_SAMPLE_RATE;
+
+  while (emuSamples < target)
+  {
+    uint16_t count = (target - emuSamples > BLOCK_SIZE) ? BLOCK_SIZE : target - emuSamples;
+    uint8_t active = 0;
+    uint32_t t = micros();
+
+    E.render(buf, count);
+    renderTime += micros() - t;
+    emuSamples += count;
+
+    for (uint16_t i = 0; i < count; i++)   // low byte first
+    {
+      hash = (hash ^ (uint8_t)buf[i]) * 16777619UL;
+      hash = (hash ^ (uint8_t)((uint16_t)buf[i] >> 8)) * 16777619UL;
+    }
+
+    for (uint16_t ch = E.getActive(); ch != 0; ch >>= 1)
+      active += ch & 1;
+    activeSum += active;
+    blockCount++;
+  }
+}
+
+uint32_t readVGMDword(uint16_t fileOffset)
+// Little endian 32 bit value from the file
+{
+  uint32_t result = 0;
+
+  FD.seekSet(fileOffset);
+  for (uint8_t i = 0; i < 4; i++)
+    result |= (uint32_t)(FD.read() & 0xff) << (i * 8);
+
+  return(result);
+}
+
+bool playVGM(void)
+// Play the open file from the start to the end of the data.
+// Loops are not repeated.
+{
+  uint32_t version, offset;
+  int cmd;
+
+  if (readVGMDword(0x00) != 0x206d6756) // " mgV"
+    return(false);
+  if ((readVGMDword(0x10) & 0x3fffffff) == 0)   // no YM2413
+    return(false);
+
+  version = readVGMDword(0x08);
+  offset = (version < 0x150) ? 0x40 : readVGMDword(0x34) + 0x34;
+  FD.seekSet(offset);
+
+  E.begin();
+  vgmSamples = emuSamples = 0;
+  renderTime = activeSum = blockCount = 0;
+  hash = 2166136261UL;
+
+  while ((cmd = FD.read()) != -1 && cmd != 0x66)
+  {
+    switch (cmd)
+    {
+      case 0x51: // 0x51 aa dd : YM2413, write value dd to register aa
+        {
+          uint8_t aa = FD.read();
+          uint8_t dd = FD.read();
+          E.write(aa, dd);
+        }
+        break;
+
+      case 0x61: // 0x61 nn nn : Wait n samples
+        {
+          uint16_t samples = FD.read() & 0x00FF;
+          samples |= (FD.read() << 8) & 0xFF00;
+          waitVGM(samples);
+        }
+        break;
+
+      case 0x62: waitVGM(735); break;   // wait 735 samples (60th of a second)
+      case 0x63: waitVGM(882); break;   // wait 882 samples (50th of a second)
+      case 0x70 ... 0x7f: waitVGM((cmd & 0x0f) + 1); break;
+      case 0x80 ... 0x8f: waitVGM(cmd & 0x0f); break;
+
+      case 0x67: // 0x67 0x66 tt ss ss ss ss : data block, skip it
+        {
+          uint32_t size;
+
+          FD.read();  // 0x66
+          FD.read();  // data type
+          size = FD.read() & 0xff;
+          size |= ((uint32_t)(FD.read() & 0xff) << 8);
+          size |= ((uint32_t)(FD.read() & 0xff) << 16);
+          size |= ((uint32_t)(FD.read() & 0xff) << 24);
+          FD.seekCur(size);
+        }
+        break;
+
+      // Commands for other chips (and the second YM2413) are skipped by their operand size
+      case 0x30 ... 0x3f: case 0x4f: case 0x50: FD.seekCur(1); break;
+      case 0x40 ... 0x4e: case 0x52 ... 0x5f: case 0xa0 ... 0xbf: FD.seekCur(2); break;
+      case 0xc0 ... 0xdf: FD.seekCur(3); break;
+      case 0xe0 ... 0xff: FD.seekCur(4); break;
+
+      default: break;
+    }
+  }
+
+  return(true);
+}
+
+void setup(void)
+{
+  SdFile dir;
+
+  Serial.begin(57600);
+  Serial.print(F("\n[MD_YM2413 Emulator Benchmark]"));
+  Serial.print(F("\nEMU_SKIP_IDLE "));
+  Serial.print(EMU_SKIP_IDLE);
+
+  if (!SD.begin(SD_SELECT, SPI_FULL_SPEED))
+  {
+    Serial.print(F("\nSD init fail!"));
+    while (true);
+  }
+
+  if (!dir.open(VGM_FOLDER, O_READ))
+  {
+    Serial.print(F("\nNo folder "));
+    Serial.print(VGM_FOLDER);
+    while (true);
+  }
+
+  Serial.print(F("\n\nFile\t\ttune s\trender ms\tx real time\tactive\thash"));
+  while (FD.openNext(&dir, O_READ))
+  {
+    char name[20];
+
+    FD.getName(name, ARRAY_SIZE(name));
+    if (playVGM() && blockCount != 0)
+    {
+      uint32_t tuneTime = (emuSamples * 10UL) / E.getSampleRate();   // tenths of a second
+
+      Serial.print(F("\n"));
+      Serial.print(name);
+      Serial.print(F("\t"));
+      if (strlen(name) < 8) Serial.print(F("\t"));
+      Serial.print(tuneTime / 10);
+      Serial.print(F("."));
+      Serial.print(tuneTime % 10);
+      Serial.print(F("\t"));
+      Serial.print(renderTime / 1000);
+      Serial.print(F("\t\t"));
+      Serial.print((tuneTime * 100UL) / (renderTime / 1000 + 1));
+      Serial.print(F("\t\t"));
+      Serial.print((activeSum * 10) / blockCount / 10);
+      Serial.print(F("."));
+      Serial.print((activeSum * 10) / blockCount % 10);
+      Serial.print(F("\t"));
+      for (int8_t i = 28; i >= 0; i -= 4)
+        Serial.print((hash >> i) & 0xf, HEX);
+    }
+    FD.close();
+  }
+  dir.close();
+  Serial.print(F("\n\nDone"));
+}
+
+void loop(void) {}
@@ -0,0 +1,131 @@
+// Save and restore the software YM2413 state to seek and render again.
+//
+// Example program for the MD_YM2413 library.
+//
+// A short tune is rendered on the software YM2413, saving a snapshot of
+// the synthesizer state at the start of each bar. The bars are then played
+// in reverse order by restoring the snapshot for each bar, as an application
+// would to seek in a preview or to render a section again while changing
+// an instrument. The samples for each bar are checked against those from
+// the first time it was rendered.
+//
+// The Serial Monitor shows
+// - the snapshot size and the average time to save a snapshot.
+// - for each bar, the time to restore the snapshot and the time it would
+//   take to get to the same point by rendering from the start of the tune.
+// - PASS if the bar is the same as the first time, FAIL otherwise.
+//
+// The synthesizer uses 32 bit integer arithmetic, so this is meant for
+// 32 bit MCUs.
+//
+
+#include <MD_YM2413.h>
+#include <MD_YM2413_Emu.h>
+
+// Global Data ------------------------
+const uint16_t BLOCK_SIZE = 64;       // samples rendered in each block
+const uint16_t BAR_BLOCKS = 150;      // blocks in each bar, about 0.2s
+const uint8_t BARS = 4;               // bars in the tune
+
+MD_YM2413_Emu E;
+
+void emuWrite(uint8_t addr, uint8_t data) { E.write(addr, data); }
+
+MD_YM2413 S(emuWrite);
+
+int16_t buf[BLOCK_SIZE];
+uint8_t snap[BARS][MD_YM2413_Emu::SNAPSHOT_SIZE];  // snapshot at the start of each bar
+uint32_t check[BARS];                               // checksum of the samples for each bar
+
+// Code -------------------------------
+void playBar(uint8_t bar)
+// Start the chord and drum for the bar
+{
+  const uint8_t root[BARS] = { 0, 5, 7, 0 };
+  const uint8_t chord[] = { 0, 4, 7 };
+
+  for (uint8_t i = 0; i < ARRAY_SIZE(chord); i++)
+  {
+    uint8_t n = root[bar] + chord[i];
+
+    S.noteOn(i, (uint8_t)(3 + n / 12), (uint8_t)(n % 12), MD_YM2413::VOL_MAX);
+  }
+  S.noteOn(MD_YM2413::CH_BD, (uint8_t)4, (uint8_t)0, MD_YM2413::VOL_MAX);
+}
+
+uint32_t renderBar(void)
+// Render the samples for one bar and return their checksum
+{
+  uint32_t sum = 0;
+
+  for (uint16_t b = 0; b < BAR_BLOCKS; b++)
+  {
+    E.render(buf, BLOCK_SIZE);
+    for (uint16_t i = 0; i < BLOCK_SIZE; i++)
+      sum = ((sum << 1) | (sum >> 31)) ^ (uint16_t)buf[i];
+  }
+
+  return(sum);
+}
+
+void setup(void)
+{
+  uint32_t t, tSave = 0, tRender;
+  uint16_t size = 0;
+  bool fail = false;
+
+  Serial.begin(57600);
+  Serial.print(F("\n[MD_YM2413 Emulator Snapshot]"));
+
+  E.begin();
+  S.begin();
+  S.setPercussion(true);
+  for (uint8_t i = 0; i < 3; i++)
+    S.setInstrument(i, MD_YM2413::I_HARPSICHORD);
+
+  // render the tune, saving the state at the start of each bar
+  tRender = micros();
+  for (uint8_t bar = 0; bar < BARS; bar++)
+  {
+    playBar(bar);
+    t = micros();
+    size = E.saveState(snap[bar]);
+    tSave += micros() - t;
+    check[bar] = renderBar();
+  }
+  tRender = micros() - tRender - tSave;
+
+  Serial.print(F("\nSnapshot "));
+  Serial.print(size);
+  Serial.print(F(" bytes, version "));
+  Serial.print(MD_YM2413_Emu::SNAPSHOT_VERSION);
+  Serial.print(F(", save "));
+  Serial.print(tSave / BARS);
+  Serial.print(F("us"));
+
+  // play the bars again in reverse order from the snapshots
+  Serial.print(F("\n\nBar\trestore us\tfrom start us\tcheck"));
+  for (int8_t bar = BARS - 1; bar >= 0; bar--)
+  {
+    bool ok;
+
+    t = micros();
+    ok = E.restoreState(snap[bar]);
+    t = micros() - t;
+    ok = ok && (renderBar() == check[bar]);
+
+    Serial.print(F("\n"));
+    Serial.print(bar);
+    Serial.print(F("\t"));
+    Serial.print(t);
+    Serial.print(F("\t\t"));
+    Serial.print((tRender / BARS) * bar);
+    Serial.print(F("\t\t"));
+    Serial.print(ok ? F("PASS") : F("FAIL"));
+    fail = fail || !ok;
+  }
+
+  Serial.print(fail ? F("\n\nFAILED") : F("\n\nPASSED"));
+}
+
+void loop(void) {}
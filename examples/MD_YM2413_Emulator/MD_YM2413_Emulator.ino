@@ -0,0 +1,164 @@
+// Play notes on the software YM2413 and measure the time to render the audio.
+//
+// Example program for the MD_YM2413 library.
+//
+// The MD_YM2413 object is created with the software synthesizer as its
+// device, so no YM2413 IC is needed and the rest of the application is
+// the same as for the IC. The audio is rendered in blocks when each block
+// is due, converted to the OUTPUT_RATE sample rate with MD_YM2413_Resample
+// and passed to outputBlock(), which would send it to the DAC or I2S device
+// on the board.
+//
+// The latency of the audio output, which is the time for a block to play
+// plus the delay in the resampling filter, is shown at the start.
+//
+// Every second the Serial Monitor shows
+// - the average and maximum time to render a block and the load, which is
+//   the render and resample time as a percentage of the time the block
+//   takes to play. The load must stay well under 100% for the audio to
+//   play without gaps on the board.
+// - the average time to resample a block and the most output samples per
+//   second the resampler can work out at that speed.
+//
+// The synthesizer uses 32 bit integer arithmetic, so this is meant for
+// 32 bit MCUs. It will run on AVR but too slowly to play in real time.
+//
+
+#include <MD_YM2413.h>
+#include <MD_YM2413_Emu.h>
+#include <MD_YM2413_Resample.h>
+
+// Global Data ------------------------
+const uint16_t BLOCK_SIZE = 64;       // samples rendered in each block
+const uint16_t NOTE_TIME = 400;       // note duration in ms
+const uint16_t REPORT_TIME = 1000;    // ms between reports
+const uint32_t OUTPUT_RATE = 44100;   // output sample rate in Hz, 44100 or 48000
+
+MD_YM2413_Emu E;
+MD_YM2413_Resample R;
+
+void emuWrite(uint8_t addr, uint8_t data) { E.write(addr, data); }
+
+MD_YM2413 S(emuWrite);
+
+int16_t buf[BLOCK_SIZE];
+int16_t outBuf[BLOCK_SIZE];   // output rate is lower, so this is big enough
+
+uint32_t blockTime;     // us to play one block
+uint32_t renderMax = 0; // longest render time in us
+uint32_t renderSum = 0; // total render time in us
+uint16_t renderCount = 0;
+uint32_t resampleSum = 0;   // total resample time in us
+uint32_t outCount = 0;      // total output samples
+
+// Code -------------------------------
+void outputBlock(const int16_t* buf, uint16_t count)
+// Send the block to the audio output for the board (eg, I2S or DAC).
+{
+}
+
+void playNotes(void)
+// Play a chord and melody note every NOTE_TIME ms
+{
+  static uint32_t timeLast = 0;
+  static uint8_t note = 0;
+  const uint8_t scale[] = { 0, 2, 4, 5, 7, 9, 11, 12 };
+
+  if (millis() - timeLast < NOTE_TIME)
+    return;
+  timeLast = millis();
+
+  S.noteOn(0, (uint8_t)(4 + scale[note] / 12), (uint8_t)(scale[note] % 12), MD_YM2413::VOL_MAX, NOTE_TIME);
+  if (note == 0)
+  {
+    S.noteOn(1, (uint8_t)3, (uint8_t)0, MD_YM2413::VOL_MAX, NOTE_TIME * 4);
+    S.noteOn(2, (uint8_t)3, (uint8_t)4, MD_YM2413::VOL_MAX, NOTE_TIME * 4);
+    S.noteOn(3, (uint8_t)3, (uint8_t)7, MD_YM2413::VOL_MAX, NOTE_TIME * 4);
+  }
+  S.noteOn(MD_YM2413::CH_HH, (uint8_t)4, (uint8_t)0, MD_YM2413::VOL_MAX, NOTE_TIME / 2);
+  if ((note & 1) == 0)
+    S.noteOn(note & 2 ? MD_YM2413::CH_SD : MD_YM2413::CH_BD, (uint8_t)4, (uint8_t)0, MD_YM2413::VOL_MAX, NOTE_TIME / 2);
+
+  note = (note + 1) % sizeof(scale);
+}
+
+void setup(void)
+{
+  Serial.begin(57600);
+  Serial.print(F("\n[MD_YM2413 Emulator]"));
+
+  E.begin();
+  S.begin();
+  S.setPercussion(true);
+  S.setInstrument(0, MD_YM2413::I_VIBRAPHONE);
+  for (uint8_t i = 1; i < 4; i++)
+    S.setInstrument(i, MD_YM2413::I_ORGAN, 10);
+
+  R.begin(E.getSampleRate(), OUTPUT_RATE);
+
+  blockTime = (BLOCK_SIZE * 1000000UL) / E.getSampleRate();
+  Serial.print(F("\nSample rate "));
+  Serial.print(E.getSampleRate());
+  Serial.print(F("Hz, block "));
+  Serial.print(BLOCK_SIZE);
+  Serial.print(F(" samples "));
+  Serial.print(blockTime);
+  Serial.print(F("us"));
+  Serial.print(F("\nOutput rate "));
+  Serial.print(OUTPUT_RATE);
+  Serial.print(F("Hz, latency "));
+  Serial.print(blockTime + R.getDelay());
+  Serial.print(F("us"));
+}
+
+void loop(void)
+{
+  static uint32_t timeBlock = micros();
+  static uint32_t timeReport = millis();
+
+  S.run();
+  playNotes();
+
+  // render the next block when it is due
+  if (micros() - timeBlock >= blockTime)
+  {
+    uint32_t t = micros(), tr;
+    uint16_t n;
+
+    timeBlock += blockTime;
+    E.render(buf, BLOCK_SIZE);
+    tr = micros();
+    n = R.process(buf, BLOCK_SIZE, outBuf);
+    tr = micros() - tr;
+    t = micros() - t;
+    outputBlock(outBuf, n);
+
+    if (t > renderMax) renderMax = t;
+    renderSum += t;
+    renderCount++;
+    resampleSum += tr;
+    outCount += n;
+  }
+
+  // report the render time
+  if (millis() - timeReport >= REPORT_TIME && renderCount != 0)
+  {
+    timeReport = millis();
+    Serial.print(F("\nRender avg "));
+    Serial.print(renderSum / renderCount);
+    Serial.print(F("us max "));
+    Serial.print(renderMax);
+    Serial.print(F("us load "));
+    Serial.print((renderSum * 100) / (renderCount * blockTime));
+    Serial.print(F("%, resample avg "));
+    Serial.print(resampleSum / renderCount);
+    Serial.print(F("us "));
+    if (resampleSum != 0)
+    {
+      Serial.print((uint32_t)((outCount * 1000000ULL) / resampleSum));
+      Serial.print(F(" samples/s"));
+    }
+    renderMax = renderSum = renderCount = 0;
+    resampleSum = outCount = 0;
+  }
+}
@@ -0,0 +1,98 @@
+// Play live MIDI from a serial MIDI input.
+//
+// Example program for the MD_YM2413 library.
+// 
+// MIDI bytes are received in the UART receive interrupt and played
+// from loop(). On ATmega328 boards (eg, Uno, Nano) the MIDI input is 
+// connected to the RX pin and the hardware Serial port cannot be used 
+// by the application. On boards with a second hardware serial port 
+// (eg, Mega) the MIDI input is connected to Serial1 and the latency
+// statistics are printed on Serial.
+//
+// MIDI In hardware interface at https://www.midi.org/specifications
+
+#include <MD_YM2413.h>
+#include <MD_YM2413_MIDI.h>
+#include <MD_YM2413_MIDIIn.h>
+
+// Hardware Definitions ---------------
+// All the pins directly connected to D0-D7 on the IC, in sequential order 
+// so that pin D_PIN[0] is connected to D0, D_PIN[1] to D1, etc.
+const uint8_t D_PIN[] = { 8, 9, 7, 6, A0, A1, A2, A3 };
+const uint8_t WE_PIN = 5;     // Arduino pin connected to the IC WE pin
+const uint8_t A0_PIN = 4;     // Arduino pin connected to the A0 pin
+
+const uint32_t MIDI_BAUD = 31250;
+const uint16_t STATS_PERIOD = 5000;   // ms between statistics output
+
+// Global Data ------------------------
+MD_YM2413 S(D_PIN, WE_PIN, A0_PIN);
+MD_YM2413_MIDI M(S);
+MD_YM2413_MIDIIn MI(M);
+
+#if defined(USART_RX_vect)  // single UART AVR, take over the receive interrupt
+#define MIDI_ISR 1
+
+ISR(USART_RX_vect)
+{
+  MI.receive(UDR0);
+}
+
+void midiBegin(void)
+{
+  UBRR0 = (F_CPU / 16 / MIDI_BAUD) - 1;
+  UCSR0A = 0;
+  UCSR0C = _BV(UCSZ01) | _BV(UCSZ00);   // 8N1
+  UCSR0B = _BV(RXEN0) | _BV(RXCIE0);    // receive with interrupt
+}
+
+#else   // use the second serial port
+#define MIDI_ISR 0
+
+void serialEvent1(void)
+{
+  while (Serial1.available())
+    MI.receive(Serial1.read());
+}
+
+void midiBegin(void)
+{
+  Serial1.begin(MIDI_BAUD);
+}
+#endif
+
+void setup(void)
+{
+#if !MIDI_ISR
+  Serial.begin(57600);
+  Serial.print(F("\n[MD_YM2413 MIDI Live]"));
+#endif
+
+  S.begin();
+  S.setPercussion(true);
+  M.begin();
+  MI.begin();
+  midiBegin();
+}
+
+void loop(void)
+{
+  MI.run();   // play what has been received
+
+#if !MIDI_ISR
+  static uint32_t timeLast = 0;
+
+  if (millis() - timeLast >= STATS_PERIOD)
+  {
+    timeLast = millis();
+    Serial.print(F("\nLatency us max "));
+    Serial.print(MI.getLatencyMax());
+    Serial.print(F(" avg "));
+    Serial.print(MI.getLatencyAvg());
+    Serial.print(F(", lost "));
+    Serial.print(MI.getOverflow());
+    Serial.print(F(", dropped "));
+    Serial.print(M.getDropped());
+  }
+#endif
+}
@@ -4,15 +4,15 @@
 // Plays plays RTTTL (RingTone Text Transfer Language) songs.
 // Cycles through all the includes songs in sequence.
 //
+// Each song is compiled into a list of notes before it is played and 
+// the other channels are arranged from the melody (see RTTTL_Arranger.h).
+//
 // RTTTL format definition https://en.wikipedia.org/wiki/Ring_Tone_Transfer_Language
 // Lots of RTTTL files at http://www.picaxe.com/RTTTL-Ringtones-for-Tune-Command/
 //
-// Dependencies
-// MD_RTTLParser can be found at https://github.com/MajicDesigns/MD_RTTTLParser
-//
 
 #include <MD_YM2413.h>
-#include <MD_RTTTLParser.h>
+#include "RTTTL_Arranger.h"
 #include "MD_YM2413_RTTTL_Player.h" // RTTL song data in a separate file
 
 #ifndef DEBUG
@@ -40,45 +40,36 @@ const uint8_t A0_PIN = 4;     // Arduino pin connected to the A0 pin
 
 const uint8_t PLAY_VOL = MD_YM2413::VOL_MAX;
 
-// Number of playing channels and the instruments for each
+// Number of playing channels and the instruments for each.
+// Channel 0 plays the melody, the rest are used by the arrangement.
 const MD_YM2413::instrument_t instr[] =
 {
   MD_YM2413::I_PIANO, 
-  MD_YM2413::I_SYNTH_BASS, 
-  MD_YM2413::I_ACOUSTIC_BASS 
+  MD_YM2413::I_ACOUSTIC_BASS,
+  MD_YM2413::I_VIOLIN,
+  MD_YM2413::I_VIOLIN,
 };
 const uint8_t NUM_CHAN = ARRAY_SIZE(instr);
 
+// Arrangement for the songs
+const uint8_t ARRANGEMENT = RTTTLArranger::ARR_BASS | RTTTLArranger::ARR_CHORD;
+
 // Global Data ------------------------
 MD_YM2413 S(D_PIN, WE_PIN, A0_PIN);
-MD_RTTTLParser P;
-
-void RTTTLhandler(uint8_t octave, uint8_t noteId, uint32_t duration, bool activate)
-// If activate is true, play a note (octave, noteId) for the duration (ms) specified.
-// If activate is false, the note should be turned off (other parameters are ignored).
-{
-  for (uint8_t i = 0; i < NUM_CHAN; i++)
-  {
-    if (activate)
-      S.noteOn(i, octave, noteId, duration);
-    else
-      S.noteOff(i);
-  }
-}
+RTTTLArranger P(S, NUM_CHAN);
 
 void setup(void)
 {
   Serial.begin(57600);
   PRINTS("\n[MD_YM2413 RTTL Player]");
 
-  P.begin();
-  P.setCallback(RTTTLhandler);
-
   S.begin();
   S.setVolume(PLAY_VOL);
 
   for (uint8_t i = 0; i < NUM_CHAN; i++)
     S.setInstrument(i, instr[i]);
+
+  P.setArrangement(ARRANGEMENT);
 }
 
 void loop(void)
@@ -97,9 +88,13 @@ void loop(void)
   {
     case START: // starting a new melody
       PRINTS("\n-->IDLE");
-      P.setTune_P(songTable[idxTable]);
+      if (!P.compile(songTable[idxTable]))
+        PRINTS("\nSong truncated");
       Serial.print(F("\n"));
       Serial.print(P.getTitle());
+      PRINT(" notes ", P.getCount());
+      PRINT(" key ", P.getKey());
+      P.start();
       
       // set up for next song
       idxTable++;
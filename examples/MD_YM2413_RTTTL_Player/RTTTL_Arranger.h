@@ -0,0 +1,310 @@
+// RTTTL compiler, arranger and player for the MD_YM2413 library.
+//
+// A RTTTL song is parsed once from PROGMEM into a compact array of
+// timed events (2 bytes per note). The song is then played from the
+// array, with the arrangement for the other channels worked out from
+// each melody note as it is played, so no text is parsed while playing.
+//
+// Arrangement options
+// - ARR_BASS     bass line of the melody note an octave down.
+// - ARR_DOUBLE   melody doubled an octave up.
+// - ARR_CHORD    the chord under the melody note is arpeggiated across the
+//                remaining channels. The song key is found when the song is
+//                compiled and the chord is built from the key's scale.
+//
+// Channel 0 always plays the melody and the options use the following
+// channels in the order listed above, as long as channels are available.
+//
+// RTTTL format definition https://en.wikipedia.org/wiki/Ring_Tone_Transfer_Language
+
+#pragma once
+
+#include <MD_YM2413.h>
+
+class RTTTLArranger
+{
+public:
+  static const uint16_t MAX_EVENTS = 160;   // compiled notes, 2 bytes each
+  static const uint8_t TITLE_SIZE = 20;     // including nul terminator
+
+  // Arrangement options, combine by OR
+  static const uint8_t ARR_NONE = 0x00;
+  static const uint8_t ARR_BASS = 0x01;
+  static const uint8_t ARR_DOUBLE = 0x02;
+  static const uint8_t ARR_CHORD = 0x04;
+
+  RTTTLArranger(MD_YM2413& ym, uint8_t numChan) : _S(ym), _numChan(numChan), _count(0), _idx(0) {}
+
+  // Parse the PROGMEM RTTTL song into the event array.
+  // Returns false if the song was too long and has been truncated.
+  bool compile(const char* songP)
+  {
+    uint8_t defDur = 4, defOct = 6;
+    uint16_t bpm = 63;
+    const char* p = songP;
+    char c;
+    uint8_t i = 0;
+    bool fit = true;
+
+    // title
+    while ((c = pgm_read_byte(p)) != '\0' && c != ':')
+    {
+      if (i < TITLE_SIZE - 1) _title[i++] = c;
+      p++;
+    }
+    _title[i] = '\0';
+    if (c == ':') p++;
+
+    // defaults section "d=N,o=N,b=NNN:"
+    while ((c = pgm_read_byte(p)) != '\0' && c != ':')
+    {
+      if (c == 'd' || c == 'o' || c == 'b')
+      {
+        uint16_t v;
+
+        p++;
+        if (pgm_read_byte(p) == '=') p++;
+        v = readNum(p);
+        if (c == 'd' && v != 0) defDur = v;
+        if (c == 'o' && v != 0) defOct = v;
+        if (c == 'b' && v != 0) bpm = v;
+      }
+      else
+        p++;
+    }
+    if (c == ':') p++;
+
+    // A whole note is 240000/bpm ms and 128 ticks, so keep
+    // the ms per tick in 1/256 ms to avoid dividing when playing.
+    _tickTime = (240000UL * 256 / 128) / bpm;
+
+    // notes
+    _count = 0;
+    while (pgm_read_byte(p) != '\0')
+    {
+      uint8_t dur, note, oct, ticks;
+      bool dotted = false;
+
+      dur = readNum(p);
+      if (dur == 0) dur = defDur;
+
+      switch (tolower(pgm_read_byte(p)))
+      {
+      case 'c': note = 0; break;
+      case 'd': note = 2; break;
+      case 'e': note = 4; break;
+      case 'f': note = 5; break;
+      case 'g': note = 7; break;
+      case 'a': note = 9; break;
+      case 'b': note = 11; break;
+      default: note = REST; break;
+      }
+      p++;
+      c = pgm_read_byte(p);
+      if (c == '#' || c == '_') { if (note != REST) note++; p++; }
+      if (pgm_read_byte(p) == '.') { dotted = true; p++; }
+      oct = readNum(p);
+      if (oct == 0) oct = defOct;
+      if (pgm_read_byte(p) == '.') { dotted = true; p++; }
+
+      // skip to the next note
+      while ((c = pgm_read_byte(p)) != '\0' && c != ',') p++;
+      if (c == ',') p++;
+
+      if (note == 12) { note = 0; oct++; }    // B# is the next C
+      if (oct < MD_YM2413::MIN_OCTAVE) oct = MD_YM2413::MIN_OCTAVE;
+      if (oct > 7) oct = 7;
+      ticks = 128 / dur;
+      if (dotted) ticks += ticks / 2;
+
+      if (_count < MAX_EVENTS)
+      {
+        _event[_count].octNote = (oct << 4) | note;
+        _event[_count].ticks = ticks;
+        _count++;
+      }
+      else
+        fit = false;
+    }
+
+    findKey();
+    _idx = _count;    // not playing yet
+
+    return(fit);
+  }
+
+  // Set the arrangement options
+  void setArrangement(uint8_t arr) { _arr = arr; }
+
+  // Song information
+  const char* getTitle(void) { return(_title); }
+  uint16_t getCount(void) { return(_count); }
+  uint8_t getKey(void) { return(_key); }
+
+  // Start playing the compiled song
+  void start(void)
+  {
+    _idx = 0;
+    _arpCount = 0;
+    _timeNext = 0;
+    _timeStart = millis();
+  }
+
+  // Play the next event when it is due, return true when the song has ended.
+  // The library run() handles the note off for each note.
+  bool run(void)
+  {
+    uint32_t now = millis() - _timeStart;
+
+    // delayed chord notes
+    if (_arpCount != 0 && now >= _arpTime)
+    {
+      _S.noteOn(_arpChan, _arpOct, _arpNote[0], VOL, _arpDur);
+      _arpNote[0] = _arpNote[1];
+      _arpChan++;
+      _arpCount--;
+      _arpTime += ARP_DELAY;
+      _arpDur = (_arpDur > ARP_DELAY) ? _arpDur - ARP_DELAY : 1;
+    }
+
+    if (_idx >= _count)
+      return(_arpCount == 0);
+
+    if (now < _timeNext)
+      return(false);
+
+    playEvent(_event[_idx], now);
+    _timeNext += ((uint32_t)_event[_idx].ticks * _tickTime) >> 8;
+    _idx++;
+
+    return(false);
+  }
+
+private:
+  static const uint8_t REST = 0xf;
+  static const uint8_t VOL = MD_YM2413::VOL_MAX;
+  static const uint16_t ARP_DELAY = 40;   // ms between chord notes
+
+  struct event_t
+  {
+    uint8_t octNote;  // octave in high nibble, note [0..11] or REST in low nibble
+    uint8_t ticks;    // duration in 1/128 whole notes
+  };
+
+  MD_YM2413& _S;
+  uint8_t _numChan;             // channels available for the arrangement
+  uint8_t _arr = ARR_BASS;      // arrangement options
+
+  char _title[TITLE_SIZE];
+  event_t _event[MAX_EVENTS];
+  uint16_t _count;              // number of events compiled
+  uint16_t _tickTime;           // ms per tick in 1/256 ms
+  uint8_t _key;                 // major key of the song [0..11]
+
+  uint16_t _idx;                // next event to play
+  uint32_t _timeStart;          // millis() at start of song
+  uint32_t _timeNext;           // song time for the next event
+
+  uint8_t _arpCount;            // chord notes still to play
+  uint8_t _arpChan;             // channel for the next chord note
+  uint8_t _arpOct;              // octave for the chord notes
+  uint8_t _arpNote[2];          // chord notes to play
+  uint32_t _arpTime;            // song time for next chord note
+  uint16_t _arpDur;             // duration of the next chord note
+
+  static uint16_t readNum(const char*& p)
+  {
+    uint16_t v = 0;
+    char c;
+
+    while ((c = pgm_read_byte(p)) >= '0' && c <= '9')
+    {
+      v = (v * 10) + (c - '0');
+      p++;
+    }
+    return(v);
+  }
+
+  static bool inScale(uint8_t key, uint8_t note)
+  // true if the note is in the major scale of the key
+  {
+    const uint16_t MAJOR = 0b101010110101;   // C D E F G A B as bits 0..11
+    return(MAJOR & (1 << ((note + 12 - key) % 12)));
+  }
+
+  void findKey(void)
+  // Pick the major key that fits the most notes of the song
+  {
+    uint8_t bestScore = 0;
+
+    _key = 0;
+    for (uint8_t k = 0; k < 12; k++)
+    {
+      uint8_t score = 0;
+
+      for (uint16_t i = 0; i < _count; i++)
+      {
+        uint8_t n = _event[i].octNote & 0xf;
+        if (n != REST && inScale(k, n) && score < 255) score++;
+      }
+      if (score > bestScore)
+      {
+        bestScore = score;
+        _key = k;
+      }
+    }
+  }
+
+  uint8_t scaleUp(uint8_t note, uint8_t steps)
+  // Return the note a number of scale steps above note, as
+  // semitones above note. Notes outside the key use a major triad.
+  {
+    uint8_t n = 0;
+
+    if (!inScale(_key, note))
+      return(steps == 2 ? 4 : 7);
+
+    while (steps > 0)
+    {
+      n++;
+      if (inScale(_key, (note + n) % 12)) steps--;
+    }
+    return(n);
+  }
+
+  void playEvent(event_t e, uint32_t now)
+  {
+    uint8_t oct = e.octNote >> 4;
+    uint8_t note = e.octNote & 0xf;
+    uint16_t dur = ((uint32_t)e.ticks * _tickTime) >> 8;
+    uint8_t chan = 1;
+
+    if (note == REST)
+      return;
+
+    dur -= dur / 8;   // small gap between notes
+    _S.noteOn(0, oct, note, VOL, dur);
+
+    if ((_arr & ARR_BASS) && chan < _numChan)
+      _S.noteOn(chan++, oct > MD_YM2413::MIN_OCTAVE ? oct - 1 : oct, note, VOL, dur);
+
+    if ((_arr & ARR_DOUBLE) && chan < _numChan)
+      _S.noteOn(chan++, oct < 7 ? oct + 1 : oct, note, VOL, dur);
+
+    if ((_arr & ARR_CHORD) && chan < _numChan)
+    {
+      // chord third and fifth below the melody note, first one now
+      _arpOct = oct > MD_YM2413::MIN_OCTAVE ? oct - 1 : oct;
+      _arpNote[0] = (note + scaleUp(note, 2)) % 12;
+      _arpNote[1] = (note + scaleUp(note, 4)) % 12;
+      _S.noteOn(chan++, _arpOct, _arpNote[0], VOL, dur);
+      _arpNote[0] = _arpNote[1];
+
+      // the rest are staggered
+      _arpCount = (chan < _numChan) ? 1 : 0;
+      _arpChan = chan;
+      _arpTime = now + ARP_DELAY;
+      _arpDur = (dur > ARP_DELAY) ? dur - ARP_DELAY : 1;
+    }
+  }
+};
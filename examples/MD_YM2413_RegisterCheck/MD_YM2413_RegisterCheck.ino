@@ -0,0 +1,309 @@
+// Check the register writes made by the library against known good values.
+//
+// Example program for the MD_YM2413 library.
+//
+// Each test is a fixed script of library calls. The register writes for
+// the script are captured using the register write hook and a CRC of the
+// stream of (step, address, data) values is compared to the CRC recorded
+// when the library was known to be working. The step is the number of the
+// call in the script, so writes moving from one call to another are found
+// as well as changes to the writes themselves.
+//
+// For each test the Serial Monitor shows
+// - the number of register writes (data) and address writes.
+// - the bus busy time, which is the least time the YM2413 needs to latch
+//   the address and data writes.
+// - the CRC of the stream and the expected CRC, and PASS or FAIL.
+//
+// This is used to check that changes to the library still program the
+// YM2413 the same way. If a test fails, set TRACE to 1 and compare the
+// listing of the writes with one captured from the previous library
+// version to see what has changed. If the change is intended, update the
+// expected CRC in the test table.
+//
+// Libraries used
+// ==============
+// The MIDI test uses the MD_YM2413_MIDI class included with this library.
+//
+// The YM2413 does not need to be connected to run this sketch.
+//
+
+#include <MD_YM2413.h>
+#include <MD_YM2413_MIDI.h>
+
+#define TRACE 0   // set to 1 to list the register writes
+
+// Hardware Definitions ---------------
+// All the pins directly connected to D0-D7 on the IC, in sequential order
+// so that pin D_PIN[0] is connected to D0, D_PIN[1] to D1, etc.
+const uint8_t D_PIN[] = { 8, 9, 7, 6, A0, A1, A2, A3 };
+const uint8_t WE_PIN = 5;     // Arduino pin connected to the IC WE pin
+const uint8_t A0_PIN = 4;     // Arduino pin connected to the A0 pin
+
+// Datasheet minimum waits in master clock cycles
+const uint8_t CYCLES_ADDR = 12;   // after an address write
+const uint8_t CYCLES_DATA = 84;   // after a data write
+
+// Global Data ------------------------
+MD_YM2413 S(D_PIN, WE_PIN, A0_PIN);
+MD_YM2413_MIDI M(S);
+
+uint16_t step;              // current step in the test script
+uint16_t crc;               // CRC of the register stream
+uint32_t countData;         // data writes
+uint32_t countAddr;         // address writes
+uint8_t lastAddr;           // last address written
+bool fail = false;          // true if any test failed
+
+// Each library call in a script is a step
+#define STEP(x) { step++; x; }
+
+// Test Scripts -----------------------
+void testMelody(void)
+// Melodic channels, instruments and notes
+{
+  for (uint8_t i = 0; i < 6; i++)
+    STEP(S.setInstrument(i, (MD_YM2413::instrument_t)(MD_YM2413::I_VIOLIN + (2 * i)), MD_YM2413::VOL_MAX - i));
+  STEP(S.noteOn(0, (uint8_t)4, (uint8_t)0, MD_YM2413::VOL_MAX));
+  STEP(S.noteOn(1, (uint8_t)4, (uint8_t)4, 12));
+  STEP(S.noteOn(2, (uint8_t)4, (uint8_t)7, 10));
+  STEP(S.noteOn(3, (uint16_t)55, MD_YM2413::VOL_MAX));
+  STEP(S.noteOn(4, (uint16_t)1760, MD_YM2413::VOL_MAX));
+  STEP(S.noteOn(5, (uint8_t)1, (uint8_t)11, 8));
+  STEP(S.bendNote(0, 256));
+  STEP(S.bendNote(0, -512));
+  STEP(S.setVolume(1, 6));
+  STEP(S.setVolume(9));
+  STEP(S.setSustain(2, true));
+  STEP(S.noteOff(2));
+  STEP(S.noteOn(2, (uint8_t)7, (uint8_t)11, MD_YM2413::VOL_MAX));
+  for (uint8_t i = 0; i < 6; i++)
+    STEP(S.noteOff(i));
+}
+
+void testPercussion(void)
+// Percussion mode and the percussion channels
+{
+  STEP(S.setPercussion(true));
+  for (uint8_t i = MD_YM2413::CH_HH; i <= MD_YM2413::CH_BD; i++)
+    STEP(S.noteOn(i, (uint8_t)4, (uint8_t)0, MD_YM2413::VOL_MAX));
+  STEP(S.setVolume(MD_YM2413::CH_SD, 7));
+  STEP(S.setVolume(MD_YM2413::CH_TCY, 3));
+  STEP(S.setVolume(11));
+  for (uint8_t i = MD_YM2413::CH_HH; i <= MD_YM2413::CH_BD; i++)
+    STEP(S.noteOff(i));
+  STEP(S.noteOn(0, (uint8_t)5, (uint8_t)2, MD_YM2413::VOL_MAX));
+  STEP(S.setPercussion(false));
+  STEP(S.noteOn(7, (uint8_t)3, (uint8_t)9, MD_YM2413::VOL_MAX));
+  STEP(S.noteOff(0));
+  STEP(S.noteOff(7));
+}
+
+void testCustom(void)
+// Custom instrument
+{
+  const uint8_t custom[8] = { 0x61, 0x61, 0x1e, 0x17, 0xf0, 0x7f, 0x00, 0x17 };
+
+  STEP(S.loadInstrument(custom));
+  STEP(S.setInstrument(0, MD_YM2413::I_CUSTOM, MD_YM2413::VOL_MAX));
+  STEP(S.noteOn(0, (uint8_t)4, (uint8_t)9, MD_YM2413::VOL_MAX));
+  STEP(S.noteOff(0));
+}
+
+void testRaw(void)
+// Raw register writes, as used for VGM files
+{
+  STEP(S.write(0x0e, 0x20));
+  STEP(S.write(0x36, 0x04));
+  STEP(S.write(0x37, 0x52));
+  STEP(S.write(0x38, 0x13));
+  STEP(S.write(0x0e, 0x3f));
+  STEP(S.write(0x0e, 0x20));
+  STEP(S.write(0x30, 0x30));
+  STEP(S.write(0x10, 0xac));
+  STEP(S.write(0x20, 0x18));
+  STEP(S.write(0x20, 0x08));
+  STEP(S.write(0x0e, 0x00));
+}
+
+void testBlock(void)
+// Optimized block writes, with notes keyed on and off in the block
+{
+  // Two notes on channel 0 with a new F-Num, instrument and volume between
+  // them. The first note keeps F-Num 0xac and the piano at volume 0, the
+  // repeated F-Num write before it is dropped.
+  const uint8_t notes[] =
+  {
+    0x10, 0x20, 0x30, 0x30, 0x10, 0xac, 0x20, 0x18,   // f1, instrument, key on
+    0x20, 0x08, 0x30, 0x14, 0x10, 0x58, 0x20, 0x19,   // key off, instrument and volume, f2, key on
+    0x0e, 0x20, 0x36, 0x04, 0x0e, 0x30, 0x36, 0x00,   // rhythm on, BD volume, BD key on, BD volume
+    0x20, 0x09, 0x0e, 0x20, 0x40, 0x00,               // key off, BD key off, no register
+  };
+  // Register image, the key on writes are sent last
+  const uint8_t image[] =
+  {
+    0x61, 0x61, 0x1e, 0x17, 0xf0, 0x7f, 0x00, 0x17,   // 0x00-0x07 custom instrument
+    0, 0, 0, 0, 0, 0, 0x00, 0x00,                     // 0x0e rhythm, 0x0f test
+    0xac, 0x58, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,   // 0x10-0x18 F-Num
+    0x18, 0x19, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,   // 0x20-0x28 block and key
+    0x00, 0x30, 0, 0, 0, 0, 0, 0, 0,                  // 0x30-0x38 instrument and volume
+  };
+
+  STEP(S.writeBlock(notes, sizeof(notes) / 2, true));
+  STEP(S.writeBlock(0x00, image, sizeof(image), true));
+  STEP(S.write(0x20, 0x08));
+  STEP(S.write(0x21, 0x09));
+}
+
+void testSuspend(void)
+// Suspend and resume with melodic and percussion notes playing
+{
+  STEP(S.setPercussion(true));
+  STEP(S.noteOn(0, (uint8_t)4, (uint8_t)0, MD_YM2413::VOL_MAX, 1000));
+  STEP(S.noteOn(1, (uint8_t)4, (uint8_t)4, 12));
+  STEP(S.noteOn(MD_YM2413::CH_BD, (uint8_t)4, (uint8_t)0, MD_YM2413::VOL_MAX));
+  STEP(S.noteOn(MD_YM2413::CH_HH, (uint8_t)4, (uint8_t)0, MD_YM2413::VOL_MAX));
+  STEP(S.noteOn(MD_YM2413::CH_SD, (uint8_t)4, (uint8_t)0, MD_YM2413::VOL_MAX, 500));
+  STEP(S.suspend());
+  STEP(S.setVolume(1, 6));
+  STEP(S.noteOn(2, (uint8_t)4, (uint8_t)7, 10));   // key on held back
+  STEP(S.noteOff(MD_YM2413::CH_HH));
+  STEP(S.resume());   // BD is set idle, SD keyed on again
+  STEP(S.noteOff(0));
+  STEP(S.noteOff(1));
+  STEP(S.noteOff(2));
+  STEP(S.noteOff(MD_YM2413::CH_SD));
+}
+
+void testMIDI(void)
+// MIDI channel messages
+{
+  STEP(S.setPercussion(true));
+  STEP(M.begin());
+  STEP(M.programChange(0, 0));
+  STEP(M.programChange(1, 33));
+  STEP(M.noteOn(0, 60, 100));
+  STEP(M.noteOn(0, 64, 90));
+  STEP(M.noteOn(0, 67, 80));
+  STEP(M.noteOn(1, 36, 127));
+  STEP(M.noteOn(9, 36, 127));
+  STEP(M.noteOn(9, 38, 100));
+  STEP(M.noteOn(9, 42, 64));
+  STEP(M.pitchBend(0, 0x3000));
+  STEP(M.controlChange(0, 7, 64));
+  STEP(M.controlChange(1, 11, 32));
+  STEP(M.noteOff(0, 64));
+  STEP(M.noteOff(9, 36));
+  STEP(M.process(0x80, 60, 0));
+  STEP(M.process(0x90, 72, 0));   // note on with velocity 0 is note off
+  STEP(M.allNotesOff(0));
+  STEP(M.allNotesOff(1));
+  STEP(M.allNotesOff(9));
+}
+
+// Test table
+struct test_t
+{
+  char name[12];          // test name
+  void (*f)(void);        // test script
+  uint16_t crc;           // expected CRC
+};
+
+const test_t PROGMEM tests[] =
+{
+  { "Melody",     testMelody,     0xB913 },
+  { "Percussion", testPercussion, 0x6D2C },
+  { "Custom",     testCustom,     0xC1C1 },
+  { "Raw",        testRaw,        0x95CD },
+  { "MIDI",       testMIDI,       0x5203 },
+  { "Suspend",    testSuspend,    0xCDDB },
+  { "Block",      testBlock,      0xC557 },
+};
+
+// Code -------------------------------
+uint16_t crcUpdate(uint16_t c, uint8_t data)
+// CRC-16/CCITT, polynomial 0x1021
+{
+  c ^= (uint16_t)data << 8;
+  for (uint8_t i = 0; i < 8; i++)
+    c = (c & 0x8000) ? (c << 1) ^ 0x1021 : (c << 1);
+
+  return(c);
+}
+
+void recordWrite(uint8_t addr, uint8_t data)
+// Register write hook to record the stream
+{
+  if (addr != lastAddr) countAddr++;
+  lastAddr = addr;
+  countData++;
+
+  crc = crcUpdate(crc, step >> 8);
+  crc = crcUpdate(crc, step & 0xff);
+  crc = crcUpdate(crc, addr);
+  crc = crcUpdate(crc, data);
+
+#if TRACE
+  Serial.print(F("\n"));
+  Serial.print(step);
+  Serial.print(F("\t0x"));
+  if (addr < 0x10) Serial.print(F("0"));
+  Serial.print(addr, HEX);
+  Serial.print(F("\t0x"));
+  if (data < 0x10) Serial.print(F("0"));
+  Serial.print(data, HEX);
+#endif
+}
+
+void runTest(const test_t* pt)
+// Run the test script from the initialized device and check the result
+{
+  test_t t;
+
+  memcpy_P(&t, pt, sizeof(test_t));
+
+  step = 0;
+  crc = 0xffff;
+  countData = countAddr = 0;
+  lastAddr = 0xff;
+
+  Serial.print(F("\n"));
+  Serial.print(t.name);
+  S.setWriteHook(recordWrite);
+  S.begin();
+  t.f();
+  S.setWriteHook(nullptr);
+
+  Serial.print(F("\t"));
+  Serial.print(countData);
+  Serial.print(F("\t"));
+  Serial.print(countAddr);
+  Serial.print(F("\t"));
+  Serial.print((((countAddr * CYCLES_ADDR) + (countData * CYCLES_DATA)) * 1000UL) / (CLOCK_HZ / 1000));
+  Serial.print(F("\t0x"));
+  Serial.print(crc, HEX);
+  Serial.print(F("\t0x"));
+  Serial.print(t.crc, HEX);
+  Serial.print(F("\t"));
+  if (crc != t.crc)
+  {
+    Serial.print(F("FAIL"));
+    fail = true;
+  }
+  else
+    Serial.print(F("PASS"));
+}
+
+void setup(void)
+{
+  Serial.begin(57600);
+  Serial.print(F("\n[MD_YM2413 Register Check]"));
+  Serial.print(F("\n\nTest\twrites\taddr\tbus us\tCRC\texpect\tcheck"));
+
+  for (uint8_t i = 0; i < ARRAY_SIZE(tests); i++)
+    runTest(&tests[i]);
+
+  Serial.print(fail ? F("\n\nFAILED") : F("\n\nPASSED"));
+}
+
+void loop(void) {}
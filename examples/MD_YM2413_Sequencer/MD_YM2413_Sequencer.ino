@@ -0,0 +1,112 @@
+// Play a tracker style song using the pattern sequencer.
+//
+// Example program for the MD_YM2413 library.
+//
+// The song is a short loop of melody, bass and drums held as patterns
+// in PROGMEM. Each time the song ends the tick timing statistics are
+// printed and the tempo is increased, to show the timing jitter as the
+// tick rate goes up.
+//
+
+#include <MD_YM2413.h>
+#include <MD_YM2413_Seq.h>
+
+// Hardware Definitions ---------------
+// All the pins directly connected to D0-D7 on the IC, in sequential order
+// so that pin D_PIN[0] is connected to D0, D_PIN[1] to D1, etc.
+const uint8_t D_PIN[] = { 8, 9, 7, 6, A0, A1, A2, A3 };
+const uint8_t WE_PIN = 5;     // Arduino pin connected to the IC WE pin
+const uint8_t A0_PIN = 4;     // Arduino pin connected to the A0 pin
+
+// Global Data ------------------------
+MD_YM2413 S(D_PIN, WE_PIN, A0_PIN);
+MD_YM2413_Seq Q(S);
+
+const uint8_t BPM_START = 100;
+const uint8_t BPM_STEP = 25;
+const uint8_t SPEED = 3;      // ticks per row
+
+// Song Data --------------------------
+// Pattern cell helpers
+#define NOTE(ch, o, n)    ((ch) | MD_YM2413_Seq::CELL_NOTE), (((o) << 4) | (n))
+#define NOTEI(ch, o, n, i, v) ((ch) | MD_YM2413_Seq::CELL_NOTE | MD_YM2413_Seq::CELL_INST | MD_YM2413_Seq::CELL_VOL), (((o) << 4) | (n)), (i), (v)
+#define NOTEFX(ch, o, n, fx, p) ((ch) | MD_YM2413_Seq::CELL_NOTE | MD_YM2413_Seq::CELL_FX), (((o) << 4) | (n)), (fx), (p)
+#define OFF(ch)           ((ch) | MD_YM2413_Seq::CELL_NOTE), MD_YM2413_Seq::NOTE_OFF
+#define DRUM(ch)          ((ch) | MD_YM2413_Seq::CELL_NOTE), 0
+#define END(skip)         (MD_YM2413_Seq::ROW_END | ((skip) << 4))
+
+// Channels
+const uint8_t MEL = 0;
+const uint8_t BASS = 1;
+const uint8_t HH = MD_YM2413::CH_HH;
+const uint8_t SD = MD_YM2413::CH_SD;
+const uint8_t BD = MD_YM2413::CH_BD;
+
+const uint8_t PROGMEM patIntro[] =
+{
+  16,   // rows
+  NOTEI(BASS, 2, 0, MD_YM2413::I_SYNTH_BASS, 15), DRUM(BD), DRUM(HH), END(1),
+  DRUM(HH), END(1),
+  DRUM(SD), DRUM(HH), END(1),
+  DRUM(HH), END(1),
+  NOTE(BASS, 2, 7), DRUM(BD), DRUM(HH), END(1),
+  DRUM(HH), END(1),
+  DRUM(SD), DRUM(HH), END(1),
+  DRUM(HH), DRUM(BD), END(1),
+};
+
+const uint8_t PROGMEM patMelody[] =
+{
+  16,   // rows
+  NOTEI(MEL, 4, 0, MD_YM2413::I_VIBRAPHONE, 14), NOTE(BASS, 2, 0), DRUM(BD), DRUM(HH), END(1),
+  NOTE(MEL, 4, 4), DRUM(HH), END(1),
+  NOTE(MEL, 4, 7), DRUM(SD), DRUM(HH), END(1),
+  NOTEFX(MEL, 5, 0, MD_YM2413_Seq::FX_SLIDE_DOWN, 4), DRUM(HH), END(1),
+  NOTE(MEL, 4, 9), NOTE(BASS, 2, 5), DRUM(BD), DRUM(HH), END(1),
+  NOTE(MEL, 4, 7), DRUM(HH), END(1),
+  NOTEFX(MEL, 4, 5, MD_YM2413_Seq::FX_ARPEGGIO, 0x47), DRUM(SD), DRUM(HH), END(0),
+  OFF(MEL), END(0),
+  DRUM(HH), DRUM(BD), END(0),
+  OFF(BASS), END(0),
+};
+
+const uint8_t* const PROGMEM song[] = { patIntro, patMelody, patMelody, patIntro };
+
+// Code -------------------------------
+void setup(void)
+{
+  Serial.begin(57600);
+  Serial.print(F("\n[MD_YM2413 Sequencer]"));
+
+  S.begin();
+  S.setPercussion(true);
+  Q.begin();
+  Q.setSong(song, ARRAY_SIZE(song));
+}
+
+void loop(void)
+{
+  static uint8_t bpm = BPM_START;
+
+  if (!Q.run())
+  {
+    // print the statistics for the last play
+    if (Q.getJitterMax() != 0)
+    {
+      Serial.print(F("\nJitter max "));
+      Serial.print(Q.getJitterMax());
+      Serial.print(F("us avg "));
+      Serial.print(Q.getJitterAvg());
+      Serial.print(F("us late "));
+      Serial.print(Q.getLate());
+      bpm = (bpm > 255 - BPM_STEP) ? BPM_START : bpm + BPM_STEP;
+    }
+
+    // start the next play
+    Serial.print(F("\nBPM "));
+    Serial.print(bpm);
+    Q.resetStats();
+    Q.setTempo(bpm, SPEED);
+    Q.start();
+  }
+}
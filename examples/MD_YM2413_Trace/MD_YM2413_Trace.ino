@@ -0,0 +1,108 @@
+// Trace the library while it plays, and dump the trace between phrases.
+//
+// Example program for the MD_YM2413 library.
+//
+// A short phrase of timed notes is played using run(), with a bend on the
+// last note and a pause in the middle. The library logs its events into
+// the trace buffer as it plays, and this sketch logs a user event at the
+// start of each phrase. Between phrases, when the timing does not matter,
+// the trace is dumped to the Serial Monitor.
+//
+// Capture the Serial Monitor output into a file and decode it on the host
+//   python extras/YM2413_TraceDecode.py capture.txt
+//
+// The library must be compiled with LIB_TRACE set to the number of trace
+// records (eg, 64). See the library documentation.
+//
+
+#include <MD_YM2413.h>
+#include <MD_YM2413_Trace.h>
+
+// Hardware Definitions ---------------
+// All the pins directly connected to D0-D7 on the IC, in sequential order
+// so that pin D_PIN[0] is connected to D0, D_PIN[1] to D1, etc.
+const uint8_t D_PIN[] = { 8, 9, 7, 6, A0, A1, A2, A3 };
+const uint8_t WE_PIN = 5;     // Arduino pin connected to the IC WE pin
+const uint8_t A0_PIN = 4;     // Arduino pin connected to the A0 pin
+
+// Miscellaneous
+const uint8_t NOTES[] = { 0, 4, 7, 12 };  // phrase notes from the root
+const uint16_t NOTE_TIME = 250;           // note duration in ms
+const uint16_t PAUSE_TIME = 300;          // pause after the second note
+const uint16_t PHRASE_GAP = 1000;         // time between phrases in ms
+
+// Global Data ------------------------
+MD_YM2413 S(D_PIN, WE_PIN, A0_PIN);
+
+#if LIB_TRACE
+const uint8_t EV_PHRASE = MD_YM2413_Trace::EV_USER;   // start of a phrase, arg is the phrase number
+
+// Code -------------------------------
+void playPhrase(uint8_t phrase)
+// Play the phrase on channel 0, keeping the library running
+{
+  bool paused = false;
+  uint32_t t;
+
+  MD_YM2413_Trace::log(EV_PHRASE, 0, phrase);
+
+  for (uint8_t i = 0; i < ARRAY_SIZE(NOTES); i++)
+  {
+    uint8_t n = (phrase % 12) + NOTES[i];
+
+    S.noteOn(0, (uint8_t)(4 + n / 12), (uint8_t)(n % 12), MD_YM2413::VOL_MAX, NOTE_TIME);
+    if (i == ARRAY_SIZE(NOTES) - 1)
+      S.bendNote(0, 128);   // quarter tone up
+
+    while (!S.isIdle(0))
+    {
+      S.run();
+
+      if (i == 1 && !paused && S.getRemaining(0) < NOTE_TIME / 2)
+      {
+        // pause half way through the second note
+        paused = true;
+        S.suspend();
+        t = millis();
+        while (millis() - t < PAUSE_TIME)
+          S.run();
+        S.resume();
+      }
+    }
+  }
+}
+
+void setup(void)
+{
+  Serial.begin(57600);
+  Serial.print(F("\n[MD_YM2413 Trace]"));
+
+  S.begin();
+  S.setInstrument(0, MD_YM2413::I_FLUTE);
+  MD_YM2413_Trace::clear();   // skip the begin() writes
+}
+
+void loop(void)
+{
+  static uint8_t phrase = 0;
+  uint32_t t;
+
+  playPhrase(phrase++);
+
+  // the timing no longer matters, so dump the trace
+  MD_YM2413_Trace::dump(Serial);
+
+  t = millis();
+  while (millis() - t < PHRASE_GAP)
+    S.run();
+}
+#else
+void setup(void)
+{
+  Serial.begin(57600);
+  Serial.print(F("\n[MD_YM2413 Trace]"));
+  Serial.print(F("\nSet LIB_TRACE in the library to use this example"));
+}
+
+void loop(void) {}
+#endif
@@ -0,0 +1,116 @@
+// Record the library output to a VGM file on the SD card.
+//
+// Example program for the MD_YM2413 library.
+// Plays a short tune and records all the register writes to the 
+// YM2413 in the file CAPTURE.VGM. The file can be played back with 
+// the VGM Player CLI example or any standard VGM player.
+//
+// Dependencies
+// SDFat at https://github.com/greiman?tab=repositories
+//
+// VGM file format at https://vgmrips.net/wiki/VGM_Specification
+
+#include <SdFat.h>
+#include <MD_YM2413.h>
+#include <MD_YM2413_VGM.h>
+
+// Hardware Definitions ---------------
+// All the pins directly connected to D0-D7 on the IC, in sequential order 
+// so that pin D_PIN[0] is connected to D0, D_PIN[1] to D1, etc.
+const uint8_t D_PIN[] = { 8, 9, 7, 6, A0, A1, A2, A3 };
+const uint8_t WE_PIN = 5;     // Arduino pin connected to the IC WE pin
+const uint8_t A0_PIN = 4;     // Arduino pin connected to the A0 pin
+
+// SD chip select pin for SPI comms.
+const uint8_t SD_SELECT = 10;
+
+const char FILE_NAME[] = "CAPTURE.VGM";
+
+// Tune to play as octave/note pairs and the duration for each note
+const uint8_t tune[][2] = 
+{ 
+  {4, 0}, {4, 2}, {4, 4}, {4, 5}, {4, 7}, {4, 9}, {4, 11}, {5, 0},
+  {5, 0}, {4, 11}, {4, 9}, {4, 7}, {4, 5}, {4, 4}, {4, 2}, {4, 0},
+};
+const uint16_t NOTE_TIME = 300;   // in ms
+
+// Global Data ------------------------
+SdFat SD;
+SdFile FD;
+MD_YM2413 S(D_PIN, WE_PIN, A0_PIN);
+
+void vgmOutput(uint32_t offset, const uint8_t* data, uint16_t len)
+// VGM recorder output goes to the SD file
+{
+  FD.seekSet(offset);
+  FD.write(data, len);
+}
+
+MD_YM2413_VGM V(vgmOutput);
+
+void vgmHook(uint8_t addr, uint8_t data)
+// All register writes are recorded
+{
+  V.write(addr, data);
+}
+
+void setup(void)
+{
+  Serial.begin(57600);
+  Serial.print(F("\n[MD_YM2413 VGM Capture]"));
+
+  // Initialize SD
+  if (!SD.begin(SD_SELECT, SPI_FULL_SPEED))
+  {
+    Serial.print(F("\nSD init fail!"));
+    while (true);
+  }
+
+  if (!FD.open(FILE_NAME, O_RDWR | O_CREAT | O_TRUNC))
+  {
+    Serial.print(F("\nFile open fail!"));
+    while (true);
+  }
+
+  // Start recording before the device is initialized
+  // so that all the setup is included in the file. The
+  // header has the clock the library is working with.
+  S.setWriteHook(vgmHook);
+  V.begin(S.getClock());
+
+  S.begin();
+  S.setInstrument(0, MD_YM2413::I_PIANO);
+  S.setInstrument(1, MD_YM2413::I_ACOUSTIC_BASS);
+}
+
+void loop(void)
+{
+  static uint8_t idx = 0;
+  static uint32_t timeStart = 0;
+
+  S.run();
+
+  if (!V.isRecording())
+    return;
+
+  if (millis() - timeStart < NOTE_TIME)
+    return;
+
+  if (idx < ARRAY_SIZE(tune))
+  {
+    S.noteOn(0, tune[idx][0], tune[idx][1], MD_YM2413::VOL_MAX, NOTE_TIME - 50);
+    S.noteOn(1, tune[idx][0] - 2, tune[idx][1], MD_YM2413::VOL_MAX, NOTE_TIME - 50);
+    idx++;
+    timeStart = millis();
+  }
+  else
+  {
+    V.end("Scale", "MD_YM2413");
+    S.setWriteHook(nullptr);
+    FD.close();
+    Serial.print(F("\nRecorded "));
+    Serial.print(V.getSamples());
+    Serial.print(F(" samples to "));
+    Serial.print(FILE_NAME);
+  }
+}
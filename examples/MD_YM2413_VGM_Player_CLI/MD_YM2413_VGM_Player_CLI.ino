@@ -7,6 +7,10 @@
 // SDFat at https://github.com/greiman?tab=repositories
 // MD_cmdProcessor at https://github.com/MajicDesigns/MD_cmdProcessor
 //
+// Dual YM2413 VGM files (bit 30 of the clock set, 0xA1 writes) are played
+// on a second IC if one is fitted (see DUAL_CHIP_HW), otherwise only the
+// first chip is played.
+//
 // VGM file format at https://vgmrips.net/wiki/VGM_Specification
 // VGM sound files at https://vgmrips.net/packs/chip/ym2413
 
@@ -25,28 +29,67 @@ const uint8_t D_PIN[] = { 8, 9, 7, 6, A0, A1, A2, A3 };
 const uint8_t WE_PIN = 5;     // Arduino pin connected to the IC WE pin
 const uint8_t A0_PIN = 4;     // Arduino pin connected to the A0 pin
 
+// Optional second YM2413 for dual chip VGM files. The second IC shares 
+// the data and A0 lines with the first and only needs its own WE pin.
+// Set DUAL_CHIP_HW to 0 if the second IC is not fitted - files for dual 
+// chips will then play the first chip only.
+#define DUAL_CHIP_HW 1
+const uint8_t WE2_PIN = 3;    // Arduino pin connected to the second IC WE pin
+
 // SD chip select pin for SPI comms.
 const uint8_t SD_SELECT = 10;
 
 // Miscellaneous
 void(*hwReset) (void) = 0;            // declare reset function @ address 0
-const uint16_t SAMPLE_uS = 23; // 1e6 us/sec at 44100 samples/sec = 22.67us per sample
+const uint32_t VGM_SAMPLE_RATE = 44100;     // VGM wait commands are in 44100 samples/sec
+const uint32_t VGM_DUAL_CHIP = 0x40000000;  // bit 30 of the clock field flags a second chip
+const uint32_t VGM_CLOCK_MASK = 0x3fffffff; // remaining clock field bits
+const uint16_t FADE_TIME = 300;             // fade out time in ms when stopped
 
 // Global Data ------------------------
 SdFat SD;
 SdFile FD;    // file descriptor
 MD_YM2413 S(D_PIN, WE_PIN, A0_PIN);
+#if DUAL_CHIP_HW
+MD_YM2413 S2(D_PIN, WE2_PIN, A0_PIN);
+#endif
 
 uint32_t dataOffset = 0;    // offset to start of music data in VGM file
 bool playingVGM = false;    // flag true when in playing mode
+bool dualChip = false;      // true when the file uses and we have a second chip
 uint32_t loopCount = 0;     // loop count for the section to be looped
 uint32_t loopOffset = 0;    // loop offset into the file
 
+uint32_t timeNext = 0;      // micros() time the next command is due
+uint16_t timeRemainder = 0; // fractional microseconds carried between waits
+
+void waitVGM(uint32_t samples)
+// Move the time for the next command forward by the number of samples.
+// The time is accumulated from the start of the tune rather than from 
+// when the wait is processed, so the time spent writing to the chip(s)
+// is absorbed into the wait and the tempo does not drift.
+{
+  uint32_t t = (samples * 10000UL) + timeRemainder;   // 1e6/44100 = 10000/441
+
+  timeNext += t / (VGM_SAMPLE_RATE / 100);
+  timeRemainder = t % (VGM_SAMPLE_RATE / 100);
+}
+
+void skipVGM(uint32_t count)
+// skip over bytes in the file
+{
+  FD.seekCur(count);
+}
+
 void playVGM(void)
 {
-  uint32_t samples = 0;
-  int cmd = FD.read();
+  int cmd;
+
+  // nothing to do until the current wait has expired
+  if ((int32_t)(micros() - timeNext) < 0)
+    return;
 
+  cmd = FD.read();
   if (cmd == -1) cmd = 0x66;    // make this stop
   
   switch (cmd)
@@ -59,23 +102,52 @@ void playVGM(void)
       }
       break;
 
+    case 0xa1: // 0xa1 aa dd : second YM2413, write value dd to register aa
+      {
+        uint8_t aa = FD.read();
+        uint8_t dd = FD.read();
+#if DUAL_CHIP_HW
+        if (dualChip) S2.write(aa, dd);
+#endif
+      }
+      break;
+
     case 0x61: // 0x61 nn nn : Wait n samples, n can range from 0 to 65535
-      samples = FD.read() & 0x00FF;
-      samples |= (FD.read() << 8) & 0xFF00;
-      delay((samples * SAMPLE_uS) / 1000);
+      {
+        uint16_t samples = FD.read() & 0x00FF;
+        samples |= (FD.read() << 8) & 0xFF00;
+        waitVGM(samples);
+      }
       break;
 
     case 0x62: // wait 735 samples (60th of a second)
-      delay(17);  // SAMPLE_uS * 735 = 16.905ms
+      waitVGM(735);
       break;
 
     case 0x63: // wait 882 samples (50th of a second)
-      delay(20);  // SAMPLE_uS * 882 = 20.286ms
+      waitVGM(882);
       break;
 
     case 0x70 ... 0x7f: // 0x7n : wait n+1 samples, n can range from 0 to 15
-      samples = cmd + 0x70 + 1;
-      delayMicroseconds(samples * SAMPLE_uS);
+      waitVGM((cmd & 0x0f) + 1);
+      break;
+
+    case 0x80 ... 0x8f: // 0x8n : YM2612 DAC write then wait n samples
+      waitVGM(cmd & 0x0f);
+      break;
+
+    case 0x67: // 0x67 0x66 tt ss ss ss ss : data block, skip it
+      {
+        uint32_t size;
+
+        FD.read();  // 0x66
+        FD.read();  // data type
+        size = FD.read() & 0xff;
+        size |= ((uint32_t)(FD.read() & 0xff) << 8);
+        size |= ((uint32_t)(FD.read() & 0xff) << 16);
+        size |= ((uint32_t)(FD.read() & 0xff) << 24);
+        skipVGM(size);
+      }
       break;
 
     case 0x66: // 0x66 : end of sound data
@@ -91,6 +163,12 @@ void playVGM(void)
         handlerS(nullptr);    // end it now
       break;
 
+    // Commands for other chips are skipped by their operand size
+    case 0x30 ... 0x3f: case 0x4f: case 0x50: skipVGM(1); break;
+    case 0x40 ... 0x4e: case 0x52 ... 0x5f: case 0xa0: case 0xa2 ... 0xbf: skipVGM(2); break;
+    case 0xc0 ... 0xdf: skipVGM(3); break;
+    case 0xe0 ... 0xff: skipVGM(4); break;
+
     default:
 #if SHOW_MORE_INFO
       Serial.print(F("\nUnhandled 0x")); 
@@ -148,10 +226,22 @@ uint16_t checkVGMHeader(char* file)
   Serial.print(F("\nVGM version: 0x"));
   Serial.print(version, HEX);
 
-  // verify YM2413 clock speed (0x10)
+  // verify YM2413 clock speed (0x10) and check for a second chip
   x = readVGMDword(0x10);
   Serial.print(F("\nYM2413 clock: "));
-  Serial.print(x);
+  Serial.print(x & VGM_CLOCK_MASK);
+  if ((x & VGM_CLOCK_MASK) == 0)
+  {
+    Serial.print(F("\nNo YM2413 data"));
+    return(0);
+  }
+#if DUAL_CHIP_HW
+  dualChip = ((x & VGM_DUAL_CHIP) != 0);
+#else
+  dualChip = false;
+#endif
+  if (x & VGM_DUAL_CHIP)
+    Serial.print(dualChip ? F(" x2") : F(" x2 (playing first only)"));
 
   // get the relative data offset value (0x34)
   if (version < 0x150)
@@ -184,6 +274,8 @@ uint16_t checkVGMHeader(char* file)
 
   // set up the next character read to be at start of data
   FD.seekSet(offset);
+  timeNext = micros();
+  timeRemainder = 0;
 
   return(offset);
 }
@@ -193,9 +285,12 @@ void handlerHelp(char* param); // function prototype only
 void handlerZ(char *param) { hwReset(); }
 
 void handlerS(char* param)
-// Stop play
+// Stop play, fading out whatever is still sounding
 { 
-  S.setVolume(MD_YM2413::VOL_OFF);
+  S.mute(FADE_TIME);
+#if DUAL_CHIP_HW
+  S2.mute(FADE_TIME);
+#endif
   playingVGM = false;
   FD.close();
   Serial.print(F("\nStopped."));
@@ -208,6 +303,13 @@ void handlerP(char *param)
   Serial.print(param);
   dataOffset = checkVGMHeader(param); // load the new file
   playingVGM = (dataOffset != 0);
+  if (playingVGM)   // undo any fade from the last stop
+  {
+    S.fadeTo(MD_YM2413::VOL_MAX, 0);
+#if DUAL_CHIP_HW
+    S2.fadeTo(MD_YM2413::VOL_MAX, 0);
+#endif
+  }
 }
 
 void handlerF(char *param)
@@ -261,6 +363,10 @@ void setup(void) // This is run once at power on
   // Initialise YM2413
   S.begin();
   S.setVolume(MD_YM2413::VOL_OFF);
+#if DUAL_CHIP_HW
+  S2.begin();
+  S2.setVolume(MD_YM2413::VOL_OFF);
+#endif
 
   // Initialize SD
   if (!SD.begin(SD_SELECT, SPI_FULL_SPEED))
@@ -282,4 +388,9 @@ void loop(void)
     playVGM();
   // else
     CP.run();  // process the User Interface
+
+  S.run();     // run the fades
+#if DUAL_CHIP_HW
+  S2.run();
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,219 @@
+#!/usr/bin/env python3
+"""
+Map a bank of OPL2 patches onto the 15 YM2413 ROM instruments.
+
+The YM2413 has only one custom instrument, so every MIDI program played
+with its own OPL2 patch costs an 8 register reload of the custom
+instrument each time it is used. This tool converts each OPL2 patch to
+the YM2413 format in the same way as MD_YM2413::loadInstrumentOPL2(),
+measures how far it is from each ROM instrument, and prints
+- a PROGMEM table of the closest ROM instrument for each program, for
+  MD_YM2413_MIDI::setInstrumentMap().
+- a PROGMEM list of the programs that are too far from every ROM
+  instrument and really need the custom instrument.
+
+The distance is worked out from the instrument parameters, weighted by
+how much they change the sound - the carrier envelope and wave form the
+most, then the frequency ratio and modulation depth (brightness), and the
+modulator envelope and the other settings the least.
+
+The ROM instruments are read from the library MD_YM2413_Emu.cpp and the
+instrument names from MD_YM2413.h, so the tool follows the library.
+
+Usage: python YM2413_PatchMap.py [-t THRESHOLD] [-c] [-v] [bank.h]
+  bank.h      OPL2 bank in the midi_instruments.h format (default is the
+              MD_YM2413_Custom example bank).
+  -t          distance above which a program needs the custom instrument.
+  -c          put I_CUSTOM in the table for the programs that need it.
+  -v          print the distance to every ROM instrument for each program.
+
+Part of the MD_YM2413 library.
+"""
+
+import argparse
+import math
+import os
+import re
+import sys
+
+LIB = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..")
+DEF_BANK = os.path.join(LIB, "examples", "MD_YM2413_Custom", "midi_instruments.h")
+EMU_SRC = os.path.join(LIB, "src", "MD_YM2413_Emu.cpp")
+LIB_HDR = os.path.join(LIB, "src", "MD_YM2413.h")
+
+ROM_INSTRUMENTS = 15
+DEF_THRESHOLD = 0.45
+
+# Frequency multiplier for each MULT value
+MULT = [0.5, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 10, 12, 12, 15, 15]
+
+# Parameter weights, applied to the difference scaled to [0..1]
+W_CAR_ENV = {"ar": 2.0, "dr": 1.5, "sl": 1.0, "rr": 0.8}
+W_MOD_ENV = {"ar": 0.6, "dr": 0.6, "sl": 0.4, "rr": 0.2}
+W_CAR_EGT = 1.5     # sustained or decaying note
+W_CAR_MULT = 1.5    # pitch of the note
+W_RATIO = 1.5       # modulator to carrier frequency ratio (harmonics)
+W_DEPTH = 1.5       # modulation depth (brightness)
+W_FB = 0.5          # modulator feedback
+W_WAVE = 0.8        # half sine wave forms
+W_MISC = 0.3        # AM, vibrato, key scale rate and level
+
+
+def read_file(name):
+    with open(name) as f:
+        return f.read()
+
+
+def rom_patches():
+    """ROM instrument register data [1..15] from the emulator source."""
+    src = read_file(EMU_SRC)
+    block = re.search(r"_patch\[\]\s*=\s*\{(.*?)\};", src, re.S).group(1)
+    rows = [[int(v, 16) for v in re.findall(r"0x([0-9a-fA-F]{2})", line)]
+            for line in block.splitlines()]
+    rows = [r for r in rows if len(r) == 8]
+    return rows[1:ROM_INSTRUMENTS + 1]
+
+
+def rom_names():
+    """instrument_t names for the ROM instruments [1..15]."""
+    hdr = read_file(LIB_HDR)
+    names = {}
+    for name, value in re.findall(r"\b(I_\w+)\s*=\s*(\d+)\s*,", hdr):
+        names[int(value)] = name
+    return [names[i] for i in range(1, ROM_INSTRUMENTS + 1)]
+
+
+def opl2_bank(name):
+    """(name, 12 bytes) for each program in the order of midiInstruments[]."""
+    src = read_file(name)
+    patches = {}
+    for pname, data in re.findall(r"const uint8_t (\w+)\[\]\s*PROGMEM\s*=\s*\{([^}]*)\}", src):
+        patches[pname] = [int(v, 16) for v in re.findall(r"0x([0-9a-fA-F]{2})", data)]
+
+    order = re.search(r"midiInstruments\[\]\s*=\s*\{(.*?)\}", src, re.S)
+    if order is None:
+        sys.exit("No midiInstruments[] table in " + name)
+    return [(p, patches[p]) for p in re.findall(r"\w+", order.group(1))]
+
+
+def convert_opl2(inst):
+    """The same conversion as MD_YM2413::loadInstrumentOPL2()."""
+    data = [0] * 8
+    data[0] = inst[1]
+    data[1] = inst[7]
+    data[2] = inst[2]
+    data[4] = inst[3]
+    data[5] = inst[9]
+    data[6] = inst[4]
+    data[7] = inst[10]
+
+    data[3] = inst[8] & 0xe0
+    data[3] |= ((inst[11] * 0x0e) >> 1) & 0xff
+    if inst[9] & 0x7 in (1, 2, 3, 5):
+        data[3] |= (1 << 4)
+    if inst[8] & 0x7 in (1, 2, 3, 5):
+        data[3] |= (1 << 3)
+    return [d & 0xff for d in data]
+
+
+def params(reg):
+    """Instrument parameters from the register data."""
+    p = {}
+    for op, r in (("mod", 0), ("car", 1)):
+        p[op] = {
+            "am": (reg[r] >> 7) & 1,
+            "vib": (reg[r] >> 6) & 1,
+            "egt": (reg[r] >> 5) & 1,
+            "ksr": (reg[r] >> 4) & 1,
+            "mult": reg[r] & 0xf,
+            "ar": reg[4 + r] >> 4,
+            "dr": reg[4 + r] & 0xf,
+            "sl": reg[6 + r] >> 4,
+            "rr": reg[6 + r] & 0xf,
+        }
+    p["mod"]["ksl"] = reg[2] >> 6
+    p["car"]["ksl"] = reg[3] >> 6
+    p["tl"] = reg[2] & 0x3f
+    p["dc"] = (reg[3] >> 4) & 1
+    p["dm"] = (reg[3] >> 3) & 1
+    p["fb"] = reg[3] & 0x7
+    return p
+
+
+def distance(a, b):
+    """Weighted parameter distance between two instruments."""
+    d = 0.0
+
+    for k, w in W_CAR_ENV.items():
+        d += w * ((a["car"][k] - b["car"][k]) / 15.0) ** 2
+    for k, w in W_MOD_ENV.items():
+        d += w * ((a["mod"][k] - b["mod"][k]) / 15.0) ** 2
+    d += W_CAR_EGT * (a["car"]["egt"] - b["car"]["egt"]) ** 2
+
+    # pitch and harmonics as octaves, up to 2 octaves apart
+    ca, cb = math.log2(MULT[a["car"]["mult"]]), math.log2(MULT[b["car"]["mult"]])
+    ra = math.log2(MULT[a["mod"]["mult"]]) - ca
+    rb = math.log2(MULT[b["mod"]["mult"]]) - cb
+    d += W_CAR_MULT * (min(abs(ca - cb), 2) / 2) ** 2
+    d += W_RATIO * (min(abs(ra - rb), 2) / 2) ** 2
+
+    # modulation depth, TL is 0.75dB steps, up to 24dB apart
+    d += W_DEPTH * (min(abs(a["tl"] - b["tl"]) * 0.75, 24) / 24) ** 2
+    d += W_FB * ((a["fb"] - b["fb"]) / 7.0) ** 2
+    d += W_WAVE * ((a["dc"] - b["dc"]) ** 2 + (a["dm"] - b["dm"]) ** 2)
+
+    for op in ("mod", "car"):
+        for k in ("am", "vib", "ksr"):
+            d += W_MISC * (a[op][k] - b[op][k]) ** 2
+        d += W_MISC * ((a[op]["ksl"] - b[op]["ksl"]) / 3.0) ** 2
+
+    return math.sqrt(d / 10.0)    # about [0..1]
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Map OPL2 patches onto the YM2413 ROM instruments.")
+    ap.add_argument("bank", nargs="?", default=DEF_BANK, help="OPL2 bank header file")
+    ap.add_argument("-t", "--threshold", type=float, default=DEF_THRESHOLD,
+                    help="distance above which the custom instrument is needed (default %.2f)" % DEF_THRESHOLD)
+    ap.add_argument("-c", "--custom", action="store_true", help="use I_CUSTOM in the table where it is needed")
+    ap.add_argument("-v", "--verbose", action="store_true", help="print all the distances")
+    args = ap.parse_args()
+
+    roms = [params(r) for r in rom_patches()]
+    names = rom_names()
+    bank = opl2_bank(args.bank)
+
+    fit = []
+    for prog, (pname, inst) in enumerate(bank):
+        p = params(convert_opl2(inst))
+        dist = [distance(p, r) for r in roms]
+        best = min(range(len(dist)), key=lambda i: dist[i])
+        fit.append((prog, pname, best, dist[best]))
+        if args.verbose:
+            print("// %3d %-20s %s" % (prog + 1, pname,
+                  " ".join("%.2f" % v for v in dist)))
+
+    custom = [f for f in fit if f[3] > args.threshold]
+
+    print("// Best fit YM2413 ROM instrument for each MIDI program, from")
+    print("// %s" % os.path.basename(args.bank))
+    print("// by YM2413_PatchMap.py. The distance from the OPL2 patch is shown")
+    print("// for each program, those over %.2f need the custom instrument." % args.threshold)
+    print("const uint8_t PROGMEM midiIMap[] =")
+    print("{")
+    for prog, pname, best, dist in fit:
+        instr = "I_CUSTOM" if args.custom and dist > args.threshold else names[best]
+        mark = " *" if dist > args.threshold else ""
+        print("  MD_YM2413::%-20s // %3d %s %.2f%s" % (instr + ",", prog + 1, pname, dist, mark))
+    print("};")
+    print()
+    print("// %d MIDI programs (numbered from 0) that need the custom instrument" % len(custom))
+    print("const uint8_t PROGMEM midiCustom[] =")
+    print("{")
+    for i in range(0, len(custom), 8):
+        print("  " + " ".join("%3d," % f[0] for f in custom[i:i + 8]))
+    print("};")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+"""
+Decode an MD_YM2413 trace buffer dump.
+
+The dump is printed by MD_YM2413_Trace::dump() and captured from the
+Serial Monitor into a text file. Each dump starts with a header line
+"#YM2413 TRACE <version> <lost>" and ends with "#END". Each record in
+between is one line "tttttttt ee cc aaaa" in hex - the micros() time,
+event identifier, channel and argument. Any other lines in the capture
+(eg, the sketch output) are skipped.
+
+Usage: python YM2413_TraceDecode.py [capture.txt]
+       Reads from stdin if no file is given.
+
+Part of the MD_YM2413 library.
+"""
+
+import re
+import sys
+
+TRACE_VERSION = 1
+EV_USER = 0x80
+
+NOTES = ["C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B"]
+PERC = {6: "HH", 7: "TCY", 8: "TOM", 9: "SD", 10: "BD"}
+
+RE_HEADER = re.compile(r"#YM2413 TRACE (\d+) (\d+)")
+RE_RECORD = re.compile(r"^([0-9A-Fa-f]{8}) ([0-9A-Fa-f]{2}) ([0-9A-Fa-f]{2}) ([0-9A-Fa-f]{4})$")
+
+
+def chan_name(c):
+    return "C%d" % c + ("/" + PERC[c] if c in PERC else "")
+
+
+def block_fnum(a):
+    return "block %d F-Num %d" % (a >> 9, a & 0x1ff)
+
+
+def reg_name(addr, data):
+    """Register name and decoded data for a register write."""
+    if addr < 0x08:
+        return "custom[%d] = 0x%02X" % (addr, data)
+    if addr == 0x0e:
+        keys = [n for b, n in ((4, "BD"), (3, "SD"), (2, "TOM"), (1, "TCY"), (0, "HH")) if data & (1 << b)]
+        return "rhythm %s keys %s" % ("on" if data & 0x20 else "off", " ".join(keys) if keys else "-")
+    if addr == 0x0f:
+        return "test = 0x%02X" % data
+    if 0x10 <= addr <= 0x18:
+        return "F-Num low C%d = 0x%02X" % (addr - 0x10, data)
+    if 0x20 <= addr <= 0x28:
+        return "key C%d %s%s block %d F-Num bit 8 %d" % (addr - 0x20,
+            "ON" if data & 0x10 else "off", " sus" if data & 0x20 else "",
+            (data >> 1) & 7, data & 1)
+    if 0x30 <= addr <= 0x38:
+        return "inst/vol C%d = inst %d atten %d" % (addr - 0x30, data >> 4, data & 0xf)
+    return "0x%02X = 0x%02X" % (addr, data)
+
+
+def decode(event, chan, arg):
+    """Text for one trace record."""
+    if event == 1:
+        return "noteOn   %s freq %d" % (chan_name(chan), arg)
+    if event == 2:
+        note = arg & 0xff
+        name = NOTES[note] if note < len(NOTES) else "?"
+        return "noteOn   %s octave %d note %s" % (chan_name(chan), arg >> 8, name)
+    if event == 3:
+        return "  F-Num  %s %s" % (chan_name(chan), block_fnum(arg))
+    if event == 4:
+        return "bendNote %s %s" % (chan_name(chan), block_fnum(arg))
+    if event == 5:
+        return "noteOff  %s" % chan_name(chan)
+    if event == 6:
+        return "  write  0x%02X %s" % (chan, reg_name(chan, arg & 0xff))
+    if event == 7:
+        return "suspend"
+    if event == 8:
+        return "resume"
+    if event == 9:
+        return "MIDI     ch %d note %d -> C%d" % (chan + 1, arg >> 8, arg & 0xff)
+    if event == 10:
+        return "MIDI     ch %d note %d DROPPED" % (chan + 1, arg)
+    if event >= EV_USER:
+        return "user %d   chan %d arg 0x%04X" % (event - EV_USER, chan, arg)
+    return "event %d  chan %d arg 0x%04X" % (event, chan, arg)
+
+
+def main():
+    f = open(sys.argv[1]) if len(sys.argv) > 1 else sys.stdin
+    inDump = False
+    first = last = 0
+
+    for line in f:
+        line = line.strip()
+
+        m = RE_HEADER.match(line)
+        if m:
+            if int(m.group(1)) != TRACE_VERSION:
+                sys.exit("Trace version %s, expected %d" % (m.group(1), TRACE_VERSION))
+            inDump = True
+            first = None
+            print("=== Trace dump, %s records lost before this dump" % m.group(2))
+            print("%10s %8s  %s" % ("time us", "delta", "event"))
+            continue
+
+        if line == "#END":
+            inDump = False
+            continue
+
+        m = RE_RECORD.match(line)
+        if not inDump or not m:
+            continue
+
+        t, event, chan, arg = (int(g, 16) for g in m.groups())
+        if first is None:
+            first = last = t
+        print("%10d %8d  %s" % ((t - first) & 0xffffffff, (t - last) & 0xffffffff, decode(event, chan, arg)))
+        last = t
+
+
+if __name__ == "__main__":
+    main()
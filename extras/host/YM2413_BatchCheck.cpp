@@ -0,0 +1,285 @@
+/*
+Check and time the MD_YM2413_EmuBatch event scheduler.
+
+Each object in the batch plays one of the VGM files named on the command
+line (the VGM_TUNES of the VGM_Player_CLI example), object k playing file
+k modulo the number of files. The same tunes are also rendered on
+separate MD_YM2413_Emu objects, one block at a time with the writes made
+at the sample they are due, which is how the application would render
+them without a batch.
+
+For batch sizes of 1 to BATCH_MAX the table shows
+- the throughput rendering the objects separately and as a batch, in
+  chip-seconds per second (seconds of audio rendered for all the objects
+  in one second), the fastest of 3 runs.
+- the batch throughput against the separate objects.
+- the check result. Every object rendered by render() must have the same
+  samples as it has rendered separately, and the samples from mix() must
+  be the same as the separate samples added together.
+
+The last line gives the throughput of a full batch on each of the host
+cores at the same time.
+
+Usage: YM2413_BatchCheck [-t seconds] file.vgm ...
+  -t  seconds of audio rendered for each object (default 10).
+
+Part of the MD_YM2413 library host build, see extras/host.
+*/
+#include <Arduino.h>
+#include <MD_YM2413_Emu.h>
+#include <MD_YM2413_EmuBatch.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include "YM2413_EmuTools.h"
+
+const uint16_t BLOCK_SIZE = 64;         // samples rendered in each block
+const uint8_t REPEAT = 3;               // times each render is timed, the fastest is used
+const uint8_t BATCH_MAX = MD_YM2413_EmuBatch::BATCH_MAX;
+
+// Event streams ----------------------
+struct stream_t
+{
+  const vgm_t* v;       // the tune
+  size_t w;             // next write
+  uint32_t pos;         // emulator sample the stream has reached
+};
+
+thread_local stream_t* streams;   // streams for the batch being rendered
+
+void startStreams(stream_t* s, const std::vector<vgm_t>& tunes)
+{
+  for (uint8_t k = 0; k < BATCH_MAX; k++)
+    s[k] = stream_t{ &tunes[k % tunes.size()], 0, 0 };
+  streams = s;
+}
+
+uint16_t nextEvent(uint8_t inst, MD_YM2413_Emu& emu)
+// Make the writes due now and return the samples to the next ones
+{
+  stream_t& s = streams[inst];
+  const std::vector<vgmWrite_t>& wr = s.v->writes;
+  uint32_t next;
+
+  while (s.w < wr.size() && ((uint64_t)wr[s.w].sample * emu.getSampleRate()) / VGM_SAMPLE_RATE <= s.pos)
+  {
+    emu.write(wr[s.w].addr, wr[s.w].data);
+    s.w++;
+  }
+  if (s.w == wr.size())
+    return(MD_YM2413_EmuBatch::END);
+
+  next = ((uint64_t)wr[s.w].sample * emu.getSampleRate()) / VGM_SAMPLE_RATE - s.pos;
+  if (next > 0xfffe) next = 0xfffe;
+  s.pos += next;
+
+  return(next);
+}
+
+// Rendering --------------------------
+void renderSeparate(MD_YM2413_Emu* E, uint8_t count, uint32_t samples, std::vector<int16_t>* out)
+// Render each object on its own, in blocks, with the writes made at the 
+// sample they are due. The samples are kept in out if it is not null.
+{
+  int16_t buf[BLOCK_SIZE];
+
+  for (uint8_t k = 0; k < count; k++)
+  {
+    uint16_t wait = 0;
+
+    E[k].begin();
+    for (uint32_t done = 0; done < samples; )
+    {
+      uint16_t n = (samples - done > BLOCK_SIZE) ? BLOCK_SIZE : samples - done;
+
+      if (wait == 0)
+      {
+        wait = nextEvent(k, E[k]);
+        if (wait == 0) wait = 1;
+      }
+      if (wait < n) n = wait;
+      E[k].render(buf, n);
+      if (out != nullptr) out[k].insert(out[k].end(), buf, buf + n);
+      if (wait != MD_YM2413_EmuBatch::END) wait -= n;
+      done += n;
+    }
+  }
+}
+
+void renderBatch(MD_YM2413_EmuBatch& B, uint8_t count, uint32_t samples, std::vector<int16_t>* out)
+// Render the batch in blocks, the samples are kept in out if it is not null
+{
+  static thread_local int16_t buf[BATCH_MAX][BLOCK_SIZE];
+  int16_t* p[BATCH_MAX];
+
+  for (uint8_t k = 0; k < BATCH_MAX; k++)
+    p[k] = buf[k];
+
+  B.begin();
+  for (uint32_t done = 0; done < samples; done += BLOCK_SIZE)
+  {
+    uint16_t n = (samples - done > BLOCK_SIZE) ? BLOCK_SIZE : samples - done;
+
+    B.render(p, n);
+    if (out != nullptr)
+      for (uint8_t k = 0; k < count; k++)
+        out[k].insert(out[k].end(), buf[k], buf[k] + n);
+  }
+}
+
+double seconds(std::chrono::steady_clock::time_point t0)
+{
+  return(std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count());
+}
+
+// Checks -----------------------------
+uint32_t mixHash(const std::vector<int16_t>* v, uint8_t count)
+// Hash of the samples added together and limited to 16 bits
+{
+  uint32_t h = HASH_START;
+
+  for (size_t j = 0; j < v[0].size(); j++)
+  {
+    int32_t sum = 0;
+    int16_t s;
+
+    for (uint8_t k = 0; k < count; k++)
+      sum += v[k][j];
+    s = (sum > INT16_MAX) ? INT16_MAX : (sum < INT16_MIN) ? INT16_MIN : sum;
+    h = sampleHash(h, &s, 1);
+  }
+
+  return(h);
+}
+
+bool checkBatch(const std::vector<vgm_t>& tunes, uint8_t count, uint32_t samples, const std::vector<int16_t>* ref)
+// The batch render() and mix() samples against the separate objects
+{
+  MD_YM2413_Emu E[BATCH_MAX];
+  MD_YM2413_EmuBatch B(E, count, nextEvent);
+  stream_t s[BATCH_MAX];
+  std::vector<int16_t> out[BATCH_MAX];
+  int16_t buf[BLOCK_SIZE];
+  uint32_t h = HASH_START;
+  bool ok = true;
+
+  startStreams(s, tunes);
+  renderBatch(B, count, samples, out);
+  for (uint8_t k = 0; k < count; k++)
+    ok = ok && (out[k] == ref[k]);
+
+  // mix() in odd sized blocks, so the events fall inside the mix blocks
+  startStreams(s, tunes);
+  B.begin();
+  for (uint32_t done = 0; done < samples; )
+  {
+    uint16_t n = 1 + (done % 61);
+
+    if (n > samples - done) n = samples - done;
+    B.mix(buf, n);
+    h = sampleHash(h, buf, n);
+    done += n;
+  }
+
+  return(ok && h == mixHash(ref, count));
+}
+
+void timeThreads(const std::vector<vgm_t>& tunes, uint32_t samples)
+// A full batch on every core at the same time
+{
+  unsigned cores = std::thread::hardware_concurrency();
+  std::vector<std::thread> t;
+
+  if (cores == 0) cores = 1;
+  auto t0 = std::chrono::steady_clock::now();
+  for (unsigned c = 0; c < cores; c++)
+    t.push_back(std::thread([&tunes, samples]()
+    {
+      MD_YM2413_Emu E[BATCH_MAX];
+      MD_YM2413_EmuBatch B(E, BATCH_MAX, nextEvent);
+      stream_t s[BATCH_MAX];
+
+      startStreams(s, tunes);
+      renderBatch(B, BATCH_MAX, samples, nullptr);
+    }));
+  for (auto& th : t)
+    th.join();
+
+  printf("\n\n%u cores\t%u chips\t%.1f chip-s/s", cores, cores * BATCH_MAX,
+    ((double)cores * BATCH_MAX * samples / MD_YM2413_Emu().getSampleRate()) / seconds(t0));
+}
+
+int main(int argc, char* argv[])
+{
+  MD_YM2413_Emu E[BATCH_MAX];
+  std::vector<vgm_t> tunes;
+  std::vector<int16_t> ref[BATCH_MAX];
+  stream_t s[BATCH_MAX];
+  uint32_t samples, secs = 10;
+  bool ok = true;
+
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+      secs = strtoul(argv[++i], nullptr, 0);
+    else
+    {
+      vgm_t v;
+
+      if (loadVGM(argv[i], v))
+        tunes.push_back(v);
+      else
+      {
+        printf("%s: NOT A VGM FILE\n", argv[i]);
+        ok = false;
+      }
+    }
+  }
+  if (tunes.empty() || secs == 0)
+  {
+    fprintf(stderr, "Usage: YM2413_BatchCheck [-t seconds] file.vgm ...\n");
+    return(2);
+  }
+  samples = secs * E[0].getSampleRate();
+
+  printf("[MD_YM2413 Emulator Batch Check]\nBATCH_MAX %u, EMU_SKIP_IDLE %u, %u s for each chip",
+    BATCH_MAX, EMU_SKIP_IDLE, secs);
+
+  // the samples for every object rendered separately
+  startStreams(s, tunes);
+  renderSeparate(E, BATCH_MAX, samples, ref);
+
+  printf("\n\nChips\tseparate\tbatch\t\tbatch/sep\tcheck");
+  for (uint8_t count = 1; count <= BATCH_MAX; count++)
+  {
+    MD_YM2413_EmuBatch B(E, count, nextEvent);
+    double tSep = 1e9, tBatch = 1e9, chipSecs = (double)count * secs;
+    bool same;
+
+    for (uint8_t r = 0; r < REPEAT; r++)
+    {
+      startStreams(s, tunes);
+      auto t0 = std::chrono::steady_clock::now();
+      renderSeparate(E, count, samples, nullptr);
+      tSep = std::min(tSep, seconds(t0));
+
+      startStreams(s, tunes);
+      t0 = std::chrono::steady_clock::now();
+      renderBatch(B, count, samples, nullptr);
+      tBatch = std::min(tBatch, seconds(t0));
+    }
+
+    same = checkBatch(tunes, count, samples, ref);
+    ok = ok && same;
+
+    printf("\n%u\t%.1f chip-s/s\t%.1f chip-s/s\t%.2f\t\t%s", count, chipSecs / tSep, chipSecs / tBatch,
+      tSep / tBatch, same ? "PASS" : "FAIL");
+  }
+
+  timeThreads(tunes, samples);
+  printf("\n\n%s\n", ok ? "PASSED" : "FAILED");
+
+  return(ok ? 0 : 1);
+}
@@ -0,0 +1,385 @@
+/*
+Check the MD_YM2413 bus strobes against the YM2413 datasheet timing.
+
+A virtual YM2413 bus watches the pins through the shim pin hook, as a
+logic analyser would. On each /WE strobe it checks
+- the /WE LOW pulse width.
+- the A0 setup time before /WE goes LOW and hold time after /WE goes HIGH.
+- the data setup time before /WE goes HIGH (the data is latched on the
+  rising edge) and hold time after it.
+- the time from the end of the last strobe, which must be at least 12
+  master clock cycles after an address write and 84 after a data write.
+The register writes latched by the virtual bus are also compared with the
+writes passed to the library write hook, so the pins carry exactly what
+the library meant to write.
+
+A workload of library calls is run on each board timing model (see
+shim/YM2413_Host.h) and the shortest time seen for each check is shown
+against its minimum. Any strobe that breaks a minimum fails the test.
+
+When built with WRITE_BUDGET, a burst of notes that saturates the budget is
+also played with and without the budget. Each key on must find the same
+instrument, volume and custom instrument on the bus in both runs, so queued
+key ons never overtake the writes that set how the note sounds.
+
+Usage: YM2413_BusCheck [-b board] [-l logfile]
+  -b  board timing model to use (default all).
+  -l  write each strobe to the log file as "ns A0 value".
+
+Part of the MD_YM2413 library host build, see extras/host.
+*/
+#include <Arduino.h>
+#include <MD_YM2413.h>
+#include <vector>
+#include "YM2413_Host.h"
+
+// Hardware Definitions, as in the examples
+const uint8_t D_PIN[] = { 8, 9, 7, 6, A0, A1, A2, A3 };
+const uint8_t WE_PIN = 5;
+const uint8_t A0_PIN = 4;
+
+MD_YM2413 S(D_PIN, WE_PIN, A0_PIN);
+
+// YM2413 datasheet write timing minimums
+const uint32_t T_WW = 100;    // ns /WE pulse width
+const uint32_t T_AS = 10;     // ns A0 setup before /WE LOW
+const uint32_t T_AH = 20;     // ns A0 hold after /WE HIGH
+const uint32_t T_DS = 100;    // ns data setup before /WE HIGH
+const uint32_t T_DH = 20;     // ns data hold after /WE HIGH
+const uint8_t CYCLES_ADDR = 12;   // master clock cycles after an address write
+const uint8_t CYCLES_DATA = 84;   // master clock cycles after a data write
+
+// Virtual bus ------------------------
+enum check_t { C_PULSE, C_A0_SETUP, C_A0_HOLD, C_D_SETUP, C_D_HOLD, C_WAIT_ADDR, C_WAIT_DATA, C_COUNT };
+
+const char* const checkName[C_COUNT] =
+{ "/WE pulse ns", "A0 setup ns", "A0 hold ns", "data setup ns", "data hold ns", "wait addr cyc", "wait data cyc" };
+
+struct busState_t
+{
+  uint8_t pin[256];         // pin levels
+  uint64_t changed[256];    // time of the last change for each pin
+  bool weLow;               // a strobe is in progress
+  uint64_t tFall;           // /WE went LOW
+  uint64_t tRise;           // /WE went HIGH for the last strobe, 0 if none yet
+  bool lastA0;              // A0 for the last strobe
+  uint8_t addr;             // register address latched
+  uint32_t strobes;         // number of strobes
+  uint32_t minTime[C_COUNT];  // shortest time seen for each check
+  uint32_t fails[C_COUNT];  // minimums broken
+  std::vector<std::pair<uint8_t, uint8_t>> writes;  // latched register writes
+  FILE* log;                // strobe log, nullptr for none
+};
+
+busState_t bus;
+std::vector<std::pair<uint8_t, uint8_t>> hookWrites;
+
+const uint32_t minimum[C_COUNT] = { T_WW, T_AS, T_AH, T_DS, T_DH, CYCLES_ADDR, CYCLES_DATA };
+
+void check(check_t c, uint64_t t)
+{
+  uint32_t v = (t > 0xffffffffULL) ? 0xffffffffUL : (uint32_t)t;
+
+  if (v < bus.minTime[c]) bus.minTime[c] = v;
+  if (v < minimum[c]) bus.fails[c]++;
+}
+
+uint8_t dataBus(void)
+{
+  uint8_t v = 0;
+
+  for (uint8_t i = 0; i < 8; i++)
+    if (bus.pin[D_PIN[i]]) v |= (1 << i);
+
+  return(v);
+}
+
+bool isDataPin(uint8_t pin)
+{
+  for (uint8_t i = 0; i < 8; i++)
+    if (D_PIN[i] == pin) return(true);
+
+  return(false);
+}
+
+void busHook(uint8_t pin, uint8_t value, uint64_t ns)
+{
+  if (bus.pin[pin] == value)    // no change on the pin
+    return;
+
+  // hold times after the last strobe
+  if (bus.tRise != 0 && !bus.weLow)
+  {
+    if (pin == A0_PIN) check(C_A0_HOLD, ns - bus.tRise);
+    if (isDataPin(pin)) check(C_D_HOLD, ns - bus.tRise);
+  }
+
+  bus.pin[pin] = value;
+  bus.changed[pin] = ns;
+
+  if (pin != WE_PIN)
+    return;
+
+  if (value == LOW)    // start of a strobe
+  {
+    bus.weLow = true;
+    bus.tFall = ns;
+    check(C_A0_SETUP, ns - bus.changed[A0_PIN]);
+    if (bus.tRise != 0)
+    {
+      uint64_t cycles = ((ns - bus.tRise) * CLOCK_HZ) / 1000000000ULL;
+
+      check(bus.lastA0 ? C_WAIT_DATA : C_WAIT_ADDR, cycles);
+    }
+  }
+  else if (bus.weLow)  // end of a strobe, the bus is latched
+  {
+    uint64_t lastData = 0;
+    uint8_t v = dataBus();
+
+    for (uint8_t i = 0; i < 8; i++)
+      if (bus.changed[D_PIN[i]] > lastData) lastData = bus.changed[D_PIN[i]];
+
+    check(C_PULSE, ns - bus.tFall);
+    check(C_D_SETUP, ns - lastData);
+
+    bus.weLow = false;
+    bus.tRise = ns;
+    bus.lastA0 = bus.pin[A0_PIN];
+    bus.strobes++;
+    if (bus.lastA0)
+      bus.writes.push_back(std::make_pair(bus.addr, v));
+    else
+      bus.addr = v;
+
+    if (bus.log != nullptr)
+      fprintf(bus.log, "%llu %u 0x%02X\n", (unsigned long long)ns, bus.lastA0, v);
+  }
+}
+
+void writeHook(uint8_t addr, uint8_t data)
+{
+  hookWrites.push_back(std::make_pair(addr, data));
+}
+
+// Workload ---------------------------
+// A mix of the library calls, with some time passing between them
+void workload(void)
+{
+  const uint8_t custom[8] = { 0x61, 0x61, 0x1e, 0x17, 0xf0, 0x7f, 0x00, 0x17 };
+  const uint8_t block[] = { 0x30, 0x20, 0x10, 0xac, 0x20, 0x18, 0x31, 0x40, 0x11, 0x58, 0x21, 0x19 };
+
+  S.begin();
+  S.loadInstrument(custom);
+  for (uint8_t i = 0; i < 9; i++)
+    S.noteOn(i, (uint8_t)4, i, MD_YM2413::VOL_MAX, 10 + i);
+  for (uint8_t i = 0; i < 20; i++)
+  {
+    host::advance(1000000ULL);
+    S.run();
+  }
+
+  S.setPercussion(true);
+  for (uint8_t i = MD_YM2413::CH_HH; i <= MD_YM2413::CH_BD; i++)
+    S.noteOn(i, (uint8_t)4, (uint8_t)0, MD_YM2413::VOL_MAX - i);
+  S.setVolume(9);
+  S.fadeTo(MD_YM2413::VOL_OFF, 50);
+  for (uint8_t i = 0; i < 60; i++)
+  {
+    host::advance(1000000ULL);
+    S.run();
+  }
+  S.setPercussion(false);
+
+  for (uint16_t i = 0; i < 200; i++)
+    S.write(0x10 + (i % 9), i & 0xff);
+  for (uint16_t i = 0; i < 200; i++)
+    S.write(0x10, i & 0xff);
+  S.writeBlock(block, sizeof(block) / 2, true);
+  S.noteOn(0, (uint16_t)440, MD_YM2413::VOL_MAX);
+  S.suspend();
+  S.resume();
+  S.noteOff(0);
+}
+
+#if WRITE_BUDGET
+// Key on order -----------------------
+// For each key on sent, the register writes it depends on as they were
+// on the bus at that time.
+struct keyState_t
+{
+  uint8_t addr, data;   // key on write
+  uint8_t reg[3];       // 0x30+ch, or the percussion volumes 0x36-0x38
+  uint8_t patch[8];     // custom instrument 0x00-0x07, when it is played
+
+  bool operator==(const keyState_t& k) const { return(memcmp(this, &k, sizeof(k)) == 0); }
+};
+
+std::vector<keyState_t> keyStates(const std::vector<std::pair<uint8_t, uint8_t>>& writes)
+{
+  std::vector<keyState_t> v;
+  uint8_t reg[256] = { 0 };
+
+  for (auto& w : writes)
+  {
+    bool melodic = (w.first >= 0x20 && w.first < 0x29 && (w.second & 0x10));
+    bool rhythm = (w.first == 0x0e && (w.second & 0x1f));
+
+    reg[w.first] = w.second;
+    if (melodic || rhythm)
+    {
+      keyState_t k;
+
+      memset(&k, 0, sizeof(k));
+      k.addr = w.first;
+      k.data = w.second;
+      if (melodic)
+      {
+        k.reg[0] = reg[w.first + 0x10];
+        if ((k.reg[0] >> 4) == 0)   // custom instrument
+          memcpy(k.patch, reg, sizeof(k.patch));
+      }
+      else
+        memcpy(k.reg, &reg[0x36], sizeof(k.reg));
+      v.push_back(k);
+    }
+  }
+
+  return(v);
+}
+
+// Notes and instrument changes played with no time between them
+void keyBurst(uint8_t budget)
+{
+  const uint8_t custom[8] = { 0x61, 0x61, 0x1e, 0x17, 0xf0, 0x7f, 0x00, 0x17 };
+  const uint8_t custom2[8] = { 0x13, 0x41, 0x1a, 0x0d, 0xd8, 0xf7, 0x23, 0x13 };
+
+  S.begin();
+  S.setWriteBudget(0);
+  for (uint8_t i = 0; i < 9; i++)
+    S.noteOn(i, (uint8_t)4, i, MD_YM2413::VOL_MAX);
+  host::advance(1000000ULL);
+  S.flush();
+
+  hookWrites.clear();
+  S.resetWriteStats();
+  S.setWriteBudget(budget);
+  for (uint8_t r = 0; r < 3; r++)
+  {
+    S.loadInstrument(r & 1 ? custom2 : custom);
+    for (uint8_t i = 0; i < 9; i++)
+    {
+      S.setInstrument(i, (MD_YM2413::instrument_t)((i + r) % 3 == 0 ? MD_YM2413::I_CUSTOM : 1 + (i + r) % 15), MD_YM2413::VOL_MAX - r - i);
+      S.noteOn(i, (uint8_t)(3 + r), i, MD_YM2413::VOL_MAX - 2 * r);
+    }
+  }
+  S.setPercussion(true);
+  for (uint8_t r = 0; r < 3; r++)
+    for (uint8_t i = MD_YM2413::CH_HH; i <= MD_YM2413::CH_BD; i++)
+      S.noteOn(i, (uint8_t)4, (uint8_t)0, MD_YM2413::VOL_MAX - r - i);
+  for (uint8_t i = 0; i < 100; i++)
+  {
+    host::advance(1000000ULL);
+    S.run();
+  }
+  S.flush();
+  S.setPercussion(false);
+  S.setWriteBudget(WRITE_BUDGET);
+}
+
+bool checkKeyOrder(void)
+{
+  std::vector<keyState_t> ref, act;
+
+  keyBurst(0);
+  ref = keyStates(hookWrites);
+  keyBurst(1);
+  act = keyStates(hookWrites);
+
+  printf("\n\nKey ons at budget 0 %u, at budget 1 %u, %u deferred, %s",
+    (unsigned)ref.size(), (unsigned)act.size(), (unsigned)S.getDeferred(),
+    ref == act ? "same instruments" : "DIFFERENT");
+
+  return(ref == act);
+}
+#endif
+
+int main(int argc, char* argv[])
+{
+  const host::board_t* board = nullptr;
+  const char* logFile = nullptr;
+  bool fail = false;
+
+  for (int i = 1; i < argc - 1; i += 2)
+  {
+    if (strcmp(argv[i], "-b") == 0)
+    {
+      board = host::findBoard(argv[i + 1]);
+      if (board == nullptr)
+      {
+        fprintf(stderr, "Unknown board %s\n", argv[i + 1]);
+        return(2);
+      }
+    }
+    else if (strcmp(argv[i], "-l") == 0) logFile = argv[i + 1];
+  }
+
+  printf("[MD_YM2413 Bus Check]\nCLOCK_HZ %lu", (unsigned long)CLOCK_HZ);
+  for (uint8_t bi = 0; bi < host::BOARD_COUNT; bi++)
+  {
+    const host::board_t& b = host::boards[bi];
+    bool ok;
+
+    if (board != nullptr && board != &b)
+      continue;
+
+    host::setBoard(b);
+    host::reset();
+    memset(bus.pin, LOW, sizeof(bus.pin));
+    memset(bus.changed, 0, sizeof(bus.changed));
+    bus.weLow = false;
+    bus.tRise = 0;
+    bus.strobes = 0;
+    bus.writes.clear();
+    hookWrites.clear();
+    for (uint8_t c = 0; c < C_COUNT; c++)
+    {
+      bus.minTime[c] = 0xffffffffUL;
+      bus.fails[c] = 0;
+    }
+    bus.log = (logFile != nullptr) ? fopen(logFile, bi == 0 || board != nullptr ? "w" : "a") : nullptr;
+    if (bus.log != nullptr) fprintf(bus.log, "# board %s\n", b.name);
+
+    host::setPinHook(busHook);
+    S.setWriteHook(writeHook);
+    workload();
+    S.flush();
+    S.setWriteHook(nullptr);
+    host::setPinHook(nullptr);
+    if (bus.log != nullptr) fclose(bus.log);
+
+    printf("\n\nBoard %s, digitalWrite %u ns, micros %u ns, %u strobes", b.name, b.pinNs, b.timeNs, bus.strobes);
+    printf("\nCheck         \tshortest\tminimum\tfails");
+    for (uint8_t c = 0; c < C_COUNT; c++)
+    {
+      printf("\n%-14s\t%u\t\t%u\t%u", checkName[c], bus.minTime[c], minimum[c], bus.fails[c]);
+      if (bus.fails[c] != 0) fail = true;
+    }
+
+    ok = (bus.writes == hookWrites);
+    printf("\nRegister writes on the bus %u, from the write hook %u, %s",
+      (unsigned)bus.writes.size(), (unsigned)hookWrites.size(), ok ? "same" : "DIFFERENT");
+    if (!ok) fail = true;
+  }
+
+#if WRITE_BUDGET
+  host::reset();
+  S.setWriteHook(writeHook);
+  if (!checkKeyOrder()) fail = true;
+  S.setWriteHook(nullptr);
+#endif
+
+  printf("\n\n%s\n", fail ? "FAILED" : "PASSED");
+
+  return(fail ? 1 : 0);
+}
@@ -0,0 +1,218 @@
+/*
+Render benchmark for the MD_YM2413_Emu software YM2413.
+
+Each VGM file named on the command line (the VGM_TUNES of the
+VGM_Player_CLI example) is rendered as the EmuBenchmark example does,
+with the register writes sent directly to the emulator and the VGM waits
+rendered in blocks of up to the block size. Every render() call is timed
+with the host cycle counter (the time stamp counter on x86, ns elsewhere)
+and the table shows for each tune
+- the tune length in seconds and the blocks rendered.
+- the median, 99th percentile and largest cycles for a block.
+- the cycles for each sample, over the whole tune.
+- how many times faster than real time the tune was rendered.
+- the average number of active channels.
+- a hash of the samples.
+
+The hashes are written to a file with -w and checked against the file
+with -c, so the samples from the library built with EMU_SKIP_IDLE set to
+0 can be checked to be the same as the samples with it set to 1.
+
+The figures are host cycles, not board cycles, but the changes in them
+from a change to the render code are the ones to look for on a board.
+
+Usage: YM2413_EmuBench [-s block] [-w file | -c file] file.vgm ...
+  -s  most samples rendered in each block (default 64).
+  -w  write the hash for each tune to the file.
+  -c  check the hash for each tune against the file.
+
+Part of the MD_YM2413 library host build, see extras/host.
+*/
+#include <Arduino.h>
+#include <MD_YM2413_Emu.h>
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+#include "YM2413_EmuTools.h"
+
+const uint16_t BLOCK_MAX = 1024;          // largest block size
+
+// Rendering --------------------------
+struct result_t
+{
+  uint32_t samples;               // emulator samples rendered
+  std::vector<uint32_t> block;    // cycles for each render() call
+  uint64_t total;                 // cycles for all the render() calls
+  uint64_t ns;                    // wall clock ns for all the render() calls
+  uint32_t activeSum;             // active channels for each block
+  uint32_t hash;                  // hash of the samples
+};
+
+void renderTo(MD_YM2413_Emu& E, uint32_t sample, uint16_t blockSize, result_t& r)
+// Render the samples up to the VGM sample time in blocks of up to blockSize
+{
+  static int16_t buf[BLOCK_MAX];
+  uint32_t target = ((uint64_t)sample * E.getSampleRate()) / VGM_SAMPLE_RATE;
+
+  while (r.samples < target)
+  {
+    uint16_t count = (target - r.samples > blockSize) ? blockSize : target - r.samples;
+    auto t0 = std::chrono::steady_clock::now();
+    uint64_t c = cycles();
+    uint8_t active = 0;
+
+    E.render(buf, count);
+    c = cycles() - c;
+    r.ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count();
+    r.block.push_back((uint32_t)c);
+    r.total += c;
+    r.samples += count;
+    r.hash = sampleHash(r.hash, buf, count);
+
+    for (uint16_t ch = E.getActive(); ch != 0; ch >>= 1)
+      active += ch & 1;
+    r.activeSum += active;
+  }
+}
+
+void render(MD_YM2413_Emu& E, const vgm_t& v, uint16_t blockSize, result_t& r)
+// Render the tune, with each write at its time
+{
+  r.samples = 0;
+  r.block.clear();
+  r.total = r.ns = 0;
+  r.activeSum = 0;
+  r.hash = HASH_START;
+
+  E.begin();
+  for (auto& w : v.writes)
+  {
+    renderTo(E, w.sample, blockSize, r);
+    E.write(w.addr, w.data);
+  }
+  renderTo(E, v.end, blockSize, r);
+}
+
+uint32_t percentile(std::vector<uint32_t> v, uint8_t pc)
+{
+  size_t i;
+
+  if (v.empty())
+    return(0);
+  i = ((v.size() - 1) * pc) / 100;
+  std::nth_element(v.begin(), v.begin() + i, v.end());
+
+  return(v[i]);
+}
+
+int main(int argc, char* argv[])
+{
+  MD_YM2413_Emu E;
+  uint16_t blockSize = 64;
+  std::vector<const char*> files;
+  const char* writeFile = nullptr;
+  const char* checkFile = nullptr;
+  std::map<std::string, uint32_t> expect;
+  FILE* fw = nullptr;
+  uint64_t totalCycles = 0, totalSamples = 0, totalActive = 0, totalBlocks = 0;
+  bool ok = true;
+
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+    {
+      blockSize = strtoul(argv[++i], nullptr, 0);
+      if (blockSize == 0 || blockSize > BLOCK_MAX)
+      {
+        fprintf(stderr, "Block size 1 to %u\n", BLOCK_MAX);
+        return(2);
+      }
+    }
+    else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) writeFile = argv[++i];
+    else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) checkFile = argv[++i];
+    else files.push_back(argv[i]);
+  }
+  if (files.empty())
+  {
+    fprintf(stderr, "Usage: YM2413_EmuBench [-s block] [-w file | -c file] file.vgm ...\n");
+    return(2);
+  }
+
+  if (checkFile != nullptr)
+  {
+    FILE* fp = fopen(checkFile, "r");
+    char name[64];
+    unsigned long h;
+
+    if (fp == nullptr)
+    {
+      fprintf(stderr, "No hash file %s\n", checkFile);
+      return(2);
+    }
+    while (fscanf(fp, "%63s %lx", name, &h) == 2)
+      expect[name] = h;
+    fclose(fp);
+  }
+  if (writeFile != nullptr && (fw = fopen(writeFile, "w")) == nullptr)
+  {
+    fprintf(stderr, "Cannot write %s\n", writeFile);
+    return(2);
+  }
+
+  printf("[MD_YM2413 Emulator Render Benchmark]\nEMU_SKIP_IDLE %u, block %u samples, cycles are %s",
+    EMU_SKIP_IDLE, blockSize, CYCLES_NAME);
+  printf("\n\nFile          \ttune s\tblocks\tmedian\tp99\tmax\tcyc/smp\tx real\tactive\thash");
+  if (checkFile != nullptr) printf("\t\tcheck");
+
+  for (auto f : files)
+  {
+    vgm_t v;
+    result_t r;
+
+    if (!loadVGM(f, v))
+    {
+      printf("\n%s\tNOT A VGM FILE", f);
+      ok = false;
+      continue;
+    }
+
+    render(E, v, blockSize, r);
+    if (r.block.empty())
+    {
+      printf("\n%-14s\tno samples", v.name.c_str());
+      continue;
+    }
+
+    printf("\n%-14s\t%.1f\t%u\t%u\t%u\t%u\t%.0f\t%.0f\t%.1f\t%08lX", v.name.c_str(),
+      (double)r.samples / E.getSampleRate(), (unsigned)r.block.size(),
+      percentile(r.block, 50), percentile(r.block, 99), *std::max_element(r.block.begin(), r.block.end()),
+      (double)r.total / r.samples,
+      ((double)r.samples / E.getSampleRate()) / (r.ns / 1e9),
+      (double)r.activeSum / r.block.size(), (unsigned long)r.hash);
+    if (checkFile != nullptr)
+    {
+      auto e = expect.find(v.name);
+      bool same = (e != expect.end() && e->second == r.hash);
+
+      printf("\t%s", same ? "same" : (e == expect.end() ? "MISSING" : "DIFFERENT"));
+      ok = ok && same;
+    }
+    if (fw != nullptr)
+      fprintf(fw, "%s %08lX\n", v.name.c_str(), (unsigned long)r.hash);
+
+    totalCycles += r.total;
+    totalSamples += r.samples;
+    totalActive += r.activeSum;
+    totalBlocks += r.block.size();
+  }
+  if (fw != nullptr) fclose(fw);
+
+  if (totalSamples != 0)
+    printf("\n%-14s\t%.1f\t%lu\t\t\t\t%.0f\t\t%.1f", "Total", (double)totalSamples / E.getSampleRate(),
+      (unsigned long)totalBlocks, (double)totalCycles / totalSamples, (double)totalActive / totalBlocks);
+  printf("\n\n%s\n", ok ? "PASSED" : "FAILED");
+
+  return(ok ? 0 : 1);
+}
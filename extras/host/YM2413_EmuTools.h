@@ -0,0 +1,136 @@
+/*
+Shared code for the MD_YM2413 host build emulator checks.
+
+- cycles() reads the host cycle counter, the time stamp counter on x86
+  and the ns clock elsewhere.
+- sampleHash() adds samples to a FNV-1a hash, the same hash as the 
+  EmuBenchmark example shows on the board.
+- loadVGM() reads the YM2413 register writes in a VGM file with their 
+  times, so a tune can be rendered on MD_YM2413_Emu as many times as a
+  check needs without reading the file again. Loops are not repeated and
+  the commands for other chips are skipped.
+
+Part of the MD_YM2413 library host build, see extras/host.
+*/
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CYCLES_NAME "TSC counts"
+#else
+#define CYCLES_NAME "ns"
+#endif
+
+const uint32_t VGM_SAMPLE_RATE = 44100;   // VGM wait commands are in 44100 samples/sec
+
+// Cycle counter ----------------------
+inline uint64_t cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return(__rdtsc());
+#else
+  return(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+// Sample hash ------------------------
+const uint32_t HASH_START = 2166136261UL;   // FNV-1a offset basis
+
+inline uint32_t sampleHash(uint32_t h, const int16_t* s, size_t count)
+// FNV-1a of the samples, low byte first
+{
+  while (count--)
+  {
+    h = (h ^ (uint8_t)*s) * 16777619UL;
+    h = (h ^ (uint8_t)((uint16_t)*s++ >> 8)) * 16777619UL;
+  }
+
+  return(h);
+}
+
+// VGM files --------------------------
+struct vgmWrite_t
+{
+  uint32_t sample;    // VGM sample time of the write
+  uint8_t addr;
+  uint8_t data;
+};
+
+struct vgm_t
+{
+  std::string name;               // file name without directory and extension
+  std::vector<vgmWrite_t> writes; // YM2413 register writes
+  uint32_t end;                   // VGM sample time of the end of the tune
+};
+
+inline bool loadVGM(const char* file, vgm_t& v)
+// Read the YM2413 writes and their times from the file.
+// Loops are not repeated.
+{
+  std::vector<uint8_t> d;
+  FILE* fp = fopen(file, "rb");
+  uint32_t i, end;
+  uint32_t samples = 0;
+  bool done = false;
+
+  if (fp == nullptr)
+    return(false);
+
+  for (int c; (c = fgetc(fp)) != EOF; )
+    d.push_back(c);
+  fclose(fp);
+  if (d.size() < 0x40 || memcmp(d.data(), "Vgm ", 4) != 0)
+    return(false);
+
+  v.name = file;
+  v.name = v.name.substr(v.name.find_last_of("/\\") + 1);
+  v.name = v.name.substr(0, v.name.find_last_of('.'));
+  v.writes.clear();
+
+  // VGM 1.50 and later have the offset to the data at 0x34
+  i = 0x40;
+  if ((d[8] | (d[9] << 8)) >= 0x150)
+  {
+    uint32_t off = d[0x34] | (d[0x35] << 8) | (d[0x36] << 16) | ((uint32_t)d[0x37] << 24);
+
+    if (off != 0) i = 0x34 + off;
+  }
+  end = d.size();
+
+  while (!done && i < end)
+  {
+    uint8_t cmd = d[i++];
+
+    switch (cmd)
+    {
+      case 0x51: if (i + 2 <= end) v.writes.push_back({ samples, d[i], d[i + 1] }); i += 2; break;
+      case 0x61: if (i + 2 <= end) samples += d[i] | (d[i + 1] << 8); i += 2; break;
+      case 0x62: samples += 735; break;
+      case 0x63: samples += 882; break;
+      case 0x66: done = true; break;
+      case 0x67:
+        if (i + 6 <= end)
+          i += 6 + (d[i + 2] | (d[i + 3] << 8) | (d[i + 4] << 16) | ((uint32_t)d[i + 5] << 24));
+        else
+          done = true;
+        break;
+      default:
+        if (cmd >= 0x70 && cmd <= 0x7f) samples += (cmd & 0x0f) + 1;
+        else if (cmd >= 0x80 && cmd <= 0x8f) samples += (cmd & 0x0f);
+        else if ((cmd >= 0x30 && cmd <= 0x3f) || cmd == 0x4f || cmd == 0x50) i += 1;
+        else if ((cmd >= 0x40 && cmd <= 0x5f) || (cmd >= 0xa0 && cmd <= 0xbf)) i += 2;
+        else if (cmd >= 0xc0 && cmd <= 0xdf) i += 3;
+        else if (cmd >= 0xe0) i += 4;
+        break;
+    }
+  }
+  v.end = samples;
+
+  return(true);
+}
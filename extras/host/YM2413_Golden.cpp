@@ -0,0 +1,442 @@
+/*
+Golden register stream checks for the MD_YM2413 library.
+
+Each tune is played through the library on the host, with simulated time
+(Uno board timing model, see shim/YM2413_Host.h), and every register
+write passed to the write hook is recorded as a "time addr data" line,
+with the time in us from the start of the tune. The lines are compared
+with the golden trace for the tune in the golden directory and the first
+difference is shown as a line diff.
+
+The tunes are
+- the VGM files named on the command line (the VGM_TUNES of the
+  VGM_Player_CLI example), played with write() as the example does.
+- the songs in the RTTTL_Player example, played with its arranger.
+- scripted MIDI sequences played by MD_YM2413_MIDI.
+
+For each tune the table shows the register writes, the address writes,
+the bus busy time (12 master clock cycles for each address write and 84
+for each data write), the tune length and the check result, so changes
+to the bus cost show up next to changes to the register writes.
+
+When a change to the register writes is intended, the golden traces are
+written again with -u and the differences checked in with the change.
+
+Usage: YM2413_Golden [-u] -g golden_dir [file.vgm ...]
+  -u  write the golden traces instead of checking them.
+  -g  directory with the golden traces.
+
+Part of the MD_YM2413 library host build, see extras/host.
+*/
+#include <Arduino.h>
+#include <MD_YM2413.h>
+#include <MD_YM2413_MIDI.h>
+#include <string>
+#include <vector>
+#include "YM2413_Host.h"
+#include "RTTTL_Arranger.h"
+#include "MD_YM2413_RTTTL_Player.h"
+
+// Hardware Definitions, as in the examples
+const uint8_t D_PIN[] = { 8, 9, 7, 6, A0, A1, A2, A3 };
+const uint8_t WE_PIN = 5;
+const uint8_t A0_PIN = 4;
+
+// Datasheet waits in master clock cycles
+const uint8_t CYCLES_ADDR = 12;   // after an address write
+const uint8_t CYCLES_DATA = 84;   // after a data write
+
+const uint16_t DIFF_LINES = 8;    // most lines of each side shown in a diff
+
+MD_YM2413 S(D_PIN, WE_PIN, A0_PIN);
+MD_YM2413_MIDI M(S);
+
+// Recording --------------------------
+struct tune_t
+{
+  std::string name;               // also the golden file name
+  std::string title;              // shown in the golden file
+  std::vector<std::string> lines; // header and register writes
+  uint32_t writes;                // register writes
+  uint32_t addrWrites;            // address writes
+  uint8_t lastAddr;               // last address written
+};
+
+tune_t tune;
+
+void recordWrite(uint8_t addr, uint8_t data)
+{
+  char line[32];
+
+  snprintf(line, sizeof(line), "%lu %02X %02X", (unsigned long)(host::now() / 1000), addr, data);
+  tune.lines.push_back(line);
+  if (addr != tune.lastAddr) tune.addrWrites++;
+  tune.lastAddr = addr;
+  tune.writes++;
+}
+
+void startTune(const std::string& name, const std::string& title)
+// Start recording from the library begin()
+{
+  tune.name = name;
+  tune.title = title;
+  tune.lines.clear();
+  tune.writes = tune.addrWrites = 0;
+  tune.lastAddr = 0xff;
+
+  host::reset();
+  S.setWriteHook(recordWrite);
+  S.begin();
+}
+
+uint32_t busTime(void)
+// Datasheet bus busy time for the tune in us
+{
+  return((uint32_t)((((uint64_t)tune.addrWrites * CYCLES_ADDR) + ((uint64_t)tune.writes * CYCLES_DATA)) * 1000000ULL / CLOCK_HZ));
+}
+
+// VGM files --------------------------
+// Played as the VGM_Player_CLI example does, with the time for each
+// command from the start of the tune so the writes do not move the tempo.
+bool playVGM(const char* file)
+{
+  const uint32_t VGM_SAMPLE_RATE = 44100;
+  std::vector<uint8_t> d;
+  FILE* fp = fopen(file, "rb");
+  uint32_t i, end;
+  uint64_t samples = 0;
+  bool done = false;
+  std::string name(file);
+
+  if (fp == nullptr)
+    return(false);
+
+  for (int c; (c = fgetc(fp)) != EOF; )
+    d.push_back(c);
+  fclose(fp);
+  if (d.size() < 0x40 || memcmp(d.data(), "Vgm ", 4) != 0)
+    return(false);
+
+  // file name without the directory and extension
+  name = name.substr(name.find_last_of("/\\") + 1);
+  name = name.substr(0, name.find_last_of('.'));
+
+  // VGM 1.50 and later have the offset to the data at 0x34
+  i = 0x40;
+  if ((d[8] | (d[9] << 8)) >= 0x150)
+  {
+    uint32_t off = d[0x34] | (d[0x35] << 8) | (d[0x36] << 16) | ((uint32_t)d[0x37] << 24);
+
+    if (off != 0) i = 0x34 + off;
+  }
+  end = d.size();
+
+  startTune("VGM_" + name, name);
+  while (!done && i < end)
+  {
+    uint64_t due = (samples * 1000000000ULL) / VGM_SAMPLE_RATE;
+    uint8_t cmd = d[i++];
+
+    // wait for the command time, running the library as loop() would
+    if (host::now() < due)
+    {
+      host::advance(due - host::now());
+      S.run();
+    }
+
+    switch (cmd)
+    {
+      case 0x51: if (i + 2 <= end) S.write(d[i], d[i + 1]); i += 2; break;
+      case 0x61: if (i + 2 <= end) samples += d[i] | (d[i + 1] << 8); i += 2; break;
+      case 0x62: samples += 735; break;
+      case 0x63: samples += 882; break;
+      case 0x66: done = true; break;
+      case 0x67:
+        if (i + 6 <= end)
+          i += 6 + (d[i + 2] | (d[i + 3] << 8) | (d[i + 4] << 16) | ((uint32_t)d[i + 5] << 24));
+        else
+          done = true;
+        break;
+      default:
+        if (cmd >= 0x70 && cmd <= 0x7f) samples += (cmd & 0x0f) + 1;
+        else if (cmd >= 0x80 && cmd <= 0x8f) samples += (cmd & 0x0f);
+        else if ((cmd >= 0x30 && cmd <= 0x3f) || cmd == 0x4f || cmd == 0x50) i += 1;
+        else if ((cmd >= 0x40 && cmd <= 0x5f) || (cmd >= 0xa0 && cmd <= 0xbf)) i += 2;
+        else if (cmd >= 0xc0 && cmd <= 0xdf) i += 3;
+        else if (cmd >= 0xe0) i += 4;
+        break;
+    }
+  }
+
+  return(true);
+}
+
+// RTTTL songs ------------------------
+// Played as the RTTTL_Player example does, with loop() taking 200us
+void playRTTTL(uint8_t song)
+{
+  const MD_YM2413::instrument_t instr[] =
+  { MD_YM2413::I_PIANO, MD_YM2413::I_ACOUSTIC_BASS, MD_YM2413::I_VIOLIN, MD_YM2413::I_VIOLIN };
+  const uint8_t NUM_CHAN = ARRAY_SIZE(instr);
+  RTTTLArranger P(S, NUM_CHAN);
+  char name[16];
+
+  P.compile(songTable[song]);
+  snprintf(name, sizeof(name), "RTTTL_%02u", song);
+  startTune(name, P.getTitle());
+
+  S.setVolume(MD_YM2413::VOL_MAX);
+  for (uint8_t i = 0; i < NUM_CHAN; i++)
+    S.setInstrument(i, instr[i]);
+  P.setArrangement(RTTTLArranger::ARR_BASS | RTTTLArranger::ARR_CHORD);
+  P.start();
+
+  do
+  {
+    S.run();
+    host::advance(200000ULL);
+  } while (!P.run());
+}
+
+// MIDI scripts -----------------------
+struct midiEvent_t
+{
+  uint16_t ms;      // time from the last event
+  uint8_t status;   // MIDI channel message
+  uint8_t d1, d2;   // data bytes
+};
+
+const midiEvent_t midiMelody[] =
+{
+  { 0, 0xc0, 0, 0 }, { 0, 0xc1, 33, 0 }, { 0, 0xc2, 40, 0 },
+  { 10, 0x90, 60, 100 }, { 0, 0x90, 64, 90 }, { 0, 0x90, 67, 80 }, { 0, 0x91, 36, 110 },
+  { 250, 0x80, 60, 0 }, { 0, 0x80, 64, 0 }, { 0, 0x80, 67, 0 },
+  { 0, 0x90, 62, 100 }, { 0, 0x90, 65, 90 }, { 0, 0x90, 69, 80 },
+  { 250, 0x80, 62, 0 }, { 0, 0x80, 65, 0 }, { 0, 0x80, 69, 0 }, { 0, 0x81, 36, 0 },
+  { 0, 0x92, 72, 127 }, { 125, 0x92, 72, 0 }, { 0, 0x92, 74, 64 }, { 125, 0x82, 74, 0 },
+  { 0, 0xc0, 19, 0 }, { 10, 0x90, 48, 100 }, { 500, 0x80, 48, 0 },
+};
+
+const midiEvent_t midiDrums[] =
+{
+  { 0, 0x99, 36, 127 }, { 0, 0x99, 42, 80 }, { 120, 0x89, 36, 0 }, { 0, 0x89, 42, 0 },
+  { 0, 0x99, 42, 80 }, { 120, 0x89, 42, 0 },
+  { 0, 0x99, 38, 110 }, { 0, 0x99, 42, 80 }, { 120, 0x89, 38, 0 }, { 0, 0x89, 42, 0 },
+  { 0, 0x99, 42, 80 }, { 120, 0x89, 42, 0 },
+  { 0, 0x99, 36, 127 }, { 0, 0x99, 49, 100 }, { 60, 0x99, 45, 90 }, { 60, 0x99, 47, 90 },
+  { 60, 0x99, 50, 90 }, { 120, 0x89, 36, 0 }, { 0, 0x89, 49, 0 }, { 0, 0x89, 45, 0 },
+  { 0, 0x89, 47, 0 }, { 0, 0x89, 50, 0 },
+};
+
+const midiEvent_t midiControl[] =
+{
+  { 0, 0xc0, 48, 0 }, { 0, 0x90, 60, 100 }, { 0, 0x90, 67, 100 },
+  { 50, 0xe0, 0x00, 0x50 }, { 50, 0xe0, 0x00, 0x60 }, { 50, 0xe0, 0x00, 0x40 }, { 50, 0xe0, 0x7f, 0x3f },
+  { 50, 0xb0, 7, 100 }, { 50, 0xb0, 7, 50 }, { 50, 0xb0, 11, 64 }, { 50, 0xb0, 11, 127 },
+  { 50, 0xb0, 64, 127 }, { 0, 0x80, 60, 0 }, { 0, 0x80, 67, 0 }, { 100, 0x90, 64, 90 }, { 100, 0x80, 64, 0 },
+  { 100, 0xb0, 64, 0 }, { 50, 0x90, 72, 100 }, { 50, 0x90, 76, 0 }, { 50, 0xb0, 123, 0 },
+};
+
+const midiEvent_t midiSteal[] =
+{
+  { 0, 0xc0, 0, 0 }, { 0, 0xc1, 24, 0 },
+  { 0, 0x90, 48, 100 }, { 10, 0x90, 50, 100 }, { 10, 0x90, 52, 100 }, { 10, 0x90, 53, 100 },
+  { 10, 0x91, 55, 100 }, { 10, 0x91, 57, 100 }, { 10, 0x91, 59, 100 }, { 10, 0x90, 60, 100 },
+  { 10, 0x90, 62, 100 }, { 10, 0x91, 64, 100 }, { 10, 0x91, 65, 100 }, { 10, 0x90, 67, 100 },
+  { 10, 0x99, 36, 127 }, { 100, 0x80, 48, 0 }, { 0, 0x80, 62, 0 }, { 0, 0x91, 69, 100 },
+  { 100, 0xb0, 123, 0 }, { 0, 0xb1, 123, 0 }, { 0, 0x89, 36, 0 },
+};
+
+struct midiScript_t
+{
+  const char* name;
+  const midiEvent_t* e;
+  uint8_t count;
+};
+
+const midiScript_t midiScript[] =
+{
+  { "MIDI_Melody",  midiMelody,  ARRAY_SIZE(midiMelody) },
+  { "MIDI_Drums",   midiDrums,   ARRAY_SIZE(midiDrums) },
+  { "MIDI_Control", midiControl, ARRAY_SIZE(midiControl) },
+  { "MIDI_Steal",   midiSteal,   ARRAY_SIZE(midiSteal) },
+};
+
+void playMIDI(const midiScript_t& m)
+{
+  startTune(m.name, "MIDI script");
+  S.setPercussion(true);
+  M.begin();
+
+  for (uint8_t i = 0; i < m.count; i++)
+  {
+    for (uint16_t t = 0; t < m.e[i].ms; t++)
+    {
+      host::advance(1000000ULL);
+      S.run();
+    }
+    M.process(m.e[i].status, m.e[i].d1, m.e[i].d2);
+  }
+}
+
+// Golden traces ----------------------
+std::string goldenFile(const char* dir)
+{
+  return(std::string(dir) + "/" + tune.name + ".txt");
+}
+
+void endTune(void)
+// Add the header lines for the tune
+{
+  char line[96];
+
+  S.setWriteHook(nullptr);
+  snprintf(line, sizeof(line), "# %s %s", tune.name.c_str(), tune.title.c_str());
+  tune.lines.insert(tune.lines.begin(), line);
+  snprintf(line, sizeof(line), "# writes %lu addr %lu bus us %lu", (unsigned long)tune.writes,
+    (unsigned long)tune.addrWrites, (unsigned long)busTime());
+  tune.lines.insert(tune.lines.begin() + 1, line);
+  tune.lines.insert(tune.lines.begin() + 2, "# us addr data");
+}
+
+bool saveGolden(const char* dir)
+{
+  FILE* fp = fopen(goldenFile(dir).c_str(), "w");
+
+  if (fp == nullptr)
+    return(false);
+  for (auto& l : tune.lines)
+    fprintf(fp, "%s\n", l.c_str());
+  fclose(fp);
+
+  return(true);
+}
+
+void printDiff(const std::vector<std::string>& g, const std::vector<std::string>& n)
+// Show the lines between the common start and end of the golden and new traces
+{
+  size_t pre = 0, post = 0;
+
+  while (pre < g.size() && pre < n.size() && g[pre] == n[pre])
+    pre++;
+  while (post < g.size() - pre && post < n.size() - pre && g[g.size() - 1 - post] == n[n.size() - 1 - post])
+    post++;
+
+  printf("\n  @@ -%zu,%zu +%zu,%zu @@", pre + 1, g.size() - pre - post, pre + 1, n.size() - pre - post);
+  for (size_t i = (pre > 2 ? pre - 2 : 0); i < pre; i++)
+    printf("\n   %s", g[i].c_str());
+  for (size_t i = pre; i < g.size() - post && i < pre + DIFF_LINES; i++)
+    printf("\n  -%s", g[i].c_str());
+  if (g.size() - post - pre > DIFF_LINES)
+    printf("\n  -... %zu more", g.size() - post - pre - DIFF_LINES);
+  for (size_t i = pre; i < n.size() - post && i < pre + DIFF_LINES; i++)
+    printf("\n  +%s", n[i].c_str());
+  if (n.size() - post - pre > DIFF_LINES)
+    printf("\n  +... %zu more", n.size() - post - pre - DIFF_LINES);
+}
+
+bool readGolden(const char* dir, std::vector<std::string>& g)
+{
+  FILE* fp = fopen(goldenFile(dir).c_str(), "r");
+  char line[128];
+
+  if (fp == nullptr)
+    return(false);
+  while (fgets(line, sizeof(line), fp) != nullptr)
+  {
+    line[strcspn(line, "\r\n")] = '\0';
+    g.push_back(line);
+  }
+  fclose(fp);
+
+  return(true);
+}
+
+bool finishTune(const char* dir, bool update)
+// Check or save the recorded tune and print its line in the table
+{
+  std::vector<std::string> g;
+  bool ok;
+
+  endTune();
+  printf("\n%-14s\t%lu\t%lu\t%lu\t%.1f\t", tune.name.c_str(), (unsigned long)tune.writes,
+    (unsigned long)tune.addrWrites, (unsigned long)busTime(), host::now() / 1e9);
+
+  if (update)
+  {
+    ok = saveGolden(dir);
+    printf("%s", ok ? "saved" : "SAVE FAILED");
+  }
+  else if (!readGolden(dir, g))
+  {
+    ok = false;
+    printf("NO GOLDEN");
+  }
+  else
+  {
+    ok = (g == tune.lines);
+    printf("%s", ok ? "PASS" : "FAIL");
+    if (!ok) printDiff(g, tune.lines);
+  }
+
+  return(ok);
+}
+
+int main(int argc, char* argv[])
+{
+  const char* dir = nullptr;
+  bool update = false;
+  bool ok = true;
+  uint32_t writes = 0, bus = 0;
+  std::vector<const char*> vgm;
+
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "-u") == 0) update = true;
+    else if (strcmp(argv[i], "-g") == 0 && i + 1 < argc) dir = argv[++i];
+    else vgm.push_back(argv[i]);
+  }
+  if (dir == nullptr)
+  {
+    fprintf(stderr, "Usage: YM2413_Golden [-u] -g golden_dir [file.vgm ...]\n");
+    return(2);
+  }
+
+  host::setBoard(host::boards[0]);
+  printf("[MD_YM2413 Golden Traces]\nboard %s, CLOCK_HZ %lu", host::getBoard().name, (unsigned long)CLOCK_HZ);
+  printf("\n\nTune          \twrites\taddr\tbus us\ttime s\tcheck");
+
+  for (auto f : vgm)
+  {
+    if (!playVGM(f))
+    {
+      printf("\n%s\tNOT A VGM FILE", f);
+      ok = false;
+      continue;
+    }
+    ok &= finishTune(dir, update);
+    writes += tune.writes;
+    bus += busTime();
+  }
+
+  for (uint8_t i = 0; i < ARRAY_SIZE(songTable); i++)
+  {
+    playRTTTL(i);
+    ok &= finishTune(dir, update);
+    writes += tune.writes;
+    bus += busTime();
+  }
+
+  for (uint8_t i = 0; i < ARRAY_SIZE(midiScript); i++)
+  {
+    playMIDI(midiScript[i]);
+    ok &= finishTune(dir, update);
+    writes += tune.writes;
+    bus += busTime();
+  }
+
+  printf("\n%-14s\t%lu\t\t%lu", "Total", (unsigned long)writes, (unsigned long)bus);
+  printf("\n\n%s\n", ok ? "PASSED" : "FAILED");
+
+  return(ok ? 0 : 1);
+}
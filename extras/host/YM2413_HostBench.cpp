@@ -0,0 +1,356 @@
+/*
+Bus cost of the MD_YM2413 library calls, worked out on the host.
+
+Each library call is made a number of times on each board timing model
+(see shim/YM2413_Host.h) and for each call the table shows
+- writes   data strobes (register writes) on the bus.
+- addr     address strobes on the bus.
+- pins     digitalWrite() calls.
+- bus us   simulated time for the call, pin writes and waits.
+- wait us  simulated time the call spends waiting for the device.
+- host ns  time the call takes to run on this computer, including the
+           simulated waits, for comparison only.
+
+The calls are made back to back, so the waits are for the worst case
+where the application does nothing between calls.
+
+The sustained write() rate is also compared with a reference that waits
+a fixed time after each strobe, as the library did before the waits were
+paced by the time since the last write.
+
+The simulated figures do not depend on this computer, so they are saved
+in a baseline file and checked to find changes that make the library
+slower on the bus before it is flashed to a board.
+
+Usage: YM2413_HostBench [-b board] [-n calls] [-c baseline] [-s baseline]
+  -b  board timing model to use (default all, see YM2413_Host.h).
+  -n  number of times each call is made (default 900).
+  -c  check the results against the baseline file, exit 1 if any are worse.
+  -s  save the results as the new baseline file.
+
+Part of the MD_YM2413 library host build, see extras/host.
+*/
+#include <Arduino.h>
+#include <MD_YM2413.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "YM2413_Host.h"
+
+// Hardware Definitions, as in the examples
+const uint8_t D_PIN[] = { 8, 9, 7, 6, A0, A1, A2, A3 };
+const uint8_t WE_PIN = 5;
+const uint8_t A0_PIN = 4;
+
+MD_YM2413 S(D_PIN, WE_PIN, A0_PIN);
+
+// Bus strobes counted from the pins
+uint32_t strobeAddr, strobeData;
+
+void pinHook(uint8_t pin, uint8_t value, uint64_t)
+{
+  if (pin == WE_PIN && value == LOW)
+  {
+    if (digitalRead(A0_PIN) == LOW) strobeAddr++;
+    else strobeData++;
+  }
+}
+
+// Benchmarks -------------------------
+// prep() is not counted, call() is the call being measured
+struct bench_t
+{
+  const char* name;
+  void (*prep)(uint16_t i);
+  void (*call)(uint16_t i);
+};
+
+const uint8_t CHANS = 9;         // melodic channels
+const uint8_t R_FNUM = 0x10;      // F-Num register for channel 0
+
+void prepNone(uint16_t) {}
+void prepNoteOff(uint16_t i) { S.noteOff(i % CHANS); }
+void prepPlaying(uint16_t i) { if (i == 0) for (uint8_t c = 0; c < CHANS; c++) S.noteOn(c, (uint8_t)4, c, MD_YM2413::VOL_MAX); }
+void prepExpire(uint16_t i) { S.noteOn(i % CHANS, (uint8_t)4, (uint8_t)(i % 12), MD_YM2413::VOL_MAX, 1); host::advance(2000000UL); }
+
+void callWrite(uint16_t i) { S.write(R_FNUM + (i % CHANS), i & 0xff); }
+void callWriteSame(uint16_t i) { S.write(R_FNUM, i & 0xff); }
+void callNoteFreq(uint16_t i) { S.noteOn(i % CHANS, (uint16_t)(110 + (i % 1000)), MD_YM2413::VOL_MAX); }
+void callNoteOct(uint16_t i) { S.noteOn(i % CHANS, (uint8_t)(1 + (i % 7)), (uint8_t)(i % 12), MD_YM2413::VOL_MAX); }
+void callVolume(uint16_t i) { S.setVolume(i % CHANS, i & 0xf); }
+void callPercussion(uint16_t i) { S.setPercussion(!(i & 1)); }
+void callRun(uint16_t) { S.run(); }
+
+const bench_t bench[] =
+{
+  { "write",          prepNone,    callWrite },
+  { "write same reg", prepNone,    callWriteSame },
+  { "noteOn(freq)",   prepNoteOff, callNoteFreq },
+  { "noteOn(note)",   prepNoteOff, callNoteOct },
+  { "setVolume",      prepNone,    callVolume },
+  { "setPercussion",  prepNone,    callPercussion },
+  { "run idle",       prepPlaying, callRun },
+  { "run note off",   prepExpire,  callRun },
+};
+const uint8_t BENCH_COUNT = sizeof(bench) / sizeof(bench[0]);
+
+// Write rate -------------------------
+// Sustained write() rate compared to a reference that waits a fixed
+// time in each strobe (4us after an address and 25us after data, with
+// /WE held LOW), as the library did before the waits were paced by the
+// time since the last write.
+uint8_t fixedAddress;
+
+void fixedWrite(uint8_t addr, uint8_t data)
+{
+  if (fixedAddress != addr)
+  {
+    digitalWrite(A0_PIN, LOW);
+    for (uint8_t i = 0; i < 8; i++)
+      digitalWrite(D_PIN[i], (addr & (1 << i)) ? HIGH : LOW);
+    digitalWrite(WE_PIN, LOW);
+    delayMicroseconds(4);
+    digitalWrite(WE_PIN, HIGH);
+    fixedAddress = addr;
+  }
+
+  digitalWrite(A0_PIN, HIGH);
+  for (uint8_t i = 0; i < 8; i++)
+    digitalWrite(D_PIN[i], (data & (1 << i)) ? HIGH : LOW);
+  digitalWrite(WE_PIN, LOW);
+  delayMicroseconds(25);
+  digitalWrite(WE_PIN, HIGH);
+}
+
+uint32_t writeRate(const host::board_t& b, bool paced, bool same, uint16_t writes)
+// Writes per second of simulated time
+{
+  uint64_t start;
+
+  host::setBoard(b);
+  host::reset();
+  S.begin();
+  fixedAddress = 0xff;
+  start = host::now();
+
+  for (uint16_t i = 0; i < writes; i++)
+  {
+    uint8_t addr = R_FNUM + (same ? 0 : i % CHANS);
+
+    if (paced) S.write(addr, i & 0xff);
+    else fixedWrite(addr, i & 0xff);
+  }
+
+  return((uint32_t)((writes * 1000000000ULL) / (host::now() - start)));
+}
+
+// Results ----------------------------
+const uint8_t METRICS = 5;    // compared with the baseline
+const char* const metricName[METRICS] = { "writes", "addr", "pins", "bus us", "wait us" };
+
+struct result_t
+{
+  std::string board;
+  std::string name;
+  double v[METRICS];    // per call
+};
+
+result_t measure(const host::board_t& b, const bench_t& t, uint16_t calls, double& hostNs)
+{
+  result_t r;
+  uint64_t pins = 0, pinNs = 0, waitNs = 0;
+  uint32_t addr = 0, data = 0;
+  std::chrono::nanoseconds elapsed(0);
+
+  host::setBoard(b);
+  host::reset();
+  S.begin();
+
+  for (uint16_t i = 0; i < calls; i++)
+  {
+    t.prep(i);
+
+    host::clearCount();
+    strobeAddr = strobeData = 0;
+    host::setPinHook(pinHook);
+    auto t0 = std::chrono::steady_clock::now();
+    t.call(i);
+    elapsed += std::chrono::steady_clock::now() - t0;
+    host::setPinHook(nullptr);
+
+    pins += host::count.pinWrites;
+    pinNs += host::count.pinNs;
+    waitNs += host::count.waitNs;
+    addr += strobeAddr;
+    data += strobeData;
+  }
+
+  r.board = b.name;
+  r.name = t.name;
+  r.v[0] = (double)data / calls;
+  r.v[1] = (double)addr / calls;
+  r.v[2] = (double)pins / calls;
+  r.v[3] = (double)(pinNs + waitNs) / calls / 1000.0;
+  r.v[4] = (double)waitNs / calls / 1000.0;
+  hostNs = (double)elapsed.count() / calls;
+
+  return(r);
+}
+
+// Baseline file ----------------------
+// One line per board and call: board, name with '_' for spaces, metrics
+std::string key(const std::string& s)
+{
+  std::string k(s);
+
+  for (auto& c : k)
+    if (c == ' ') c = '_';
+
+  return(k);
+}
+
+bool saveBaseline(const char* file, const std::vector<result_t>& res)
+{
+  FILE* fp = fopen(file, "w");
+
+  if (fp == nullptr)
+    return(false);
+
+  fprintf(fp, "# MD_YM2413 host benchmark baseline, written by YM2413_HostBench -s\n");
+  fprintf(fp, "# board call writes addr pins bus_us wait_us\n");
+  for (auto& r : res)
+  {
+    fprintf(fp, "%s %s", r.board.c_str(), key(r.name).c_str());
+    for (uint8_t m = 0; m < METRICS; m++)
+      fprintf(fp, " %.3f", r.v[m]);
+    fprintf(fp, "\n");
+  }
+  fclose(fp);
+
+  return(true);
+}
+
+int checkBaseline(const char* file, const std::vector<result_t>& res)
+// Return the number of results worse than the baseline, -1 on a file error
+{
+  const double TOLERANCE = 0.001;   // rounding of the saved figures
+  FILE* fp = fopen(file, "r");
+  char line[200];
+  int worse = 0, found = 0;
+
+  if (fp == nullptr)
+    return(-1);
+
+  printf("\n\nBaseline check against %s", file);
+  while (fgets(line, sizeof(line), fp) != nullptr)
+  {
+    char board[32], name[32];
+    double v[METRICS];
+
+    if (line[0] == '#' || sscanf(line, "%31s %31s %lf %lf %lf %lf %lf", board, name, &v[0], &v[1], &v[2], &v[3], &v[4]) != 7)
+      continue;
+
+    for (auto& r : res)
+    {
+      if (r.board != board || key(r.name) != name)
+        continue;
+
+      found++;
+      for (uint8_t m = 0; m < METRICS; m++)
+      {
+        if (r.v[m] > v[m] + TOLERANCE)
+        {
+          printf("\nWORSE\t%s\t%s\t%s %.3f, baseline %.3f", board, r.name.c_str(), metricName[m], r.v[m], v[m]);
+          worse++;
+        }
+        else if (r.v[m] < v[m] - TOLERANCE)
+          printf("\nbetter\t%s\t%s\t%s %.3f, baseline %.3f", board, r.name.c_str(), metricName[m], r.v[m], v[m]);
+      }
+    }
+  }
+  fclose(fp);
+
+  if (found != (int)res.size())
+  {
+    printf("\n%d results have no baseline, save a new baseline with -s", (int)res.size() - found);
+    worse++;
+  }
+  printf("\n%s\n", worse ? "FAILED" : "PASSED");
+
+  return(worse);
+}
+
+int main(int argc, char* argv[])
+{
+  const host::board_t* board = nullptr;
+  uint16_t calls = 900;
+  const char* check = nullptr;
+  const char* save = nullptr;
+  std::vector<result_t> res;
+
+  for (int i = 1; i < argc - 1; i += 2)
+  {
+    if (strcmp(argv[i], "-b") == 0)
+    {
+      board = host::findBoard(argv[i + 1]);
+      if (board == nullptr)
+      {
+        fprintf(stderr, "Unknown board %s\n", argv[i + 1]);
+        return(2);
+      }
+    }
+    else if (strcmp(argv[i], "-n") == 0) calls = atoi(argv[i + 1]);
+    else if (strcmp(argv[i], "-c") == 0) check = argv[i + 1];
+    else if (strcmp(argv[i], "-s") == 0) save = argv[i + 1];
+  }
+  if (calls == 0) calls = 1;
+
+  printf("[MD_YM2413 Host Benchmark]\n%u calls each, CLOCK_HZ %lu", calls, (unsigned long)CLOCK_HZ);
+  for (uint8_t bi = 0; bi < host::BOARD_COUNT; bi++)
+  {
+    const host::board_t& b = host::boards[bi];
+
+    if (board != nullptr && board != &b)
+      continue;
+
+    printf("\n\nBoard %s, digitalWrite %u ns, micros %u ns", b.name, b.pinNs, b.timeNs);
+    printf("\nCall            \twrites\taddr\tpins\tbus us\twait us\thost ns");
+    for (uint8_t t = 0; t < BENCH_COUNT; t++)
+    {
+      double hostNs;
+      result_t r = measure(b, bench[t], calls, hostNs);
+
+      printf("\n%-16s", r.name.c_str());
+      for (uint8_t m = 0; m < METRICS; m++)
+        printf("\t%.2f", r.v[m]);
+      printf("\t%.0f", hostNs);
+      res.push_back(r);
+    }
+
+    printf("\n\nWrites/s          \tfixed\tpaced");
+    for (uint8_t same = 0; same < 2; same++)
+      printf("\n%-18s\t%u\t%u", same ? "same register" : "changing registers",
+        writeRate(b, false, same, calls), writeRate(b, true, same, calls));
+  }
+  printf("\n");
+
+  if (save != nullptr && !saveBaseline(save, res))
+  {
+    fprintf(stderr, "Cannot write %s\n", save);
+    return(2);
+  }
+
+  if (check != nullptr)
+  {
+    int worse = checkBaseline(check, res);
+
+    if (worse < 0)
+    {
+      fprintf(stderr, "Cannot read %s\n", check);
+      return(2);
+    }
+    return(worse ? 1 : 0);
+  }
+
+  return(0);
+}
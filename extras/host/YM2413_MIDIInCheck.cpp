@@ -0,0 +1,157 @@
+/*
+Replay captured MIDI byte streams through MD_YM2413_MIDIIn.
+
+Each file named on the command line (the captures in midi_in) holds a
+MIDI byte stream and the channel messages it decodes to, one item per
+line
+    # comment
+    > 90 3C 64 F8 ...   bytes passed to receive(), in hex
+    run                 call run() here, run() is also called at the end
+    = 90 3C 64          a message expected from the parser, in order
+    lost n              messages expected to be lost to a full queue
+
+The stream is played through MD_YM2413_MIDIIn into a MD_YM2413_MIDI
+synthesizer and the expected messages are passed directly to the
+process() method of a second synthesizer. The decoded messages are 
+checked by
+- the number of messages played by run(), which must be the number of 
+  expected messages.
+- the register writes of the two synthesizers, which must be the same.
+- the lost message count from getOverflow().
+
+Usage: YM2413_MIDIInCheck file.txt ...
+
+Part of the MD_YM2413 library host build, see extras/host.
+*/
+#include <Arduino.h>
+#include <MD_YM2413.h>
+#include <MD_YM2413_MIDI.h>
+#include <MD_YM2413_MIDIIn.h>
+#include <string>
+#include <vector>
+
+// Register writes from each synthesizer
+std::vector<uint16_t> writesIn, writesRef;
+
+void writeIn(uint8_t addr, uint8_t data) { writesIn.push_back((addr << 8) | data); }
+void writeRef(uint8_t addr, uint8_t data) { writesRef.push_back((addr << 8) | data); }
+
+// Global Data, as in the examples
+MD_YM2413 SIn(writeIn), SRef(writeRef);
+MD_YM2413_MIDI MIn(SIn), MRef(SRef);
+MD_YM2413_MIDIIn MI(MIn);
+
+struct capture_t
+{
+  std::string name;
+  std::vector<std::vector<uint8_t>> blocks;   // bytes between run() calls
+  std::vector<uint8_t> expect;                // 3 bytes for each expected message
+  uint16_t lost;                              // expected lost messages
+};
+
+bool loadCapture(const char* file, capture_t& c)
+{
+  FILE* fp = fopen(file, "r");
+  char line[256];
+  std::string name = file;
+
+  if (fp == nullptr)
+    return(false);
+
+  name = name.substr(name.find_last_of("/\\") + 1);
+  c.name = name.substr(0, name.find_last_of('.'));
+  c.blocks.assign(1, std::vector<uint8_t>());
+  c.lost = 0;
+
+  while (fgets(line, sizeof(line), fp) != nullptr)
+  {
+    char* p = line + 1;
+    unsigned v;
+    int n;
+
+    if (line[0] == '>' || line[0] == '=')
+    {
+      std::vector<uint8_t>& out = (line[0] == '>') ? c.blocks.back() : c.expect;
+      size_t start = out.size();
+
+      while (sscanf(p, "%x%n", &v, &n) == 1)
+      {
+        out.push_back(v);
+        p += n;
+      }
+      if (line[0] == '=' && out.size() - start != 3)
+      {
+        fclose(fp);
+        return(false);
+      }
+    }
+    else if (strncmp(line, "run", 3) == 0)
+      c.blocks.push_back(std::vector<uint8_t>());
+    else if (sscanf(line, "lost %u", &v) == 1)
+      c.lost = v;
+  }
+  fclose(fp);
+
+  return(true);
+}
+
+bool checkCapture(const capture_t& c)
+{
+  uint32_t played = 0, bytes = 0;
+  bool ok;
+
+  SIn.begin(); SRef.begin();
+  SIn.setPercussion(true); SRef.setPercussion(true);
+  MIn.begin(); MRef.begin();
+  MI.begin();
+  writesIn.clear(); writesRef.clear();
+
+  for (auto& b : c.blocks)
+  {
+    for (uint8_t v : b)
+      MI.receive(v);
+    played += MI.run();
+    bytes += b.size();
+  }
+
+  for (size_t i = 0; i < c.expect.size(); i += 3)
+    MRef.process(c.expect[i], c.expect[i + 1], c.expect[i + 2]);
+
+  ok = (played == c.expect.size() / 3) && (writesIn == writesRef) && (MI.getOverflow() == c.lost);
+  printf("\n%-14s\t%u\t%u\t%u\t%u\t%u\t%u\t%s", c.name.c_str(), (unsigned)bytes,
+    (unsigned)played, (unsigned)(c.expect.size() / 3), MI.getOverflow(), c.lost,
+    (unsigned)writesIn.size(), ok ? "PASS" : "FAIL");
+  if (writesIn != writesRef)
+    printf(" (register writes differ)");
+
+  return(ok);
+}
+
+int main(int argc, char* argv[])
+{
+  bool ok = true;
+
+  if (argc < 2)
+  {
+    fprintf(stderr, "Usage: YM2413_MIDIInCheck file.txt ...\n");
+    return(2);
+  }
+
+  printf("[MD_YM2413 MIDI Input Check]\nQueue %u messages", MD_YM2413_MIDIIn::QUEUE_SIZE);
+  printf("\n\nCapture       \tbytes\tplayed\texpect\tlost\texpect\twrites\tcheck");
+  for (int i = 1; i < argc; i++)
+  {
+    capture_t c;
+
+    if (!loadCapture(argv[i], c))
+    {
+      printf("\n%s\tBAD CAPTURE FILE", argv[i]);
+      ok = false;
+      continue;
+    }
+    ok = checkCapture(c) && ok;
+  }
+  printf("\n\n%s\n", ok ? "PASSED" : "FAILED");
+
+  return(ok ? 0 : 1);
+}
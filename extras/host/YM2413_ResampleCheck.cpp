@@ -0,0 +1,291 @@
+/*
+Measure the MD_YM2413_Resample sample rate converter.
+
+The converter is run from the MD_YM2413_Emu sample rate (CLOCK_HZ / 72)
+to 44.1kHz and 48kHz and for each output rate the table shows
+- SINAD (signal to noise and distortion) in dB for sine waves from 1kHz
+  to 16kHz. A sine and cosine at the test frequency are fitted to the
+  output and everything left over is noise and distortion, so the filter
+  delay and gain do not count against it.
+- the gain in dB at the same frequencies, to show how flat the filter is.
+- the stop band rejection in dB, the worst output level for the sine
+  waves from 24kHz to half the input rate, that would alias into the audio
+  band, and the rejection at half the output rate. At 44.1kHz this is in 
+  the transition band of the filter.
+- the throughput in output samples per second for 64 sample blocks.
+
+A fixed test signal (a sweep, noise and full scale steps, in blocks of
+different sizes) is also converted and a hash of the output is shown, so
+the kernels chosen by RESAMPLE_DSP and RESAMPLE_SSE2 can be checked to give
+the same output. With -w the hash is written to a file, with -c it is
+checked against the file.
+
+The test fails if the SINAD or the rejection is less than the figures
+given in the library documentation.
+
+Usage: YM2413_ResampleCheck [-w file | -c file]
+
+Part of the MD_YM2413 library host build, see extras/host.
+*/
+#include <Arduino.h>
+#include <MD_YM2413_Emu.h>
+#include <MD_YM2413_Resample.h>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+// Documented minimums
+const double SINAD_MIN = 79.0;      // dB, 1kHz to 16kHz
+const double REJECT_MIN = 69.0;     // dB, from STOP_HZ to half the input rate
+const uint32_t STOP_HZ = 24000;     // start of the filter stop band
+
+const uint32_t OUT_RATE[] = { 44100, 48000 };
+const uint16_t TONE[] = { 1000, 2000, 4000, 8000, 12000, 15000, 16000 };
+const double AMPLITUDE = 16384.0;   // test sine amplitude, -6dB full scale
+const uint32_t TONE_SAMPLES = 16384;  // input samples for each tone
+const uint16_t BLOCK = 64;          // input samples for each process() call
+
+std::vector<int16_t> convert(MD_YM2413_Resample& R, const std::vector<int16_t>& in, uint16_t block)
+// Convert the input in blocks, the block size cycles from 1 if block is 0
+{
+  std::vector<int16_t> out;
+  std::vector<int16_t> buf;
+  size_t i = 0;
+  uint16_t size = 1;
+
+  while (i < in.size())
+  {
+    uint16_t n = (block != 0) ? block : size;
+
+    if (n > in.size() - i) n = in.size() - i;
+    buf.resize(R.getOutputSize(n));
+    n = R.process(&in[i], n, buf.data());
+    out.insert(out.end(), buf.begin(), buf.begin() + n);
+    i += (block != 0) ? block : size;
+    if (block == 0 && ++size > 97) size = 1;
+  }
+
+  return(out);
+}
+
+std::vector<int16_t> tone(double freq, uint32_t rate)
+{
+  std::vector<int16_t> v(TONE_SAMPLES);
+
+  for (uint32_t i = 0; i < TONE_SAMPLES; i++)
+    v[i] = (int16_t)lround(AMPLITUDE * sin(2.0 * M_PI * freq * i / rate));
+
+  return(v);
+}
+
+void fitTone(const std::vector<int16_t>& y, double freq, double rate, double& gain, double& sinad)
+// Least squares fit of a sine, cosine and DC at freq to the output after
+// the filter has filled. Gain is the fitted amplitude and SINAD the ratio
+// of its power to the power of what is left.
+{
+  const size_t start = 2 * MD_YM2413_Resample::TAPS;
+  double m[3][4] = { { 0 } };
+  double a, b, d, sig, err = 0;
+
+  // normal equations for y = a.sin + b.cos + d
+  for (size_t n = start; n < y.size(); n++)
+  {
+    double w = 2.0 * M_PI * freq * n / rate;
+    double v[3] = { sin(w), cos(w), 1.0 };
+
+    for (uint8_t r = 0; r < 3; r++)
+    {
+      for (uint8_t c = 0; c < 3; c++)
+        m[r][c] += v[r] * v[c];
+      m[r][3] += v[r] * y[n];
+    }
+  }
+
+  // Gaussian elimination
+  for (uint8_t p = 0; p < 3; p++)
+    for (uint8_t r = p + 1; r < 3; r++)
+    {
+      double f = m[r][p] / m[p][p];
+
+      for (uint8_t c = p; c < 4; c++)
+        m[r][c] -= f * m[p][c];
+    }
+  d = m[2][3] / m[2][2];
+  b = (m[1][3] - m[1][2] * d) / m[1][1];
+  a = (m[0][3] - m[0][1] * b - m[0][2] * d) / m[0][0];
+
+  for (size_t n = start; n < y.size(); n++)
+  {
+    double w = 2.0 * M_PI * freq * n / rate;
+    double e = y[n] - (a * sin(w) + b * cos(w) + d);
+
+    err += e * e;
+  }
+  err /= (y.size() - start);
+  sig = (a * a + b * b) / 2.0;
+
+  gain = 10.0 * log10(sig / (AMPLITUDE * AMPLITUDE / 2.0));
+  sinad = 10.0 * log10(sig / err);
+}
+
+double level(const std::vector<int16_t>& y)
+// Output power in dB relative to the test sine, after the filter has filled
+{
+  const size_t start = 2 * MD_YM2413_Resample::TAPS;
+  double mean = 0, p = 0;
+
+  for (size_t n = start; n < y.size(); n++)
+    mean += y[n];
+  mean /= (y.size() - start);
+  for (size_t n = start; n < y.size(); n++)
+    p += (y[n] - mean) * (y[n] - mean);
+  p /= (y.size() - start);
+
+  return(10.0 * log10((p + 1e-12) / (AMPLITUDE * AMPLITUDE / 2.0)));
+}
+
+std::vector<int16_t> testSignal(void)
+// Sweep, noise and full scale steps, to exercise every path of the kernel
+{
+  std::vector<int16_t> v;
+  uint32_t seed = 1;
+
+  for (uint32_t i = 0; i < 50000; i++)   // sweep 20Hz to 24kHz at full scale
+  {
+    double f = 20.0 + (24000.0 - 20.0) * i / 50000.0;
+
+    v.push_back((int16_t)lround(32767.0 * sin(M_PI * f * i / 49716.0)));
+  }
+  for (uint32_t i = 0; i < 20000; i++)   // noise
+  {
+    seed = seed * 1103515245UL + 12345UL;
+    v.push_back((int16_t)(seed >> 16));
+  }
+  for (uint32_t i = 0; i < 4000; i++)    // steps that clip the output
+    v.push_back((i / 50) & 1 ? INT16_MAX : INT16_MIN);
+
+  return(v);
+}
+
+uint32_t hash(const std::vector<int16_t>& v)
+// FNV-1a of the samples, low byte first
+{
+  uint32_t h = 2166136261UL;
+
+  for (int16_t s : v)
+  {
+    h = (h ^ (uint8_t)s) * 16777619UL;
+    h = (h ^ (uint8_t)((uint16_t)s >> 8)) * 16777619UL;
+  }
+
+  return(h);
+}
+
+int main(int argc, char* argv[])
+{
+  MD_YM2413_Emu E;
+  MD_YM2413_Resample R;
+  uint32_t inRate = E.getSampleRate();
+  const char* writeFile = nullptr;
+  const char* checkFile = nullptr;
+  bool ok = true;
+  uint32_t h;
+
+  for (int i = 1; i < argc - 1; i += 2)
+  {
+    if (strcmp(argv[i], "-w") == 0) writeFile = argv[i + 1];
+    else if (strcmp(argv[i], "-c") == 0) checkFile = argv[i + 1];
+  }
+
+  printf("[MD_YM2413 Resampler Check]\nRESAMPLE_DSP %u, RESAMPLE_SSE2 %u, input %lu Hz",
+    RESAMPLE_DSP, RESAMPLE_SSE2, (unsigned long)inRate);
+
+  for (uint32_t outRate : OUT_RATE)
+  {
+    double worstSinad = 1000, worstReject = 1000, worstFreq = 0;
+    std::vector<int16_t> in(TONE_SAMPLES * 16);
+    std::vector<int16_t> out;
+    uint64_t samples = 0;
+
+    // the output rate is set by the 16.16 fixed point step worked out by 
+    // begin(), so the tones are fitted at that rate and not outRate
+    uint32_t step = (uint32_t)(((uint64_t)inRate << 16) / outRate);
+    double rate = (inRate * 65536.0) / step;
+
+    R.begin(inRate, outRate);
+    out.resize(R.getOutputSize(BLOCK));
+    printf("\n\nOutput %lu Hz (%.2f Hz), delay %u us\nFreq Hz\tgain dB\tSINAD dB", (unsigned long)outRate, rate, R.getDelay());
+    for (uint16_t f : TONE)
+    {
+      double gain, sinad;
+
+      R.reset();
+      fitTone(convert(R, tone(f, inRate), BLOCK), f, rate, gain, sinad);
+      printf("\n%u\t%.2f\t%.1f", f, gain, sinad);
+      if (sinad < worstSinad) worstSinad = sinad;
+    }
+
+    // stop band, and the level at half the output rate for 44.1kHz where
+    // it is in the transition band of the filter
+    for (uint32_t f = STOP_HZ; f < inRate / 2; f += 100)
+    {
+      double l;
+
+      R.reset();
+      l = -level(convert(R, tone(f, inRate), BLOCK));
+      if (l < worstReject)
+      {
+        worstReject = l;
+        worstFreq = f;
+      }
+    }
+    R.reset();
+    printf("\nSINAD %.1f dB (min %.0f)\nRejection %.1f dB at %u Hz, stop band %.1f dB at %.0f Hz (min %.0f)",
+      worstSinad, SINAD_MIN, -level(convert(R, tone(outRate / 2, inRate), BLOCK)), outRate / 2, 
+      worstReject, worstFreq, REJECT_MIN);
+    if (worstSinad < SINAD_MIN || worstReject < REJECT_MIN) ok = false;
+
+    // throughput
+    for (size_t i = 0; i < in.size(); i++)
+      in[i] = (int16_t)(i * 2654435761UL >> 16);
+    R.reset();
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t i = 0; i + BLOCK <= in.size(); i += BLOCK)
+      samples += R.process(&in[i], BLOCK, out.data());
+    double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    printf("\nThroughput %.1f M samples/s", samples / s / 1e6);
+  }
+
+  // output hash for the kernel check
+  R.begin(inRate, 44100);
+  h = hash(convert(R, testSignal(), 0));
+  printf("\n\nTest signal hash 0x%08lX", (unsigned long)h);
+  if (writeFile != nullptr)
+  {
+    FILE* fp = fopen(writeFile, "w");
+
+    if (fp == nullptr || fprintf(fp, "0x%08lX\n", (unsigned long)h) < 0) ok = false;
+    if (fp != nullptr) fclose(fp);
+  }
+  if (checkFile != nullptr)
+  {
+    FILE* fp = fopen(checkFile, "r");
+    unsigned long expect = 0;
+
+    if (fp == nullptr || fscanf(fp, "%lx", &expect) != 1)
+    {
+      printf(", no hash in %s", checkFile);
+      ok = false;
+    }
+    else
+    {
+      printf(", expected 0x%08lX %s", expect, (expect == h) ? "same" : "DIFFERENT");
+      if (expect != h) ok = false;
+    }
+    if (fp != nullptr) fclose(fp);
+  }
+
+  printf("\n\n%s\n", ok ? "PASSED" : "FAILED");
+
+  return(ok ? 0 : 1);
+}
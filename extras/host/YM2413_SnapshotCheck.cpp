@@ -0,0 +1,197 @@
+/*
+Check and time the MD_YM2413_Emu state snapshots.
+
+Each VGM file named on the command line (the VGM_TUNES of the
+VGM_Player_CLI example) is rendered on the emulator, saving a snapshot
+every second of the tune. The snapshots are then restored in reverse
+order and the tune is rendered again from each one, with the register
+writes that follow it, for up to a second. The samples must be the same
+as the first time they were rendered.
+
+For each tune the table shows
+- the number of snapshots.
+- the average host cycles to save and to restore a snapshot.
+- the average host cycles to render a sample over the whole tune.
+- the restore time as a number of rendered samples.
+- the check result.
+
+The totals line gives the figures over all the tunes, which are the ones
+in the library documentation.
+
+Usage: YM2413_SnapshotCheck file.vgm ...
+
+Part of the MD_YM2413 library host build, see extras/host.
+*/
+#include <Arduino.h>
+#include <MD_YM2413_Emu.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "YM2413_EmuTools.h"
+
+const uint16_t BLOCK_SIZE = 64;   // samples rendered in each block
+const uint8_t REPEAT = 16;        // times each save and restore is timed, the fastest is used
+
+MD_YM2413_Emu E;
+
+struct point_t
+{
+  size_t write;                   // next write in the tune
+  uint32_t sample;                // emulator samples rendered
+  uint8_t snap[MD_YM2413_Emu::SNAPSHOT_SIZE];
+};
+
+struct totals_t
+{
+  uint32_t snapshots;
+  uint64_t saveCycles;
+  uint64_t restoreCycles;
+  uint64_t renderCycles;
+  uint64_t samples;
+};
+
+uint32_t emuSample(uint32_t vgmSample)
+{
+  return(((uint64_t)vgmSample * E.getSampleRate()) / VGM_SAMPLE_RATE);
+}
+
+uint64_t renderTo(uint32_t target, uint32_t& samples, std::vector<int16_t>& out)
+// Render up to the emulator sample, adding the samples to out, and
+// return the cycles it took
+{
+  int16_t buf[BLOCK_SIZE];
+  uint64_t c = 0;
+
+  while (samples < target)
+  {
+    uint16_t count = (target - samples > BLOCK_SIZE) ? BLOCK_SIZE : target - samples;
+    uint64_t t = cycles();
+
+    E.render(buf, count);
+    c += cycles() - t;
+    out.insert(out.end(), buf, buf + count);
+    samples += count;
+  }
+
+  return(c);
+}
+
+bool checkTune(const vgm_t& v, totals_t& total)
+{
+  const uint32_t every = E.getSampleRate();   // samples between snapshots
+  std::vector<point_t> points;
+  std::vector<int16_t> first;     // samples from the first render
+  uint64_t saveCycles = 0, restoreCycles = 0, renderCycles = 0;
+  uint32_t samples = 0;
+  bool ok = true;
+
+  // first render, with the snapshots
+  E.begin();
+  for (size_t w = 0; w <= v.writes.size(); w++)
+  {
+    uint32_t sample = (w < v.writes.size()) ? v.writes[w].sample : v.end;
+
+    renderCycles += renderTo(emuSample(sample), samples, first);
+    if (samples >= points.size() * every)
+    {
+      uint64_t best = UINT64_MAX;
+
+      points.push_back(point_t{ w, samples, { 0 } });
+      for (uint8_t r = 0; r < REPEAT; r++)
+      {
+        uint64_t t = cycles();
+
+        E.saveState(points.back().snap);
+        t = cycles() - t;
+        if (t < best) best = t;
+      }
+      saveCycles += best;
+    }
+    if (w < v.writes.size())
+      E.write(v.writes[w].addr, v.writes[w].data);
+  }
+
+  // render again from each snapshot, last first
+  for (size_t i = points.size(); i-- > 0; )
+  {
+    const point_t& p = points[i];
+    std::vector<int16_t> again;
+    uint32_t end = p.sample + every;
+    uint64_t best = UINT64_MAX;
+
+    for (uint8_t r = 0; r < REPEAT; r++)
+    {
+      uint64_t t = cycles();
+
+      ok = E.restoreState(p.snap) && ok;
+      t = cycles() - t;
+      if (t < best) best = t;
+    }
+    restoreCycles += best;
+
+    samples = p.sample;
+    if (end > first.size()) end = first.size();
+    for (size_t w = p.write; w <= v.writes.size() && samples < end; w++)
+    {
+      uint32_t sample = (w < v.writes.size()) ? emuSample(v.writes[w].sample) : end;
+
+      renderTo(sample < end ? sample : end, samples, again);
+      if (w < v.writes.size() && samples < end)
+        E.write(v.writes[w].addr, v.writes[w].data);
+    }
+    if (!std::equal(again.begin(), again.end(), first.begin() + p.sample) || again.size() != end - p.sample)
+      ok = false;
+  }
+
+  printf("\n%-14s\t%u\t%.0f\t%.0f\t%.0f\t%.1f\t%s", v.name.c_str(), (unsigned)points.size(),
+    (double)saveCycles / points.size(), (double)restoreCycles / points.size(),
+    (double)renderCycles / first.size(),
+    ((double)restoreCycles / points.size()) / ((double)renderCycles / first.size()),
+    ok ? "PASS" : "FAIL");
+
+  total.snapshots += points.size();
+  total.saveCycles += saveCycles;
+  total.restoreCycles += restoreCycles;
+  total.renderCycles += renderCycles;
+  total.samples += first.size();
+
+  return(ok);
+}
+
+int main(int argc, char* argv[])
+{
+  totals_t total = {};
+  bool ok = true;
+
+  if (argc < 2)
+  {
+    fprintf(stderr, "Usage: YM2413_SnapshotCheck file.vgm ...\n");
+    return(2);
+  }
+
+  printf("[MD_YM2413 Emulator Snapshot Check]\nSnapshot %u bytes, version %u, EMU_SKIP_IDLE %u, cycles are %s",
+    MD_YM2413_Emu::SNAPSHOT_SIZE, MD_YM2413_Emu::SNAPSHOT_VERSION, EMU_SKIP_IDLE, CYCLES_NAME);
+  printf("\n\nFile          \tsnaps\tsave\trestore\tcyc/smp\trestore smp\tcheck");
+
+  for (int i = 1; i < argc; i++)
+  {
+    vgm_t v;
+
+    if (!loadVGM(argv[i], v))
+    {
+      printf("\n%s\tNOT A VGM FILE", argv[i]);
+      ok = false;
+      continue;
+    }
+    ok = checkTune(v, total) && ok;
+  }
+
+  if (total.snapshots != 0)
+    printf("\n%-14s\t%u\t%.0f\t%.0f\t%.0f\t%.1f", "Total", total.snapshots,
+      (double)total.saveCycles / total.snapshots, (double)total.restoreCycles / total.snapshots,
+      (double)total.renderCycles / total.samples,
+      ((double)total.restoreCycles / total.snapshots) / ((double)total.renderCycles / total.samples));
+  printf("\n\n%s\n", ok ? "PASSED" : "FAILED");
+
+  return(ok ? 0 : 1);
+}
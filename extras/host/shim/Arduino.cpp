@@ -0,0 +1,161 @@
+/*
+Arduino API shim to build the MD_YM2413 library on a host computer.
+
+See Arduino.h and YM2413_Host.h.
+*/
+#include <Arduino.h>
+#include "YM2413_Host.h"
+
+HardwareSerial Serial;
+
+namespace host
+{
+  // Round figures for the standard cores.
+  // digitalWrite() looks up the port and mask for the pin each call,
+  // which is about 55 cycles on an AVR and far less on a fast ARM.
+  const board_t boards[] =
+  {
+    { "uno",     3500, 3000 },    // ATmega328P 16MHz
+    { "zero",    1000,  800 },    // SAMD21 48MHz
+    { "teensy4",   15,   30 },    // i.MX RT1062 600MHz
+  };
+  const uint8_t BOARD_COUNT = sizeof(boards) / sizeof(boards[0]);
+
+  counters_t count;
+
+  static const board_t* _board = &boards[0];
+  static uint64_t _ns = 0;
+  static pinHook_t _pinHook = nullptr;
+  static uint8_t _pin[256];
+  static uint32_t _seed = 1;
+
+  const board_t* findBoard(const char* name)
+  {
+    for (uint8_t i = 0; i < BOARD_COUNT; i++)
+      if (strcmp(name, boards[i].name) == 0)
+        return(&boards[i]);
+
+    return(nullptr);
+  }
+
+  void setBoard(const board_t& b) { _board = &b; }
+  const board_t& getBoard(void) { return(*_board); }
+
+  void clearCount(void) { memset(&count, 0, sizeof(count)); }
+
+  uint64_t now(void) { return(_ns); }
+  void advance(uint64_t ns) { _ns += ns; }
+
+  void reset(void)
+  {
+    _ns = 0;
+    memset(_pin, LOW, sizeof(_pin));
+    clearCount();
+  }
+
+  void setPinHook(pinHook_t f) { _pinHook = f; }
+
+  static void wait(uint64_t ns)
+  {
+    _ns += ns;
+    count.waitNs += ns;
+  }
+
+  static void timeCall(void)
+  {
+    count.timeCalls++;
+    wait(_board->timeNs);
+  }
+
+  static int pinState(uint8_t pin) { return(_pin[pin]); }
+
+  static void pinWrite(uint8_t pin, uint8_t value)
+  {
+    _ns += _board->pinNs;
+    count.pinWrites++;
+    count.pinNs += _board->pinNs;
+    _pin[pin] = value ? HIGH : LOW;
+    if (_pinHook != nullptr)
+      _pinHook(pin, _pin[pin], _ns);
+  }
+
+  static long rand31(void)
+  {
+    _seed = (_seed * 1103515245UL) + 12345;
+    return((_seed >> 1) & 0x7fffffff);
+  }
+
+  static void seed(unsigned long s) { _seed = s; }
+}
+
+// Digital I/O
+void pinMode(uint8_t, uint8_t) {}
+void digitalWrite(uint8_t pin, uint8_t value) { host::pinWrite(pin, value); }
+int digitalRead(uint8_t pin) { return(host::pinState(pin)); }
+
+// Time
+unsigned long millis(void)
+{
+  host::timeCall();
+  return((unsigned long)(host::now() / 1000000));
+}
+
+unsigned long micros(void)
+{
+  host::timeCall();
+  return((unsigned long)(host::now() / 1000));
+}
+
+void delay(unsigned long ms) { host::wait((uint64_t)ms * 1000000); }
+void delayMicroseconds(unsigned int us) { host::wait((uint64_t)us * 1000); }
+void yield(void) {}
+
+// Maths
+long random(long howbig) { return(howbig <= 0 ? 0 : host::rand31() % howbig); }
+long random(long howsmall, long howbig) { return(howsmall >= howbig ? howsmall : howsmall + random(howbig - howsmall)); }
+void randomSeed(unsigned long seed) { host::seed(seed); }
+
+// Print
+size_t Print::write(const uint8_t* buf, size_t size)
+{
+  size_t n = 0;
+
+  while (size--)
+    n += write(*buf++);
+
+  return(n);
+}
+
+size_t Print::print(long n, int base)
+{
+  if (base == DEC && n < 0)
+    return(print('-') + print((unsigned long)-n, base));
+
+  return(print((unsigned long)n, base));
+}
+
+size_t Print::print(unsigned long n, int base)
+{
+  char buf[8 * sizeof(long) + 1];
+  char* p = &buf[sizeof(buf) - 1];
+
+  if (base < 2) base = DEC;
+  *p = '\0';
+  do
+  {
+    uint8_t d = n % base;
+
+    *--p = (d < 10) ? '0' + d : 'A' + d - 10;
+    n /= base;
+  } while (n != 0);
+
+  return(write(p));
+}
+
+size_t Print::print(double n, int digits)
+{
+  char buf[48];
+
+  snprintf(buf, sizeof(buf), "%.*f", digits, n);
+  return(write(buf));
+}
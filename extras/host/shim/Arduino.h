@@ -0,0 +1,129 @@
+/*
+Arduino API shim to build the MD_YM2413 library on a host computer.
+
+Only the parts of the Arduino API used by the library and the sketches
+built by the host project are provided. Time is simulated - it only
+moves forward when the code calls the Arduino API, by the time each call
+would take on the board being modelled (see YM2413_Host.h). This makes
+every run repeatable and lets a program count the cost of the bus writes
+without the real hardware.
+
+Part of the MD_YM2413 library host build, see extras/host.
+*/
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+// Program memory is ordinary memory on the host
+#define PROGMEM
+#define PSTR(s) (s)
+#define pgm_read_byte(p)  (*(const uint8_t*)(p))
+#define pgm_read_word(p)  (*(const uint16_t*)(p))
+#define pgm_read_dword(p) (*(const uint32_t*)(p))
+#define pgm_read_ptr(p)   (*(void* const*)(p))
+#define memcpy_P  memcpy
+#define strlen_P  strlen
+#define strcpy_P  strcpy
+#define strcmp_P  strcmp
+
+class __FlashStringHelper;
+#define F(s) ((const __FlashStringHelper*)(s))
+
+// Digital I/O
+#define LOW     0
+#define HIGH    1
+#define INPUT   0
+#define OUTPUT  1
+#define INPUT_PULLUP 2
+
+// Analog pins as digital pins, numbered as for the Uno
+#define A0  14
+#define A1  15
+#define A2  16
+#define A3  17
+#define A4  18
+#define A5  19
+#define LED_BUILTIN 13
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+
+// Time
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield(void);
+inline void noInterrupts(void) {}
+inline void interrupts(void) {}
+
+// Maths
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+template<class T, class U> inline auto min(T a, U b) -> decltype(a < b ? a : b) { return(a < b ? a : b); }
+template<class T, class U> inline auto max(T a, U b) -> decltype(a > b ? a : b) { return(a > b ? a : b); }
+template<class T, class L, class H> inline T constrain(T x, L lo, H hi) { return(x < lo ? lo : (x > hi ? hi : x)); }
+
+// Print and Stream, sent to stdout
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+class Print
+{
+public:
+  virtual ~Print(void) {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buf, size_t size);
+  size_t write(const char* s) { return(write((const uint8_t*)s, strlen(s))); }
+
+  size_t print(const __FlashStringHelper* s) { return(print((const char*)s)); }
+  size_t print(const char* s) { return(write(s)); }
+  size_t print(char c) { return(write((uint8_t)c)); }
+  size_t print(unsigned char n, int base = DEC) { return(print((unsigned long)n, base)); }
+  size_t print(int n, int base = DEC) { return(print((long)n, base)); }
+  size_t print(unsigned int n, int base = DEC) { return(print((unsigned long)n, base)); }
+  size_t print(long n, int base = DEC);
+  size_t print(unsigned long n, int base = DEC);
+  size_t print(double n, int digits = 2);
+
+  size_t println(void) { return(write((uint8_t)'\n')); }
+  template<class T> size_t println(T v) { size_t n = print(v); return(n + println()); }
+  template<class T> size_t println(T v, int b) { size_t n = print(v, b); return(n + println()); }
+};
+
+class Stream : public Print
+{
+public:
+  virtual int available(void) = 0;
+  virtual int read(void) = 0;
+  virtual int peek(void) = 0;
+};
+
+class HardwareSerial : public Stream
+{
+public:
+  void begin(unsigned long) {}
+  void end(void) {}
+  int available(void) { return(0); }
+  int read(void) { return(-1); }
+  int peek(void) { return(-1); }
+  void flush(void) { fflush(stdout); }
+  size_t write(uint8_t c) { return(fputc(c, stdout) == EOF ? 0 : 1); }
+  using Print::write;
+  operator bool(void) { return(true); }
+};
+
+extern HardwareSerial Serial;
@@ -0,0 +1,66 @@
+/*
+Host simulation controls for the Arduino API shim.
+
+The shim keeps a simulated clock in ns. Each Arduino call moves the clock
+on by the time it takes on the board being modelled, so the time spent in
+the library bus writes, and the waits between them, can be worked out on
+the host:
+- digitalWrite() takes pinNs.
+- micros() and millis() take timeNs, so a busy wait that polls micros()
+  moves the clock on until the wait is over.
+- delay() and delayMicroseconds() take the time asked for.
+Nothing else takes any time, so the results are the bus cost of a call
+and not its processing time.
+
+The board timings are round figures for the standard Arduino cores, good
+enough to see where the bus time goes, and not exact for any board.
+
+A pin hook is called for every digitalWrite() with the time the pin
+changes, so a test can watch the bus as a logic analyser would.
+
+Part of the MD_YM2413 library host build, see extras/host.
+*/
+#pragma once
+
+#include <stdint.h>
+
+namespace host
+{
+  /**
+  * Board timing model
+  */
+  struct board_t
+  {
+    const char* name;   ///< short name used on the command line
+    uint16_t pinNs;     ///< time for a digitalWrite() in ns
+    uint16_t timeNs;    ///< time for a micros() or millis() in ns
+  };
+
+  extern const board_t boards[];  ///< known boards, the first is the default
+  extern const uint8_t BOARD_COUNT; ///< number of boards in boards[]
+
+  const board_t* findBoard(const char* name);  ///< board by name, nullptr if not known
+  void setBoard(const board_t& b);  ///< set the board timing model
+  const board_t& getBoard(void);    ///< the current board timing model
+
+  /**
+  * Cost counters, cleared by clearCount()
+  */
+  struct counters_t
+  {
+    uint32_t pinWrites;   ///< digitalWrite() calls
+    uint32_t timeCalls;   ///< micros() and millis() calls
+    uint64_t pinNs;       ///< ns spent in digitalWrite()
+    uint64_t waitNs;      ///< ns spent in micros(), millis() and delays
+  };
+
+  extern counters_t count;        ///< cost counters
+  void clearCount(void);          ///< clear the cost counters
+
+  uint64_t now(void);             ///< simulated time in ns
+  void advance(uint64_t ns);      ///< move the clock on, eg for application processing
+  void reset(void);               ///< clock and counters to zero, pins LOW
+
+  typedef void (*pinHook_t)(uint8_t pin, uint8_t value, uint64_t ns);  ///< pin change callback
+  void setPinHook(pinHook_t f);   ///< call f for each digitalWrite(), nullptr to stop
+}
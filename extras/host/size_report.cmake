@@ -0,0 +1,15 @@
+# Compile each example with arduino-cli and show the flash and RAM it uses.
+# Run by the SizeReport target with CLI, FQBN and LIB set.
+# Examples that do not build for the board (eg, too large) are listed as such.
+file(GLOB sketches LIST_DIRECTORIES true ${LIB}/examples/*)
+message("Size report for ${FQBN}\nExample\tFlash\tRAM")
+foreach(sketch ${sketches})
+  get_filename_component(name ${sketch} NAME)
+  execute_process(COMMAND ${CLI} compile --fqbn ${FQBN} --library ${LIB} ${sketch}
+    OUTPUT_VARIABLE out ERROR_VARIABLE out RESULT_VARIABLE result)
+  if(result EQUAL 0 AND out MATCHES "Sketch uses ([0-9]+) bytes.*Global variables use ([0-9]+) bytes")
+    message("${name}\t${CMAKE_MATCH_1}\t${CMAKE_MATCH_2}")
+  else()
+    message("${name}\tdoes not build for ${FQBN}")
+  endif()
+endforeach()
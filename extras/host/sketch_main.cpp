@@ -0,0 +1,25 @@
+/*
+main() for running an Arduino sketch on the host.
+
+Runs setup() and then loop() the number of times given on the command
+line (none by default), so sketches that do all their work in setup()
+run to the end.
+
+Part of the MD_YM2413 library host build, see extras/host.
+*/
+#include <Arduino.h>
+
+void setup(void);
+void loop(void);
+
+int main(int argc, char* argv[])
+{
+  unsigned long loops = (argc > 1) ? strtoul(argv[1], nullptr, 0) : 0;
+
+  setup();
+  while (loops--)
+    loop();
+  Serial.println();
+
+  return(0);
+}
@@ -13,22 +13,65 @@ See header file for copyright and licensing comments.
 
 // Class methods
 MD_YM2413::MD_YM2413(const uint8_t* D, uint8_t we, uint8_t a0):
-_D(D), _we(we), _a0(a0)
-{ }
+_D(D), _we(we), _a0(a0), _cbWrite(nullptr), _cbDevice(nullptr)
+{ 
+#if CLOCK_RUNTIME
+  _clockHz = CLOCK_HZ;
+#endif
+}
+
+MD_YM2413::MD_YM2413(cbWrite_t device):
+_D(nullptr), _we(0), _a0(0), _cbWrite(nullptr), _cbDevice(device)
+{ 
+#if CLOCK_RUNTIME
+  _clockHz = CLOCK_HZ;
+#endif
+}
 
 void MD_YM2413::begin(void)
 {
   // Set all pins to outputs and initialize
-  for (int8_t i = 0; i < DATA_BITS; i++)
-    pinMode(_D[i], OUTPUT);
-  pinMode(_we, OUTPUT);
-  pinMode(_a0, OUTPUT);
+  if (_D != nullptr)
+  {
+    for (int8_t i = 0; i < DATA_BITS; i++)
+      pinMode(_D[i], OUTPUT);
+    pinMode(_we, OUTPUT);
+    pinMode(_a0, OUTPUT);
+
+    digitalWrite(_we, HIGH);
+  }
 
-  digitalWrite(_we, HIGH);
+#if WRITE_BUDGET
+  _wCount = 0;
+  setWriteBudget(WRITE_BUDGET);
+  resetWriteStats();
+#endif
+#if CLOCK_RUNTIME
+  initClock();
+#endif
+  _lastAddress = 0xff;    // not a register, so the first address is always sent
+  _busTime = micros();
+  _busWait = 0;
+  _suspended = false;
+#if LIB_STATS
+  _statsDepth = 0;
+#endif
+
+  // no master fade or ducking
+  _fadeMaster.level = _fadeMaster.target = 0;
+  _fadeDuck.level = _fadeDuck.target = 0;
+  _duckMask = 0;
+  _fadeDirty = 0;
+  _fadeScan = CHAN_SLOT_BASE;
+  _fadeWrites = FADE_WRITES_DEFAULT;
 
   // initialize the hardware defaults
   send(R_TEST_CTL_REG, 0);    // never test mode
   setPercussion(false);       // all instruments to default (below)
+  flush();                    // set up without waiting for the budget
+#if LIB_STATS
+  resetStats();               // count from here
+#endif
 }
 
 void MD_YM2413::initChannels(void)
@@ -36,7 +79,7 @@ void MD_YM2413::initChannels(void)
   for (uint8_t i = 0; i < countChannels(); i++)
   {
     setInstrument(i, DEFAULT_INSTRUMENT, VOL_MAX);
-    _C[i].state = IDLE;
+    C(i).state = IDLE;
   }
 }
 
@@ -44,8 +87,8 @@ bool MD_YM2413::isIdle(uint8_t chan)
 {
   bool b = false;
 
-  if (chan < countChannels())
-    b = (_C[chan].state == IDLE);
+  if (isValid(chan))
+    b = (C(chan).state == IDLE);
 
   return(b);
 }
@@ -67,8 +110,15 @@ bool MD_YM2413::isPercussion(uint8_t chan)
 void MD_YM2413::setPercussion(bool enable)
 // Set the library and hardware to include or exclude percussion instruments
 {
+  STAT_CALL(STAT_PERCUSSION);
+
   uint8_t x = 0;
 
+#if CHANNEL_MODE == CHANNEL_MODE_MELODY
+  enable = false;   // no percussion channel slots in this build
+#elif CHANNEL_MODE == CHANNEL_MODE_RHYTHM
+  enable = true;    // only percussion channel slots in this build
+#endif
   _enablePercussion = enable;
 
   // enable/disable the mode in hardware
@@ -97,16 +147,21 @@ void MD_YM2413::setPercussion(bool enable)
 bool MD_YM2413::setInstrument(uint8_t chan, instrument_t instr, uint8_t vol)
 // 'attach' the specified instrument to the channel
 {
-  if (chan >= countChannels() ||    // not a valid channel
+  STAT_CALL(STAT_INSTRUMENT);
+
+  if (!isValid(chan) ||    // not a valid channel
+     instr > P_BASS_DRUM ||   // not a valid instrument
      (!isPercussion() && instr >= P_HI_HAT))  // not a valid instrument for this mode
     return(false);
 
-  _C[chan].instrument = instr;
-  _C[chan].vol = vol;
+  if (vol > VOL_MAX) vol = VOL_MAX;   // sanity bound the volume
+  C(chan).instrument = instr;
+  C(chan).vol = vol;
   if (!isPercussion() ||      // not in percussion mode or ...
     (isPercussion() && (chan < PART_INSTR_CHANNELS))) // ... percussion on, but not a percussion channel
   {
-    send(R_CHAN_CTL_BASE_REG + chan, (_C[chan].instrument << R_CHAN_INST_BIT) | (VOL(_C[chan].vol) << R_CHAN_VOL_BIT));
+    send(R_CHAN_CTL_BASE_REG + chan, (C(chan).instrument << R_CHAN_INST_BIT) | (calcAtten(chan) << R_CHAN_VOL_BIT));
+    _fadeDirty &= ~(1 << chan);
   }
 
   return(true);
@@ -114,6 +169,8 @@ bool MD_YM2413::setInstrument(uint8_t chan, instrument_t instr, uint8_t vol)
 
 void MD_YM2413::loadInstrumentOPL2(const uint8_t *ins, bool fromPROGMEM)
 {
+  STAT_CALL(STAT_LOAD);
+
   uint8_t inst[OPL2_DATA_SIZE];
   uint8_t data[8];
   uint8_t t;
@@ -146,53 +203,85 @@ void MD_YM2413::loadInstrumentOPL2(const uint8_t *ins, bool fromPROGMEM)
   loadInstrument(data);
 }
 
+void MD_YM2413::loadInstrument(const uint8_t* data)
+{
+  STAT_CALL(STAT_LOAD);
+
+  for (uint8_t i = 0; i < 8; i++)
+    send(i, data[i]);
+}
+
 void MD_YM2413::setVolume(uint8_t chan, uint8_t v)
 // Set the volume set point for channel and remember the setting
 // Application values are 0-15 for min to max. Attenuator values
 // are the complement of this (15-0).
 {
-  uint8_t addr, data = 0;
+  STAT_CALL(STAT_VOLUME);
 
-  if (chan >= countChannels())
+  if (!isValid(chan))
     return;
 
   if (v > VOL_MAX) v = VOL_MAX;   // sanity bound the volume
-  _C[chan].vol = v;
+  C(chan).vol = v;
+  writeVolume(chan);
+}
+
+uint8_t MD_YM2413::calcAtten(uint8_t chan)
+// Work out the hardware attenuation for the channel from the 
+// set point, master volume and ducking.
+{
+  uint8_t a = VOL(C(chan).vol) + _fadeMaster.level;
+
+  if (_duckMask & (1 << chan))
+    a += _fadeDuck.level;
+
+  return(a > VOL_MAX ? VOL_MAX : a);
+}
+
+void MD_YM2413::writeVolume(uint8_t chan)
+// Send the volume register for the channel
+{
+  uint8_t addr, data = 0;
 
   if (!isPercussion() ||      // not in percussion mode
     (isPercussion() && (chan < PERC_CHAN_BASE))) // percussion on, but not a percussion channel
   {
     addr = R_CHAN_CTL_BASE_REG + chan;
-    data = (_C[chan].instrument << R_CHAN_INST_BIT) | (VOL(_C[chan].vol) << R_CHAN_VOL_BIT);
+    data = (C(chan).instrument << R_CHAN_INST_BIT) | (calcAtten(chan) << R_CHAN_VOL_BIT);
+    _fadeDirty &= ~(1 << chan);
   }
   else
   {
     // Percussion mode is on and this is a percussion channel. 
     // These need to be sent in pairs as the registers
     // are organized in nibbles for different percussion instruments
-    switch (_C[chan].instrument)
+    switch (chan)
     {
-    case P_BASS_DRUM:
+    case CH_BD:
       addr = R_PERC_VOL_BD_REG;
-      data = (VOL(_C[CH_BD - PERC_CHAN_BASE].vol) << R_PERC_VOL_BD_BIT);
+      data = (calcAtten(CH_BD) << R_PERC_VOL_BD_BIT);
+      _fadeDirty &= ~(1 << CH_BD);
       break;
 
-    case P_HI_HAT:
-    case P_SNARE_DRUM:
+    case CH_HH:
+    case CH_SD:
       addr = R_PERC_VOL_HHSD_REG;
-      data = (VOL(_C[CH_HH - PERC_CHAN_BASE].vol) << R_PERC_VOL_HH_BIT);
-      data |= (VOL(_C[CH_SD - PERC_CHAN_BASE].vol) << R_PERC_VOL_SD_BIT);
+      data = (calcAtten(CH_HH) << R_PERC_VOL_HH_BIT);
+      data |= (calcAtten(CH_SD) << R_PERC_VOL_SD_BIT);
+      _fadeDirty &= ~((1 << CH_HH) | (1 << CH_SD));
       break;
 
-    case P_TOM_TOM:
-    case P_TOP_CYMBAL:
+    case CH_TOM:
+    case CH_TCY:
       addr = R_PERC_VOL_TOMTCY_REG;
-      data = (VOL(_C[CH_TOM - PERC_CHAN_BASE].vol) << R_PERC_VOL_TOM_BIT);
-      data |= (VOL(_C[CH_TCY - PERC_CHAN_BASE].vol) << R_PERC_VOL_TCY_BIT);
+      data = (calcAtten(CH_TOM) << R_PERC_VOL_TOM_BIT);
+      data |= (calcAtten(CH_TCY) << R_PERC_VOL_TCY_BIT);
+      _fadeDirty &= ~((1 << CH_TOM) | (1 << CH_TCY));
       break;
 
     default:    // remove compiler warnings
-      break;
+      _fadeDirty &= ~(1 << chan);
+      return;
     }
   }
 
@@ -200,9 +289,23 @@ void MD_YM2413::setVolume(uint8_t chan, uint8_t v)
   send(addr, data);
 }
 
+void MD_YM2413::noteVolume(uint8_t chan, uint8_t vol)
+// Set the volume for a note on. A melodic channel register that 
+// already holds this setting (eg, just written by a program change)
+// is not sent again. Percussion registers are shared by channel 
+// pairs and not written by setInstrument(), so they are always sent.
+{
+  if (vol > VOL_MAX) vol = VOL_MAX;
+
+  if (isPercussion(chan) || vol != C(chan).vol || (_fadeDirty & (1 << chan)))
+    setVolume(chan, vol);
+}
+
 void MD_YM2413::setVolume(uint8_t v)
 // Set the same volume set point for all channels
 {
+  STAT_CALL(STAT_VOLUME);
+
   for (int8_t i = 0; i < countChannels(); i++)
     setVolume(i, v);
 }
@@ -210,123 +313,475 @@ void MD_YM2413::setVolume(uint8_t v)
 void MD_YM2413::noteOn(uint8_t chan, uint16_t freq, uint8_t vol, uint16_t duration)
 // turn on a note by specifying a frequency
 {
+  STAT_CALL(STAT_NOTE_ON);
+
   uint8_t data;
 
-  DEBUG("\nnoteOn C", chan);
-  DEBUG(" F", freq);
+  TRACE(EV_NOTE_ON_FREQ, chan, freq);
 
-  if (chan > countChannels())
+  if (!isValid(chan))
     return;
 
-  setVolume(chan, vol);
+  noteVolume(chan, vol);
   if (!isPercussion(chan))
   {
-    _C[chan].octave = calcBlock(freq);
-    _C[chan].fNum = calcFNum(freq, _C[chan].octave);
-    DEBUG(" -> B", _C[chan].octave);
-    DEBUG(" FNum", _C[chan].fNum);
-    data = buildReg2x(_C[chan].sustain, true, _C[chan].octave, _C[chan].fNum);
+    uint8_t block;
+
+    C(chan).fNum = calcFNum(freq, block);
+    C(chan).octave = block;
+    TRACE(EV_FNUM, chan, (C(chan).octave << 9) | C(chan).fNum);
+    data = buildReg2x(C(chan).sustain, true, C(chan).octave, C(chan).fNum);
 
     // send the fnum data and then the note on request
-    send(R_FNUM_BASE_REG + chan, _C[chan].fNum & 0xff);
+    send(R_FNUM_BASE_REG + chan, C(chan).fNum & 0xff);
     send(R_INST_CTL_BASE_REG + chan, data);
   }
   else
   {
     // this is a percussion channel
-    data = buildReg0e(true, _C[chan].instrument, true);
+    data = buildReg0e(true, (instrument_t)C(chan).instrument, true);
 
     // send the data across
     send(R_RHYTHM_CTL_REG, data);
   }
 
   // common data 
-  _C[chan].frequency = freq;
-  _C[chan].duration = duration;
-  _C[chan].timeBase = millis();
-  _C[chan].state = SUSTAIN;
+  C(chan).note = NOTE_UNDEFINED;
+  C(chan).duration = duration;
+  C(chan).timeBase = millis();
+  C(chan).state = SUSTAIN;
 }
 
 void MD_YM2413::noteOn(uint8_t chan, uint8_t octave, uint8_t note, uint8_t vol, uint16_t duration)
 // turn on a note by specifying the octave and note number
 {
+  STAT_CALL(STAT_NOTE_ON);
+
   uint8_t data;
 
-  DEBUG("\nnoteOn C", chan);
-  DEBUG(" O", octave);
-  DEBUG(" N", note);
+  TRACE(EV_NOTE_ON, chan, (octave << 8) | note);
 
-  if (note >= ARRAY_SIZE(_fNumTable) || chan >= countChannels())
+  if (note >= NOTES_PER_OCTAVE || !isValid(chan))
     return;
 
   if (!isPercussion(chan))
   {
     if (octave < MIN_OCTAVE) octave = MIN_OCTAVE;
     if (octave > MAX_OCTAVE) octave = MAX_OCTAVE;
-    _C[chan].octave = octave;
-    note = min(note, ARRAY_SIZE(_fNumTable)-1);   // bound it;
-    _C[chan].fNum = pgm_read_word(&_fNumTable[note]);
-    DEBUG(" -> B", _C[chan].octave);
-    DEBUG(" FNum", _C[chan].fNum);
-    data = buildReg2x(_C[chan].sustain, true, _C[chan].octave, _C[chan].fNum);
+    C(chan).octave = octave;
+    C(chan).fNum = fNumNote(note);
+    TRACE(EV_FNUM, chan, (C(chan).octave << 9) | C(chan).fNum);
+    data = buildReg2x(C(chan).sustain, true, C(chan).octave, C(chan).fNum);
 
     // send the fnum data and then the note on request
-    send(R_FNUM_BASE_REG + chan, _C[chan].fNum & 0xff);
+    send(R_FNUM_BASE_REG + chan, C(chan).fNum & 0xff);
     send(R_INST_CTL_BASE_REG + chan, data);
   }
   else
   {
     // this is a percussion channel
-    data = buildReg0e(true, _C[chan].instrument, true);
+    data = buildReg0e(true, (instrument_t)C(chan).instrument, true);
 
     // send the data across
     send(R_RHYTHM_CTL_REG, data);
   }
 
   // common data
-  setVolume(chan, vol);
-  _C[chan].frequency = 0;   // not used
-  _C[chan].duration = duration;
-  _C[chan].timeBase = millis();
-  _C[chan].state = SUSTAIN;
+  noteVolume(chan, vol);
+  C(chan).note = (octave * NOTES_PER_OCTAVE) + note;
+  C(chan).duration = duration;
+  C(chan).timeBase = millis();
+  C(chan).state = SUSTAIN;
+}
+
+void MD_YM2413::bendNote(uint8_t chan, int16_t bend)
+// Change the pitch of the current note relative to the original note
+{
+  STAT_CALL(STAT_BEND);
+
+  int32_t semi;
+  uint8_t frac, note, octave, reg;
+  uint16_t f0, f1;
+
+  if (!isValid(chan) || isPercussion(chan) || C(chan).note == NOTE_UNDEFINED)
+    return;
+
+  // split the bend into whole semitones and fraction of a semitone
+  semi = ((int32_t)C(chan).note << 8) + bend;
+  if (semi < 0) semi = 0;
+  frac = semi & 0xff;
+  semi >>= 8;
+  if (semi >= 8 * NOTES_PER_OCTAVE)   // above the highest block
+  {
+    semi = (8 * NOTES_PER_OCTAVE) - 1;
+    frac = 0;
+  }
+  octave = semi / NOTES_PER_OCTAVE;
+  note = semi % NOTES_PER_OCTAVE;
+
+  // interpolate between this and the next semitone, the 
+  // next semitone after B is the C at double the F-Num
+  f0 = fNumNote(note);
+  f1 = (note == NOTES_PER_OCTAVE - 1) ? fNumNote(0) << 1 : fNumNote(note + 1);
+  f0 += ((uint32_t)(f1 - f0) * frac) >> 8;
+
+  TRACE(EV_BEND, chan, (octave << 9) | f0);
+
+  // only send what has changed, keeping the current key state
+  reg = buildReg2x(C(chan).sustain, C(chan).state != IDLE, octave, f0);
+  if ((f0 & 0xff) != (C(chan).fNum & 0xff))
+    send(R_FNUM_BASE_REG + chan, f0 & 0xff);
+  if (reg != buildReg2x(C(chan).sustain, C(chan).state != IDLE, C(chan).octave, C(chan).fNum))
+    send(R_INST_CTL_BASE_REG + chan, reg);
+  C(chan).octave = octave;
+  C(chan).fNum = f0;
 }
 
 void MD_YM2413::noteOff(uint8_t chan)
 // turn off a note
 {
+  STAT_CALL(STAT_NOTE_OFF);
+
   uint8_t data;
 
-  DEBUG("\nnoteOff C", chan);
+  TRACE(EV_NOTE_OFF, chan, 0);
+
+  if (!isValid(chan))
+    return;
 
   setVolume(chan, VOL_OFF);   // silence it  as well as turn off
   if (!isPercussion(chan))
   {
-    data = buildReg2x(_C[chan].sustain, false, _C[chan].octave, _C[chan].fNum);
+    data = buildReg2x(C(chan).sustain, false, C(chan).octave, C(chan).fNum);
     send(R_INST_CTL_BASE_REG + chan, data);
   }
   else
   {
     // this is a percussion channel
-    data = buildReg0e(true, _C[chan].instrument, false);
+    data = buildReg0e(true, (instrument_t)C(chan).instrument, false);
 
     // send the data across
     send(R_RHYTHM_CTL_REG, data);
   }
 
   // common data
-  _C[chan].state = IDLE;
+  C(chan).state = IDLE;
 }
 
 void MD_YM2413::run(void)
 // If channel has duration configured, wait for the duration to 
 // expire and turn the note off.
 {
-  for (uint8_t chan = 0; chan < countChannels(); chan++)
-    if (_C[chan].state == SUSTAIN && _C[chan].duration != 0)
+  STAT_CALL(STAT_RUN);
+
+#if WRITE_BUDGET
+  _wNow = micros();
+  flushWrites();
+#endif
+
+  runFade();
+
+  if (_suspended)   // durations are held
+    return;
+
+  for (uint8_t chan = CHAN_SLOT_BASE; chan < countChannels(); chan++)
+    if (C(chan).state == SUSTAIN && C(chan).duration != 0)
     {
-      if (millis() - _C[chan].timeBase >= _C[chan].duration)
+      if (millis() - C(chan).timeBase >= C(chan).duration)
         noteOff(chan);
     }
 }
 
+void MD_YM2413::suspend(void)
+// Key off the channels playing, keeping the channel state
+{
+  STAT_CALL(STAT_SUSPEND);
+
+  TRACE(EV_SUSPEND, 0, 0);
+
+  if (_suspended)
+    return;
+
+  _suspended = true;
+  _suspendTime = millis();
+
+  // Release without the sustain so the notes die away during the pause.
+  // Only the channels the library knows are playing are keyed off.
+  for (uint8_t chan = CHAN_SLOT_BASE; chan < countChannels(); chan++)
+    if (!isPercussion(chan) && C(chan).state == SUSTAIN)
+      send(R_INST_CTL_BASE_REG + chan, buildReg2x(false, false, C(chan).octave, C(chan).fNum));
+
+  if (isPercussion())
+    send(R_RHYTHM_CTL_REG, buildReg0e(true, I_UNDEFINED, false));
+}
+
+void MD_YM2413::resume(void)
+// Key on the channels still playing and restart their durations
+{
+  STAT_CALL(STAT_SUSPEND);
+
+  uint32_t now = millis();
+  uint8_t keys = 0;
+
+  TRACE(EV_RESUME, 0, 0);
+
+  if (!_suspended)
+    return;
+
+  _suspended = false;   // key on writes are allowed again
+
+  for (uint8_t chan = CHAN_SLOT_BASE; chan < countChannels(); chan++)
+  {
+    if (C(chan).state != SUSTAIN)
+      continue;
+
+    // A percussion hit with no duration is a single hit that was released
+    // by suspend(), so it is finished rather than hit again.
+    if (isPercussion(chan) && C(chan).duration == 0)
+    {
+      C(chan).state = IDLE;
+      continue;
+    }
+
+    // Move the start time on by the time suspended. Notes started while 
+    // suspended start counting from now.
+    if ((int32_t)(C(chan).timeBase - _suspendTime) > 0)
+      C(chan).timeBase = now;
+    else
+      C(chan).timeBase += now - _suspendTime;
+
+    // The instrument, volume and F-Num registers were all sent while
+    // suspended, so only the key registers need to be written.
+    if (isPercussion(chan))
+      keys |= (1 << (chan - PERC_CHAN_BASE));
+    else
+      send(R_INST_CTL_BASE_REG + chan, buildReg2x(C(chan).sustain, true, C(chan).octave, C(chan).fNum));
+  }
+
+  // all the percussion keys in one write, after the melodic keys
+  if (keys != 0)
+    send(R_RHYTHM_CTL_REG, buildReg0e(true, I_UNDEFINED, false) | keys);
+}
+
+uint16_t MD_YM2413::getRemaining(uint8_t chan)
+{
+  uint32_t t;
+
+  if (!isValid(chan) || C(chan).state != SUSTAIN || C(chan).duration == 0)
+    return(0);
+
+  // time played so far, not counting the time suspended
+  if (!_suspended)
+    t = millis() - C(chan).timeBase;
+  else if ((int32_t)(C(chan).timeBase - _suspendTime) > 0)
+    t = 0;    // started while suspended
+  else
+    t = _suspendTime - C(chan).timeBase;
+
+  return((t >= C(chan).duration) ? 0 : C(chan).duration - t);
+}
+
+void MD_YM2413::setFade(fade_t& f, uint8_t target, uint16_t ms)
+// Set the fade to step from the current level to the target over the time
+{
+  uint8_t steps = (f.level > target) ? f.level - target : target - f.level;
+
+  f.target = target;
+  f.stepTime = (steps == 0) ? 0 : ms / steps;
+  f.timeLast = millis();
+}
+
+bool MD_YM2413::stepFade(fade_t& f)
+// Move the fade one step towards the target if the step time is up.
+// Return true if the level has changed.
+{
+  if (f.level == f.target || millis() - f.timeLast < f.stepTime)
+    return(false);
+
+  if (f.stepTime == 0)          // no time, go straight there
+    f.level = f.target;
+  else
+  {
+    f.timeLast += f.stepTime;
+    if (f.level < f.target) f.level++; else f.level--;
+  }
+
+  return(true);
+}
+
+void MD_YM2413::fadeTo(uint8_t level, uint16_t ms)
+{
+  if (level > VOL_MAX) level = VOL_MAX;
+  setFade(_fadeMaster, VOL(level), ms);
+}
+
+void MD_YM2413::duck(uint16_t chanMask, uint8_t dB, uint16_t ms)
+{
+  uint8_t steps = (dB + 1) / 3;     // nearest 3dB step
+
+  if (steps > VOL_MAX) steps = VOL_MAX;
+  if (chanMask != _duckMask)
+  {
+    // channels changing duck state are updated now
+    _fadeDirty |= (chanMask ^ _duckMask);
+    _duckMask = chanMask;
+  }
+  setFade(_fadeDuck, steps, ms);
+}
+
+void MD_YM2413::write(uint8_t addr, uint8_t data)
+// Send the write, keeping the library channel data up to date
+// for the registers that the master volume changes.
+{
+  STAT_CALL(STAT_WRITE);
+
+  uint8_t chan = addr - R_CHAN_CTL_BASE_REG;
+  uint8_t hi = VOL_MAX - (data >> 4);     // high nibble as a volume
+  uint8_t lo = VOL_MAX - (data & 0xf);    // low nibble as a volume
+
+#if CHANNEL_MODE == CHANNEL_MODE_ALL
+  if (addr == R_RHYTHM_CTL_REG)
+    _enablePercussion = (data & (1 << R_RHYTHM_SET_BIT));
+#endif
+
+  if (chan < ALL_INSTR_CHANNELS)
+  {
+    if (!isPercussion() || chan < PERC_CHAN_BASE)
+    {
+      if (isValid(chan))
+      {
+        C(chan).instrument = data >> R_CHAN_INST_BIT;
+        C(chan).vol = lo;
+        writeVolume(chan);
+        return;
+      }
+    }
+    else
+    {
+      // percussion volume registers, as set out in writeVolume()
+      switch (addr)
+      {
+      case R_PERC_VOL_BD_REG:
+        C(CH_BD).vol = lo;
+        writeVolume(CH_BD);
+        break;
+
+      case R_PERC_VOL_HHSD_REG:
+        C(CH_HH).vol = hi;
+        C(CH_SD).vol = lo;
+        writeVolume(CH_HH);
+        break;
+
+      case R_PERC_VOL_TOMTCY_REG:
+        C(CH_TOM).vol = hi;
+        C(CH_TCY).vol = lo;
+        writeVolume(CH_TOM);
+        break;
+      }
+      return;
+    }
+  }
+
+  send(addr, data);
+}
+
+uint8_t MD_YM2413::writeGroup(uint8_t addr)
+// Return the writeBlock() group for the register, in the order the
+// groups are sent so instruments and F-Num are set before key on.
+{
+  if (addr < 8 || addr == R_TEST_CTL_REG) return(WG_PATCH);     // custom instrument 0x00-0x07
+  if (addr == R_RHYTHM_CTL_REG) return(WG_RHYTHM);
+  if ((uint8_t)(addr - R_CHAN_CTL_BASE_REG) < ALL_INSTR_CHANNELS) return(WG_VOLUME);
+  if ((uint8_t)(addr - R_FNUM_BASE_REG) < ALL_INSTR_CHANNELS) return(WG_FNUM);
+  if ((uint8_t)(addr - R_INST_CTL_BASE_REG) < ALL_INSTR_CHANNELS) return(WG_KEY);
+
+  return(WG_NONE);
+}
+
+void MD_YM2413::writeBlock(const uint8_t* pairs, uint8_t count, bool optimize)
+{
+  uint16_t start = 0;   // first write of the run before the next key write
+
+  STAT_CALL(STAT_WRITE);
+
+  if (!optimize)
+  {
+    for (uint8_t i = 0; i < count; i++)
+      write(pairs[2 * i], pairs[(2 * i) + 1]);
+    return;
+  }
+
+  // Each key write ends a run of writes that is grouped and sent before 
+  // it. Nothing is moved or dropped across a key write, so each key on 
+  // plays with the settings written before it.
+  for (uint16_t end = 0; end <= count; end++)
+  {
+    uint8_t g = (end < count) ? writeGroup(pairs[2 * end]) : WG_KEY;
+
+    if (g != WG_KEY && g != WG_RHYTHM)
+      continue;
+
+    for (uint8_t wg = 0; wg < WG_KEY; wg++)
+    {
+      for (uint16_t i = start; i < end; i++)
+      {
+        uint8_t addr = pairs[2 * i];
+        bool later = false;
+
+        if (writeGroup(addr) != wg)
+          continue;
+
+        // only the last write in the run counts
+        for (uint16_t j = i + 1; j < end && !later; j++)
+          later = (pairs[2 * j] == addr);
+
+        if (!later)
+          write(addr, pairs[(2 * i) + 1]);
+      }
+    }
+
+    if (end < count)
+      write(pairs[2 * end], pairs[(2 * end) + 1]);
+    start = end + 1;
+  }
+}
+
+void MD_YM2413::writeBlock(uint8_t addr, const uint8_t* data, uint8_t count, bool optimize)
+{
+  STAT_CALL(STAT_WRITE);
+
+  for (uint8_t g = 0; g < (optimize ? WG_COUNT : 1); g++)
+    for (uint8_t i = 0; i < count; i++)
+      if (!optimize || writeGroup(addr + i) == g)
+        write(addr + i, data[i]);
+}
 
+bool MD_YM2413::isFading(void)
+{
+  return(_fadeMaster.level != _fadeMaster.target || 
+         _fadeDuck.level != _fadeDuck.target ||
+         (_fadeDirty & chanMask()) != 0);
+}
+
+void MD_YM2413::runFade(void)
+// Step the fades and send the changed volumes, limited to 
+// _fadeWrites register writes each time.
+{
+  uint8_t writes = 0;
+
+  if (stepFade(_fadeMaster)) _fadeDirty = 0xffff;
+  if (stepFade(_fadeDuck)) _fadeDirty |= _duckMask;
+  _fadeDirty &= chanMask();
+
+  // carry on from where the last run() stopped so all the channels get a turn
+  while (_fadeDirty != 0 && writes < _fadeWrites)
+  {
+    if (++_fadeScan >= countChannels())
+      _fadeScan = CHAN_SLOT_BASE;
+    if (_fadeDirty & (1 << _fadeScan))
+    {
+      writeVolume(_fadeScan);
+      writes++;
+    }
+  }
+}
@@ -35,6 +35,16 @@ Topics
 - \subpage pageHardware
 - \subpage pageLibrary
 - \subpage pageCustom
+- \subpage pageVGMCapture
+- \subpage pageMIDI
+- \subpage pageMIDIIn
+- \subpage pageSequencer
+- \subpage pageWriteBudget
+- \subpage pageFade
+- \subpage pageStats
+- \subpage pageTrace
+- \subpage pageEmulator
+- \subpage pageHost
 - \subpage pageCompileSwitch
 - \subpage pageRevisionHistory
 - \subpage pageCopyright
@@ -185,6 +195,32 @@ method suits applications where the sound duration is defined by the music
 being played (eg, RTTTL tunes). In this case the user code can determine 
 if the noteOff() event has been generated by using the isIdle() method.
 
+Pausing the Music
+-----------------
+suspend() keys off all the channels playing a note, including the 
+percussion channels, and stops the note durations counting down. The 
+library keeps the channel instrument, volume, note and playing state, so 
+the application does not need to remember or re-read where it was in the 
+music (eg, while a menu is shown).
+
+While suspended, the key on writes are held back from the device but all 
+the other register writes are sent, so the device registers are always the 
+same as the library state apart from the keys. Notes started or stopped by 
+the application while suspended update the channel state as usual.
+
+resume() keys on the channels that are playing, with the fewest register 
+writes - one write for each melodic channel playing followed by one write 
+for all the percussion channels - and restarts the note durations so that 
+run() turns the notes off at the right time. getRemaining() returns the 
+time left for a note. Notes played using write() are not tracked by the 
+library, so they are not keyed on again by resume().
+
+Percussion notes played without a duration stay keyed on until noteOff(), 
+but each one is a single hit. Keying them on again would play an extra hit,
+so resume() sets these channels idle instead. Percussion notes with a 
+duration are keyed on again, like the melodic notes, and are turned off by 
+run() at the end of the duration.
+
 \page pageCustom Custom Instruments
 Defining and using Custom Instruments
 --------------------------------------
@@ -202,14 +238,669 @@ the library has a mapping between the two.
 
 To play the custom instrument, use the loadInstrumentOPL2() or loadInstrument() methods
 to load the data for the custom instrument and then set the channel that will use this
-instrument to I_CUSTOM. 
+instrument to I_CUSTOM.
+
+Mapping a Bank to the ROM Instruments
+-------------------------------------
+There is only one custom instrument, so a song that uses many OPL2 instruments
+reloads the 8 custom instrument registers whenever a different one is played.
+Most of these instruments sound close enough to one of the 15 ROM instruments
+that the reload is not worth the time or the sound being cut short.
+
+The Python script extras/YM2413_PatchMap.py converts each instrument in an OPL2
+bank (in the format of the MD_YM2413_Custom example midi_instruments.h) using
+the same translation as loadInstrumentOPL2(), and works out a weighted distance
+between its parameters and each of the ROM instruments. The carrier envelope,
+frequency ratios and modulation depth are weighted the most as they have the
+most effect on the sound. The script prints
+- a PROGMEM table of the closest ROM instrument for each MIDI program, that
+can be used with MD_YM2413_MIDI::setInstrumentMap().
+- a PROGMEM list of the programs that are further than a threshold from
+all the ROM instruments, and are worth loading into the custom instrument.
+
+\page pageVGMCapture Capturing VGM Files
+Recording the Device Programming
+--------------------------------
+Everything written to the YM2413 can be recorded as a standard VGM file 
+using the MD_YM2413_VGM object. The VGM file can then be played back by the
+library VGM Player example or by any of the standard VGM tools.
+
+The recorder is connected to the YM2413 object through the register write
+hook set by setWriteHook(). Each write is stored as a VGM 0x51 command and
+the time between writes is stored as the VGM wait commands (0x61, 0x62, 0x63 
+and 0x7n) in 44.1kHz samples.
+
+The VGM data is buffered in a small RAM buffer and is passed to an application
+callback function for output, together with the file offset for the data. This
+allows the output to be any random access file (eg, a SD card file or a file
+on a host computer), as the VGM header is updated when the recording ends.
+
+Writes made before the recording starts are not recorded, so the recording 
+should be started before the instruments and volumes are set up.
+
+The VGM header holds the YM2413 clock so that players tune the notes to it.
+begin() takes the clock the library is working with (getClock()), as boards 
+with a PAL or other clock set with setClock() would otherwise play out of 
+tune
+\code
+V.begin(S.getClock());
+\endcode
+
+\page pageMIDI MIDI Synthesizer
+Playing MIDI Messages
+---------------------
+The MD_YM2413_MIDI object turns MIDI channel messages into YM2413 notes, 
+so that any MIDI source (eg, a MIDI file player or a serial MIDI input)
+can be played without the application managing the YM2413 channels.
+
+The raw MIDI messages are passed to the process() method, or to the 
+individual message methods, and the object
+- allocates a free YM2413 channel for each note on, preferring one that is
+already set to the instrument for the MIDI channel.
+- maps MIDI programs to the YM2413 instruments using a program map. The 
+instrument is only changed when a note is played on a YM2413 channel set 
+to a different instrument, so program changes cost no register writes.
+- plays the MIDI percussion channel 10 notes on the YM2413 percussion 
+instruments using a note map, if percussion is enabled.
+- combines the note velocity, channel volume (CC7) and expression (CC11)
+into the YM2413 channel volume (see below). Controller changes only rewrite 
+the volume for the affected YM2413 channels.
+- holds notes off while the sustain pedal (CC64) is on.
+- bends the pitch of the notes playing on a channel.
+
+Note off messages are matched to the YM2413 channel playing the note 
+through a 16 x 128 note lookup table (see MIDI_NOTE_MAP), so the time 
+taken does not depend on the number of notes playing.
+
+Notes are dropped if there is no free YM2413 channel and the dropped
+notes are counted (see getDropped()).
+
+Volume Curves
+-------------
+The YM2413 volume is an attenuator with 15 steps of 3dB, and the library 
+volume [VOL_OFF..VOL_MAX] is the inverse of these steps. MIDI values are 
+converted to attenuation in dB using curve tables stored in PROGMEM, so 
+no floating point or division is needed when a note is played. 
+
+The attenuation for the velocity, volume and expression are added, so that
+they combine as a product of their amplitudes, and rounded to the nearest
+YM2413 step. The volume and expression attenuation is cached for each MIDI 
+channel when the controllers change.
+
+The curves can be selected as linear amplitude, General MIDI recommended 
+(the default) or a custom table supplied by the application, separately for
+velocity (setVelocityCurve()) and the controllers (setControllerCurve()).
+
+\page pageMIDIIn Live MIDI Input
+Playing from a MIDI Serial Input
+--------------------------------
+A serial MIDI input at 31250 baud delivers a byte every 320us. As each 
+write to the YM2413 takes about 30us, a note on can take up to 90us to 
+play and the application will lose bytes unless they are received in the 
+background.
+
+The MD_YM2413_MIDIIn object splits the work between the receive interrupt 
+and the main loop:
+- receive() is called with each byte from the UART receive interrupt. It
+parses the MIDI stream, including running status, real time bytes in the 
+middle of messages and System Exclusive messages (which are skipped), and 
+puts the completed channel messages in a queue.
+- run() is called from loop() and passes the queued messages to a 
+MD_YM2413_MIDI object to be played.
+
+The queue has a single producer (the interrupt) and a single consumer 
+(loop()) so no locking or disabling of interrupts is needed.
+
+The time from receiving a note on to the note being written to the YM2413
+is measured and the maximum and average are available from getLatencyMax()
+and getLatencyAvg(). Messages lost because the queue was full are counted
+in getOverflow().
+
+The parser is checked by the host build (see \ref pageHost) with captured 
+MIDI byte streams, so a change to it can be tested without a MIDI source.
+
+\page pageSequencer Pattern Sequencer
+Playing Tracker Style Songs
+---------------------------
+The MD_YM2413_Seq object plays songs made of patterns, in the same way as 
+tracker music programs, so that music can be played from PROGMEM without 
+the application timing each note.
+
+A pattern is a number of rows, and each row has a cell for each YM2413 
+channel with a note, instrument, volume and effect. A song is an order list
+of patterns, and patterns may be repeated in the order list.
+
+The sequencer runs at a fixed tick rate set by the tempo (bpm * 2 / 5 ticks 
+per second, so 125 bpm is 50 ticks per second) and a row is played every 
+'speed' ticks. The effects are applied on every tick of the row they are in.
+
+All the changes for a row are sent together, in the order key offs, then 
+instrument and volume changes, then key ons, so repeated notes on the same 
+channel restart their envelope cleanly.
+
+The time between when each tick is due and when it is played is measured as 
+the timing jitter and is available from getJitterMax() and getJitterAvg().
+Ticks played more than a tick period late are counted in getLate().
+
+Pattern Format
+--------------
+Patterns are a byte array in PROGMEM. The first byte is the number of rows. 
+Each row is a list of cells, for the channels that change in the row, followed 
+by a row end byte. Each cell is
+- a header byte with the channel number in the low nibble and flags 
+CELL_NOTE, CELL_INST, CELL_VOL and CELL_FX for the data that follows.
+- the note byte as octave in the high nibble and note [0..11] in the low nibble,
+or NOTE_OFF. For percussion channels any value plays the instrument.
+- the instrument byte, one of the instrument_t values.
+- the volume byte [VOL_OFF..VOL_MAX].
+- the effect byte, one of the effect_t values, and the effect parameter byte.
+
+The row end byte is ROW_END with the number of empty rows that follow it in 
+the high nibble, so runs of up to 15 empty rows take no space. Rows that have
+not been set in a pattern are undefined, so the row count and rows in the data
+must match.
+
+\page pageWriteBudget Write Budget
+Predictable Note Timing
+-----------------------
+Each register write takes about 30us, so the YM2413 bus can take at most 
+about 34 writes each millisecond. Bursts of writes (eg, setVolume() for all 
+channels, pitch bends or VGM attack transients) block the application and 
+delay the writes that start and stop notes.
+
+When the WRITE_BUDGET compile switch is set, writes are queued and only 
+WRITE_BUDGET writes (changed with setWriteBudget()) are sent to the device 
+in each millisecond. The rest are sent by the following calls to the library
+methods or run(), so run() must be called frequently. When the writes are 
+sent from the queue
+- key on/off (0x0E and 0x20-0x28) and F-Num (0x10-0x18) writes are sent 
+before all others, in the order they were made.
+- a key on is not sent before the queued writes that set how its note 
+sounds. The channel instrument and volume (0x30-0x38), the custom instrument
+(0x00-0x07) for a channel playing it, and the percussion volumes (0x36-0x38) 
+for a rhythm key on are sent ahead of it, so the note never starts with the
+old instrument or volume.
+- other writes (volume and instruments) that are replaced by a later write
+to the same register before they are sent are merged into the later write,
+unless a queued key on needs the earlier value.
+- if the queue is full the next write is sent regardless of the budget.
+
+The writes deferred, merged and forced, and the longest time a key on write 
+waited in the queue, are counted and available from getDeferred(), getMerged(),
+getForced() and getKeyLatencyMax(). The register write hook is called when 
+the write is sent to the device, so VGM captures record the actual timing.
+
+flush() sends all the queued writes immediately.
+
+\page pageFade Fades, Mute and Ducking
+Master Volume
+-------------
+Setting all the channels to VOL_OFF sends all the volume writes back to 
+back, blocking the application, and the sudden change is heard as a click.
+
+The library has a master volume that is applied on top of the channel 
+volume set by setVolume(), setInstrument() and noteOn(). fadeTo() changes 
+the master volume over a time, mute() fades it to VOL_OFF, and duck() 
+reduces the volume of a group of channels (eg, the music under a sound 
+effect). The channel set points are not changed, so the volumes return 
+to their set points when the fade or ducking ends.
+
+The fades are worked in 3dB steps (the YM2413 volume step) by run(), and 
+no more than setFadeWrites() volume writes are sent by each run() call, so 
+the cost of a fade is spread over many passes through loop().
+
+\page pageStats Library Statistics
+When LIB_STATS is enabled (see \ref pageCompileSwitch) the library counts
+- the calls made by the application to each of the main methods, with the 
+average and longest time spent in one call. Calls the library makes to its 
+own methods (eg, setVolume() from noteOn()) are part of the application call.
+- the register writes in each register group and the writes per second.
+- the address writes sent to the IC and the address writes saved because 
+the IC address was already set (consecutive writes to the same register).
+- the time spent writing to the IC, including the waits for the bus.
+- the notes dropped by the application because there was no free channel,
+counted by calling countNoteDrop(). MD_YM2413_MIDI counts its dropped notes.
+
+getStats() copies the counters into a stats_t structure, resetStats() sets 
+them to zero and printStats() prints them as a table to a stream like Serial.
+The counters are collected from begin().
+
+Timing each call uses micros() twice, and each register write a little more,
+so the statistics slightly slow the library down. When LIB_STATS is 0 (the 
+default) the statistics code and data are not compiled.
+
+\page pageTrace Trace Buffer
+Tracing the Library
+-------------------
+Printing to the Serial Monitor from inside the library blocks for a few 
+ms for each line at 57600 baud, which changes the timing being debugged.
+
+When LIB_TRACE is enabled (see \ref pageCompileSwitch) the library logs 
+an 8 byte record for each event into a RAM ring buffer. Each record has 
+the micros() time, an event identifier, a channel and a 16 bit argument. 
+Logging takes a few us, so the library runs at close to its normal speed. 
+When the buffer is full the oldest records are overwritten and counted 
+as lost, so the buffer holds the most recent events.
+
+| Event           | chan         | arg
+|-----------------|--------------|-------------------------------
+| EV_NOTE_ON_FREQ | channel      | frequency
+| EV_NOTE_ON      | channel      | octave << 8 \| note
+| EV_FNUM         | channel      | block << 9 \| F-Num for the note
+| EV_BEND         | channel      | block << 9 \| F-Num after the bend
+| EV_NOTE_OFF     | channel      | 0
+| EV_WRITE        | address      | data sent to the register
+| EV_SUSPEND      | 0            | 0
+| EV_RESUME       | 0            | 0
+| EV_MIDI_NOTE    | MIDI channel | note << 8 \| YM2413 channel
+| EV_MIDI_DROP    | MIDI channel | note
+
+The application can log its own events with identifiers from EV_USER 
+using MD_YM2413_Trace::log(), to mark where they happen in the library 
+events.
+
+Reading the Trace
+-----------------
+The buffer is drained by the application outside the timing being 
+traced (eg, between songs or when a button is pressed). 
+MD_YM2413_Trace::read() returns the records one at a time, and 
+MD_YM2413_Trace::dump() prints them as hex text lines. The dump is 
+captured from the Serial Monitor into a file and decoded on the host by 
+the Python script extras/YM2413_TraceDecode.py, which shows the events 
+with their time and the register names for the writes
+    
+    python YM2413_TraceDecode.py capture.txt
+
+\page pageEmulator Software YM2413
+Boards Without the IC
+---------------------
+The MD_YM2413_Emu object is a software YM2413 for boards with a DAC or I2S 
+output and no YM2413 IC. It works out the sound from the register writes in 
+the same way as the IC, so applications run unchanged on either.
+
+To use it, create the MD_YM2413 object with the constructor that takes a 
+device function instead of the pins, and pass the register writes to the 
+MD_YM2413_Emu object
+\code
+MD_YM2413_Emu E;
+void emuWrite(uint8_t addr, uint8_t data) { E.write(addr, data); }
+MD_YM2413 S(emuWrite);
+\endcode
+No I/O pins are used and the writes take no bus time.
+
+The application calls render() to work out blocks of samples into its own 
+buffer, at the sample rate from getSampleRate() (master clock / 72, about 
+49.7kHz). The synthesizer uses only integer arithmetic, so it is suited to 
+32 bit MCUs without an FPU
+- the sine wave and the conversion from attenuation to level use log-sin 
+and exponent tables in PROGMEM, so each operator needs no multiply.
+- the envelopes step by shifts and adds at rates set by a sample counter.
+- the phase of each operator is reset at key on.
+- rhythm mode, the AM and vibrato LFOs and the half sine wave are included.
+- channels are active from key on until both operators have released to 
+silence (getActive()). The active bit is tested once for each channel and 
+sample, and the envelopes, phases and outputs of the silent channels are 
+not worked out, as they stay silent until the next key on resets the phase. The samples are the same as when every channel is worked 
+out, and most music has several silent channels at any time (about 5.7 of 
+the 9 channels are active on average for the VGM Player example tunes).
+
+The MD_YM2413_EmuBenchmark example shows the time to render the VGM files 
+on an SD card, the average number of active channels and a hash of the 
+samples for each file. The host build checks that the samples are the same
+with and without the silent channels skipped (see \ref pageHost). On an
+x86 host the VGM Player example tunes render in about 212 cycles for each 
+sample with the silent channels skipped and 238 without, about 11% faster.
+The time saved on a board is shown by the EmuBenchmark example.
+
+Snapshots
+---------
+saveState() copies the synthesizer state into a SNAPSHOT_SIZE (232) byte 
+buffer and restoreState() sets it back, so rendering carries on from the 
+snapshot with exactly the same samples. This is used to seek in a preview, 
+to render a section again while changing an instrument or to render in 
+chunks, without playing every register write again from the start.
+- only the registers, the operator phases, envelopes and feedback, and the 
+LFO and noise generator positions are saved. Everything else is worked out 
+from the registers when the snapshot is restored. On the host a restore 
+takes about the same time as rendering 1.6 samples of the VGM Player example
+tunes (1.4 to 1.9 for each tune) and a save about 0.3 samples.
+- the snapshot has a fixed little endian layout that starts with 'Y', 'M' 
+and SNAPSHOT_VERSION, so it can be kept in a file. Snapshots for a 
+different version are not restored.
+
+The MD_YM2413_EmuSnapshot example shows the snapshot size and the time to 
+save and restore a snapshot on the board. The host figures are measured by 
+the host build (see \ref pageHost).
+
+Several YM2413s
+---------------
+The MD_YM2413_EmuBatch object renders up to BATCH_MAX MD_YM2413_Emu objects 
+in step, for example for the two chips in a dual YM2413 VGM file or to 
+render a number of short clips
+\code
+MD_YM2413_Emu E[4];
+MD_YM2413_EmuBatch B(E, ARRAY_SIZE(E), nextEvent);
+\endcode
+- each object is fed from its own stream of register writes by the event 
+callback, which writes the registers due now and returns the samples to 
+the next writes. The writes are made at the sample they are due, so the 
+output does not depend on the block size.
+- mix() adds the objects together into one output and render() gives each 
+object its own output buffer.
+- the batch is an event scheduler. Each object is rendered by its own 
+render() for the whole block, split at its events, so the synthesis is the 
+same code as for one object and the samples are the same as rendering each 
+object separately, which the host build checks.
+- the throughput is the same as rendering the objects separately (on the 
+x86 host 0.96 to 1.0 of it for 1 to 8 objects). What the batch saves is 
+the event timing in the application. More YM2413s are rendered in real 
+time by running more batches on more cores.
+- on dual core MCUs a batch object can be run on each core, each with its 
+own MD_YM2413_Emu objects.
+- isDone() is true when all the event streams have ended and every object 
+is silent (isSilent()).
+
+The MD_YM2413_EmuBatch example shows the throughput in chip-seconds per 
+second for different numbers of objects on the board, and the host build 
+compares it with rendering the objects separately (see \ref pageHost).
+
+Resampling
+----------
+Audio outputs usually run at 44.1kHz or 48kHz. The MD_YM2413_Resample object 
+converts the rendered blocks to the output rate with a polyphase FIR filter
+\code
+MD_YM2413_Resample R;
+R.begin(E.getSampleRate(), 44100);
+n = R.process(buf, count, out);    // out has space for R.getOutputSize(count)
+\endcode
+- the filter is 24 input samples long, with coefficients for 64 positions 
+between the input samples in a PROGMEM table. Each output sample is 
+interpolated between the two nearest positions, giving a signal to noise 
+and distortion ratio of 80dB or more for tones from 1kHz to 16kHz, where 
+linear interpolation of the samples aliases badly on bright instruments.
+- the filter is flat to 0.05dB up to 15kHz (-0.3dB at 16kHz) and removes 
+about 70dB of the sound from 24kHz to the top of the input band that would
+otherwise alias into the audio band. At 44.1kHz the sound between 22.05kHz
+and 24kHz is in the transition band of the filter (28dB down at 22.05kHz) 
+and aliases to above 20kHz.
+- the input and output are the application's buffers and only the last 24 
+input samples are copied. Any block size can be used.
+- the filter delays the audio by 12 input samples (about 240us, getDelay()), 
+so the latency is this plus the time for a block to play.
+- 16 bit multiplies with a 32 bit total are used. On Cortex-M4 and M7 MCUs 
+the SMLAD instruction does two multiplies at a time, and on an x86 host
+SSE2 does eight at a time (see RESAMPLE_DSP and RESAMPLE_SSE2 in 
+\ref pageCompileSwitch). The output is the same for every kernel.
+
+The MD_YM2413_Emulator example shows the time to render and resample each 
+block, the resampler throughput in samples/s, the latency and the processor 
+load on the board.
+The figures above are measured by the host build (see \ref pageHost).
+
+\page pageHost Host Build and Tests
+Building on the Host
+--------------------
+The library is built for the Arduino boards, but the same sources can be 
+built on a workstation to measure and check them before a board is flashed. 
+The CMake project in extras/host builds src/MD_YM2413*.cpp unmodified 
+against a small Arduino API shim (extras/host/shim) and runs the checks 
+with ctest
+    
+    cmake -S extras/host -B build
+    cmake --build build
+    ctest --test-dir build --output-on-failure
+
+The shim keeps a simulated clock. Time only moves on when the library calls
+the Arduino API, by the time the call takes on the board being modelled 
+(digitalWrite() and micros() times for an Uno, Zero or Teensy 4 class board). 
+The bus waits work as they do on the board, by polling micros(), so the bus 
+time and the time spent waiting for the IC are the same on every run and 
+every computer. A pin hook sees every digitalWrite() with its time, so a test
+can watch the bus strobes as a logic analyser would.
+
+Benchmark
+---------
+YM2413_HostBench makes each of the main calls (write(), both noteOn(), 
+setVolume(), setPercussion() and run()) many times for each board and shows 
+the data and address strobes, digitalWrite() calls, simulated bus time and 
+wait time per call. The simulated figures are checked against the baseline 
+in extras/host/bench_baseline.txt, and the test fails if any of them is 
+worse. When a change is meant to alter them the baseline is saved again with
+    
+    build/YM2413_HostBench -s extras/host/bench_baseline.txt
+
+It also shows the sustained write() rate for each board, compared with a 
+reference that waits a fixed 4us and 25us in each strobe as the library did
+before the waits were paced by the time since the last write.
+
+The rates from the simulated boards, in writes/s, are
+
+| Board   | Changing, fixed | Changing, paced | Same, fixed | Same, paced
+|---------|-----------------|-----------------|-------------|------------
+|Uno      | 9433            | 10989           | 15736       | 21953
+|Zero     | 19607           | 23809           | 27764       | 35691
+|Teensy 4 | 34094           | 31250           | 39730       | 38451
+
+On the slow boards the digitalWrite() calls already take much of the wait, 
+so pacing is faster. On a Teensy 4 class board the waits are the whole write
+time and rounding each one up to whole us, plus the micros() step, makes it 
+about 8% slower (4% for the same register). These figures are from the shim 
+timing models and were not measured on the boards. The Benchmark example 
+prints the paced and the fixed wait rates for the board it runs on.
+
+Bus Timing
+----------
+YM2413_BusCheck runs a mix of library calls on each board model with a 
+virtual YM2413 bus on the pins. For every /WE strobe it checks the write pulse
+width, the A0 and data setup and hold times and the 12 or 84 master clock 
+cycles after the previous write against the datasheet minimums, and it checks 
+that the writes latched from the pins are the ones passed to the write hook. 
+With -l the strobes are logged to a file with their times. The test fails if 
+any strobe breaks a minimum.
+
+YM2413_BusCheck_Budget is the same check built with WRITE_BUDGET. It also
+plays a burst of instrument changes, custom instruments and notes that fills
+the queue at a budget of 1 write each ms, and fails if any key on reaches the
+bus with a different instrument, volume or custom instrument than when the 
+burst is played with no budget.
+
+The bus check shows the time on the pins, not the CPU cycles used by the 
+library on an AVR. Cycle counts for each call are measured on the board by
+the Benchmark example, using Timer1.
+
+Size Report
+-----------
+When arduino-cli and the arduino:avr core are installed, the SizeReport 
+target compiles every example for an Uno (YM_SIZE_FQBN sets another board) 
+and shows the flash and RAM each one uses
+    
+    cmake --build build --target SizeReport
+
+The host build cannot run AVR code, so there is no cycle accurate AVR 
+profile. The Timer1 counts from the Benchmark example are the cycle figures.
+
+Golden Traces
+-------------
+YM2413_Golden plays each VGM_TUNES file of the VGM_Player_CLI example (using
+write(), as the example does), each song of the RTTTL_Player example (using 
+its arranger) and a set of scripted MIDI sequences (using MD_YM2413_MIDI) on 
+the Uno board model. Every register write passed to the write hook is 
+recorded with its time and compared with the golden trace for the tune in 
+extras/host/golden, one "time addr data" line per write. If a tune is 
+different the lines around the first difference are shown as a diff.
+
+For each tune it also shows the register and address writes and the bus 
+busy time, so a change that costs more bus time shows up next to the 
+changes in the writes. When a change to the writes is intended, the golden
+traces are written again and checked in with the change
+    
+    build/YM2413_Golden -u -g extras/host/golden examples/MD_YM2413_VGM_Player_CLI/VGM_TUNES/<file>.VGM ...
+
+Emulator Benchmark
+------------------
+YM2413_EmuBench renders each VGM_TUNES file on MD_YM2413_Emu as the 
+EmuBenchmark example does, and times every render() call with the host 
+cycle counter. For each tune it shows the median, 99th percentile and 
+largest cycles for a block, the cycles for each sample and the average 
+number of active channels. The block size is set with -s (64 by default)
+    
+    build/YM2413_EmuBench -s 32 examples/MD_YM2413_VGM_Player_CLI/VGM_TUNES/<file>.VGM ...
+
+These are host cycles and not board cycles, and the largest block includes
+the times the host was busy with something else, but a change to the 
+render code shows up in the median and cycles for each sample.
+
+The last column is a hash of the samples for each tune, the same hash as 
+the EmuBenchmark example shows. The library is also built with EMU_SKIP_IDLE 
+set to 0, and the test fails if any tune rendered without skipping the 
+silent channels has a different hash. The Total line gives the cycles for 
+each sample over all the tunes for each build.
+
+Snapshot Check
+--------------
+YM2413_SnapshotCheck renders each VGM_TUNES file on MD_YM2413_Emu, saving a
+snapshot every second of the tune, then restores the snapshots last first 
+and renders a second from each one again with the writes that follow it. The 
+samples must be the same as the first time. For each tune it shows the host 
+cycles to save and restore a snapshot (the fastest of 16 tries), the cycles 
+to render a sample and the restore time as a number of samples.
+
+Resampler Check
+---------------
+YM2413_ResampleCheck measures MD_YM2413_Resample from the emulator sample 
+rate to 44.1kHz and 48kHz. For sine waves from 1kHz to 16kHz it fits a sine
+at the test frequency to the output and shows the gain and the signal to 
+noise and distortion ratio (SINAD), then shows the worst rejection of the 
+sine waves from 24kHz to half the input rate, the rejection at half the 
+output rate and the throughput in samples/s for 64 sample blocks. The test 
+fails if the SINAD is less than 79dB or the rejection from 24kHz less than 
+69dB.
+
+The library is also built with RESAMPLE_SSE2 set to 0, and a test signal 
+converted by the scalar kernel must give the same output hash as the SSE2 
+kernel. With GCC at -O2 or -O3 the scalar loop is already vectorized by the 
+compiler, so both kernels run at about the same speed on the host.
+
+MIDI Input Check
+----------------
+YM2413_MIDIInCheck replays the captured MIDI byte streams in extras/host/midi_in
+through MD_YM2413_MIDIIn. Each capture file has the bytes received, the 
+points where run() is called, the channel messages the bytes decode to and
+the number of messages lost to a full queue. The captures cover running 
+status across messages, real time bytes inside messages, System Exclusive 
+and system common messages, and a queue filled before run() is called. The 
+messages played by run() must be the expected number, with the same register 
+writes as the expected messages passed straight to MD_YM2413_MIDI::process(),
+and the lost count must be the expected one.
+
+Batch Check
+-----------
+YM2413_BatchCheck plays the VGM_TUNES files on batches of 1 to BATCH_MAX 
+objects, object k playing file k modulo the number of files, and on the same
+number of separate MD_YM2413_Emu objects rendered in 64 sample blocks. Every 
+object rendered by the batch render() must have the same samples as it has 
+rendered separately, and the samples from mix() must be the separate samples
+added together. For each batch size it shows the throughput in chip-seconds
+per second of the separate objects and of the batch (the fastest of 3 runs), 
+then the throughput of a full batch running on each host core at once.
+
+Example Sketches
+----------------
+Sketches that run to the end in setup() are built and run as tests. The
+RegisterCheck example checks the register writes for its test scripts and 
+the EmuSnapshot example checks the bars rendered again from its snapshots.
 
 \page pageCompileSwitch Compiler Switches
 
-LIBDEBUG
+LIB_TRACE
+---------
+If set to a power of 2, the library logs its events into a trace buffer 
+of this number of records (see \ref pageTrace). Each record uses 8 bytes 
+of RAM. The default is 0 (no trace).
+
+CHANNEL_MODE
+------------
+Controls the number of channel data slots held in RAM by the MD_YM2413 object.
+Each channel slot is 10 bytes on AVR MCUs (12 on 32 bit MCUs). The values are
+- CHANNEL_MODE_ALL (default) allocates 11 slots for the 9 channels without 
+percussion and the 11 channels with percussion. Percussion is set by setPercussion().
+- CHANNEL_MODE_MELODY allocates 9 slots. Percussion cannot be enabled.
+- CHANNEL_MODE_RHYTHM allocates 5 slots for the percussion channels [6..10]. 
+Percussion is always enabled and the melody channels [0..5] are ignored.
+
+In the MELODY and RHYTHM modes the percussion mode is fixed by the build. A 
+write() to the rhythm control register 0x0E is still sent to the device, but it 
+does not change the library percussion mode, so a VGM file that changes the mode 
+should be played with CHANNEL_MODE_ALL.
+
+The static RAM used by one MD_YM2413 object on AVR MCUs is
+
+| Version                     | Slot size | ALL | MELODY | RHYTHM |
+|-----------------------------|:---------:|:---:|:------:|:------:|
+| 1.1.0                       | 17        | 193 | -      | -      |
+| Packed channel data         | 10        | 118 | 98     | 58     |
+
+The channel mode must be set by editing the library header file as the Arduino 
+IDE does not pass compiler switches set in the application to the library.
+
+CLOCK_HZ
 --------
-Controls debugging output to the serial monitor from the library. If set to
-1 debugging is enabled and the main program must open the Serial port for output
+Sets the frequency in Hz of the master clock connected to the YM2413. The
+default is the NTSC 3.579545MHz crystal. Other common values are 3546895UL 
+(PAL crystal) and 4000000UL (4MHz oscillator). The F-Num table for the notes
+is worked out by the compiler for this clock, and frequencies are converted 
+to F-Num by multiplying by the clock reciprocal, so a different clock costs
+no code or time. The waits after each register write (12 master clock cycles
+after the address and 84 after the data) are also worked out from the clock, 
+and only the part of the wait not already spent since the last write is 
+waited for before the next write. Each write holds /WE LOW for 1us, well over 
+the datasheet minimum write pulse, as on fast MCUs two digitalWrite() calls 
+can be only a few ns apart.
+
+CLOCK_RUNTIME
+-------------
+If set to 1 the master clock is set by the application using setClock() before 
+begin(), starting from the CLOCK_HZ value. The F-Num table is worked out in 
+RAM (30 bytes, with the bus waits) by begin() and notes are played without 
+any division, the same as for a fixed clock. The default is 0.
+
+WRITE_BUDGET
+------------
+If set to a non-zero value, register writes are queued and sent with a budget 
+of this number of writes per millisecond (see \ref pageWriteBudget). The queue
+uses about 100 bytes of RAM. The default is 0 (writes are sent immediately).
+
+LIB_STATS
+---------
+If set to 1 the library collects the statistics described in \ref pageStats.
+This uses about 170 bytes of RAM. The default is 0 (no statistics).
+
+EMU_SKIP_IDLE
+-------------
+If set to 1 MD_YM2413_Emu skips the channels that are silent when rendering
+(see \ref pageEmulator). The samples are the same either way, which the host
+build checks, so this is only set to 0 to compare the render times. The 
+default is 1.
+
+RESAMPLE_DSP
+------------
+If set to 1 MD_YM2413_Resample uses the SMLAD instruction to do two multiply 
+and adds at a time. This needs a Cortex-M4 or M7 MCU. The default is 1 when 
+the compiler targets an ARM MCU with the DSP instructions, 0 otherwise.
+
+RESAMPLE_SSE2
+-------------
+If set to 1 MD_YM2413_Resample uses the SSE2 instructions to do eight multiply
+and adds at a time, for the host build or other x86 applications. The output is
+the same as for the other kernels. The default is 1 when the compiler targets 
+SSE2 and RESAMPLE_DSP is 0, 0 otherwise.
+
+MIDI_NOTE_MAP
+-------------
+Controls how MD_YM2413_MIDI finds the YM2413 channel for a note off. If set 
+to 1 a table of 16 x 128 nibbles (1024 bytes RAM) holds the channel for every
+MIDI channel and note. If set to 0 the YM2413 channels are searched. The default 
+is 0 for MCUs with 2k or less of RAM, 1 otherwise.
 
 \page pageDonation Support the Library
 If you like and use this library please consider making a small donation 
@@ -236,6 +927,34 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
 
 #define ARRAY_SIZE(a) (sizeof(a)/sizeof(a[0]))  ///< Standard method to work out array size
 
+#define CHANNEL_MODE_ALL    0   ///< CHANNEL_MODE value for melody and rhythm channels
+#define CHANNEL_MODE_MELODY 1   ///< CHANNEL_MODE value for melody channels only
+#define CHANNEL_MODE_RHYTHM 2   ///< CHANNEL_MODE value for rhythm channels only
+
+#ifndef CHANNEL_MODE
+#define CHANNEL_MODE CHANNEL_MODE_ALL  ///< Set the channel slots allocated. See \ref pageCompileSwitch
+#endif
+
+#ifndef CLOCK_HZ
+#define CLOCK_HZ  3579545UL     ///< YM2413 master clock in Hz, default NTSC 3.579545MHz. See \ref pageCompileSwitch
+#endif
+
+#ifndef WRITE_BUDGET
+#define WRITE_BUDGET 0          ///< Set to the register writes allowed per ms to enable the write budget. See \ref pageCompileSwitch
+#endif
+
+#ifndef CLOCK_RUNTIME
+#define CLOCK_RUNTIME 0         ///< Set to 1 to set the master clock at run time. See \ref pageCompileSwitch
+#endif
+
+#ifndef LIB_STATS
+#define LIB_STATS 0             ///< Set to 1 to collect the library statistics. See \ref pageCompileSwitch
+#endif
+
+#ifndef LIB_TRACE
+#define LIB_TRACE 0             ///< Set to the number of trace records (a power of 2) to enable the trace. See \ref pageCompileSwitch
+#endif
+
 /**
  * Base class for the MD_YM2413 library
  */
@@ -246,10 +965,25 @@ class MD_YM2413
     static const uint8_t VOL_MAX = 0xf;     ///< Convenience constant for volume maximum
 
     static const uint8_t MIN_OCTAVE = 1;    ///< smallest octave playable
-    static const uint8_t MAX_OCTAVE = 8;    ///< largest playable octave
+    static const uint8_t MAX_OCTAVE = 7;    ///< largest playable octave
 
     static const uint8_t CH_UNDEFINED = 255;  ///< undefined channel indicator
     static const uint8_t OPL2_DATA_SIZE = 12; ///< OPL2 instrument definition size
+    static const uint8_t NOTE_UNDEFINED = 0x7f; ///< note number for notes played by frequency
+    static const uint8_t FADE_WRITES_DEFAULT = 2;  ///< default register writes for each run() during a fade
+
+    static const uint8_t STAT_NOTE_ON = 0;      ///< stats_t method index for noteOn()
+    static const uint8_t STAT_NOTE_OFF = 1;     ///< stats_t method index for noteOff()
+    static const uint8_t STAT_BEND = 2;         ///< stats_t method index for bendNote()
+    static const uint8_t STAT_INSTRUMENT = 3;   ///< stats_t method index for setInstrument()
+    static const uint8_t STAT_VOLUME = 4;       ///< stats_t method index for setVolume()
+    static const uint8_t STAT_LOAD = 5;         ///< stats_t method index for loadInstrument() and loadInstrumentOPL2()
+    static const uint8_t STAT_PERCUSSION = 6;   ///< stats_t method index for setPercussion()
+    static const uint8_t STAT_WRITE = 7;        ///< stats_t method index for write() and writeBlock()
+    static const uint8_t STAT_RUN = 8;          ///< stats_t method index for run()
+    static const uint8_t STAT_SUSPEND = 9;      ///< stats_t method index for suspend() and resume()
+    static const uint8_t STAT_METHODS = 10;     ///< number of stats_t method indices
+    static const uint8_t STAT_GROUPS = 5;       ///< number of stats_t register groups
 
     static const uint8_t PERC_CHAN_BASE = 6;            ///< Base channel number for percussion instruments if enabled
     static const uint8_t CH_HH = PERC_CHAN_BASE + 0;    ///< HI HAT channel number
@@ -258,6 +992,43 @@ class MD_YM2413
     static const uint8_t CH_SD = PERC_CHAN_BASE + 3;    ///< SNARE DRUM channel number
     static const uint8_t CH_BD = PERC_CHAN_BASE + 4;    ///< BASS DRUM channel number
 
+   /**
+    * Register write hook callback type.
+    *
+    * Prototype for the function invoked for every register write sent to the
+    * device. The parameters are the register address and data byte written.
+    *
+    * \sa setWriteHook()
+    */
+    typedef void (*cbWrite_t)(uint8_t addr, uint8_t data);
+
+#if LIB_STATS
+   /**
+    * Library statistics.
+    *
+    * The counters collected when LIB_STATS is enabled. The method 
+    * counters are indexed by the STAT_* method index and only count
+    * the calls made by the application, not the calls the library makes 
+    * to its own methods. The register groups are, in order, the custom 
+    * instrument and test registers, instrument and volume, F-Num, block 
+    * and key, and rhythm control.
+    *
+    * \sa getStats(), \ref pageStats
+    */
+    struct stats_t
+    {
+      uint32_t time;                      ///< ms since the statistics were reset
+      uint32_t calls[STAT_METHODS];       ///< calls to each method
+      uint32_t callTime[STAT_METHODS];    ///< total us spent in each method
+      uint32_t callMax[STAT_METHODS];     ///< longest us spent in one call of each method
+      uint32_t writes[STAT_GROUPS];       ///< register writes for each register group
+      uint32_t addrWrites;                ///< address writes sent to the IC
+      uint32_t addrSaved;                 ///< address writes not sent as the IC address was already set
+      uint32_t busTime;                   ///< us spent writing to the IC, including the bus waits
+      uint16_t noteDrops;                 ///< notes dropped, counted by the application
+    };
+#endif
+
    /** 
     * Predefined musical and percussion instrument definitions
     * The IC has a number of predefined profiles instruments with IDs that 
@@ -314,6 +1085,19 @@ class MD_YM2413
     */
     MD_YM2413(const uint8_t* D, uint8_t we, uint8_t a0);
 
+   /**
+    * Class Constructor for a software device.
+    *
+    * Instantiate a new instance of this class with no YM2413 IC. Register writes 
+    * are passed to the device function instead of the data bus, for example to 
+    * the MD_YM2413_Emu software synthesizer, and no I/O pins are used.
+    *
+    * \sa \ref pageEmulator
+    *
+    * \param device  the function called with each register write.
+    */
+    MD_YM2413(cbWrite_t device);
+
    /**
     * Class Destructor.
     *
@@ -338,6 +1122,39 @@ class MD_YM2413
    /** \name Hardware and Library Management.
     * @{
     */
+#if CLOCK_RUNTIME
+   /**
+    * Set the master clock frequency.
+    *
+    * Set the frequency of the clock connected to the YM2413. The note F-Num
+    * table is worked out for this clock by begin(), so this method must be
+    * called before begin(). The default is CLOCK_HZ.
+    *
+    * Only available when CLOCK_RUNTIME is set to 1.
+    *
+    * \sa \ref pageCompileSwitch
+    *
+    * \param hz  the clock frequency in Hz [1200000..5000000].
+    */
+    void setClock(uint32_t hz) { _clockHz = hz; }
+#endif
+
+   /**
+    * Return the master clock frequency.
+    *
+    * Return the clock frequency the library is working with, set by 
+    * setClock() when CLOCK_RUNTIME is set to 1 or CLOCK_HZ otherwise.
+    *
+    * \sa setClock(), \ref pageCompileSwitch
+    *
+    * \return the clock frequency in Hz.
+    */
+#if CLOCK_RUNTIME
+    uint32_t getClock(void) { return(_clockHz); }
+#else
+    uint32_t getClock(void) { return(CLOCK_HZ); }
+#endif
+
    /**
     * Return the number of channels.
     *
@@ -420,7 +1237,7 @@ class MD_YM2413
     *
     * \param data  an array of 8 bytes in RAM that will be written to registers 0x00 through 0x07.
     */
-    void loadInstrument(const uint8_t* data) { for (uint8_t i = 0; i < 8; i++) send(i, data[i]); }
+    void loadInstrument(const uint8_t* data);
 
    /**
     * Standardize the instrument release phase
@@ -433,7 +1250,7 @@ class MD_YM2413
     * \param chan    channel number on which sustain is set [0..countChannels()-1].
     * \param sustain set true to standardize the release phase to a mid level value.
     */
-    void setSustain(uint8_t chan, bool sustain) { if (chan < countChannels()) _C[chan].sustain = sustain; }
+    void setSustain(uint8_t chan, bool sustain) { if (isValid(chan)) C(chan).sustain = sustain; }
 
    /**
     * Return the idle state of a channel.
@@ -457,19 +1274,277 @@ class MD_YM2413
     */
     void run(void);
 
+   /**
+    * Suspend the music.
+    *
+    * Key off all the channels playing a note, including the percussion
+    * channels, without changing the library channel state. The notes are
+    * released at the instrument release rate, without the sustain. While
+    * suspended the key on writes are held back from the device (all other
+    * register writes are sent), so notes started by the application do not
+    * sound, and the note durations stop counting down.
+    *
+    * \sa resume(), isSuspended(), getRemaining(), \ref pageLibrary
+    */
+    void suspend(void);
+
+   /**
+    * Resume the music.
+    *
+    * Key on again all the channels that were playing a note when suspend()
+    * was invoked, or had a note started while suspended, and restart the
+    * note durations from where they stopped. The instrument, volume and
+    * F-Num registers are already set in the device, so only the key
+    * registers are written, one write for each melodic channel playing and
+    * one for all the percussion channels. The notes restart from their attack.
+    * Percussion channels played without a duration are set idle rather than
+    * hit again.
+    *
+    * \sa suspend(), \ref pageLibrary
+    */
+    void resume(void);
+
+   /**
+    * Return the suspend state.
+    *
+    * \return true if suspend() has been invoked and not yet resume().
+    */
+    bool isSuspended(void) { return(_suspended); }
+
+   /**
+    * Get the time left for a note.
+    *
+    * The time left before run() generates the note off for a note started
+    * with a duration. The time does not count down while suspended.
+    *
+    * \param chan  channel to check [0..countChannels()-1].
+    * \return the time left in ms, 0 if the channel is idle or the note has no duration.
+    */
+    uint16_t getRemaining(uint8_t chan);
+
    /**
     * Write a byte directly to the device
     *
-    * This method should be used with caution, as it bypasses all the checks
-    * and buffering built into the library. It is provided to support applications
-    * that are a collection of register setting to be written to hardware at set
-    * time intervals (eg, VGM files).
+    * This method is provided to support applications that are a collection 
+    * of register settings to be written to hardware at set time intervals 
+    * (eg, VGM files). The write is not checked against the library channel 
+    * data and is sent the same way as the library writes, so it is paced on 
+    * the bus, queued when WRITE_BUDGET is set, passed to the write hook, and
+    * any key on in it is held back while suspended.
+    *
+    * Most registers are sent with the data unchanged. The exceptions are
+    * - writes to the channel instrument/volume registers (0x30-0x38) update 
+    * the channel instrument and volume in the library and are sent as 
+    * setVolume() would send them, attenuated by the current master volume 
+    * and ducking, so that fadeTo(), mute() and duck() work for these 
+    * applications.
+    * - writes to the rhythm control register (0x0E) also set the library 
+    * percussion mode from the rhythm bit. This only happens with 
+    * CHANNEL_MODE_ALL, as the other channel modes fix the percussion mode
+    * (see \ref pageCompileSwitch).
     *
     * \param addr  the 8 bit device address to write the data.
     * \param data  the 8 bit data value to write to the device.
     */
-    inline void write(uint8_t addr, uint8_t data) { send(addr, data); }
-    
+    void write(uint8_t addr, uint8_t data);
+
+   /**
+    * Write a block of register address and data pairs to the device
+    *
+    * Each pair is written using write(). The YM2413 has no address 
+    * auto-increment, so each write to a different register needs its own 
+    * address write. If optimize is true the writes are made in fewer and 
+    * safer bus cycles. The writes to the key registers (0x0e and 
+    * 0x20-0x28) are all sent, in the order they are in the block, and the 
+    * writes between two key writes are a run that is optimized before the
+    * key write that ends it
+    * - only the last write to a register in the run is sent.
+    * - writes to addresses with no register are not sent.
+    * - the writes in the run are grouped in the order custom instrument 
+    * and test, instrument and volume, then F-Num, keeping the order of the
+    * writes in each group.
+    *
+    * Nothing is moved or dropped across a key write, so each note keyed on
+    * in the block plays with the instrument, volume and F-Num written 
+    * before its key on, and a change written after it only applies to the
+    * notes that follow.
+    *
+    * \sa write()
+    *
+    * \param pairs     an array in RAM of count address and data byte pairs.
+    * \param count     the number of address and data pairs in the array.
+    * \param optimize  set true to optimize the writes as described.
+    */
+    void writeBlock(const uint8_t* pairs, uint8_t count, bool optimize = false);
+
+   /**
+    * Write a block of contiguous registers to the device
+    *
+    * Write count bytes of data to the registers starting at addr, using write().
+    * If optimize is true the addresses with no register are skipped and 
+    * the writes are grouped in the order custom instrument and test, 
+    * instrument and volume, F-Num, block and key, and rhythm, so that a 
+    * full register image (0x00-0x38) can be loaded with the key on writes
+    * last. Each register is written once, so unlike the writeBlock() with 
+    * address and data pairs the whole block is one image and not a 
+    * sequence of notes.
+    *
+    * \sa write()
+    *
+    * \param addr      the first register address.
+    * \param data      an array in RAM of count data bytes for the registers.
+    * \param count     the number of registers to write.
+    * \param optimize  set true to optimize the writes.
+    */
+    void writeBlock(uint8_t addr, const uint8_t* data, uint8_t count, bool optimize = false);
+
+   /**
+    * Set a hook for all register writes
+    *
+    * The callback function is invoked for every register write made to the
+    * device, whether from the library methods or through write(), before the 
+    * data is sent to the device. It is intended to allow the application to 
+    * monitor or record the device programming (eg, capture to a VGM file using 
+    * MD_YM2413_VGM).
+    *
+    * The callback is executed in the timing path of every write and should 
+    * return as quickly as possible.
+    *
+    * \sa cbWrite_t, \ref pageVGMCapture
+    *
+    * \param cb  the callback function, nullptr to remove the hook.
+    */
+    void setWriteHook(cbWrite_t cb) { _cbWrite = cb; }
+
+#if WRITE_BUDGET
+   /**
+    * Send all the queued writes
+    *
+    * Send all the register writes queued by the write budget without 
+    * waiting for the budget. This is used when the application needs 
+    * the device to be up to date (eg, before stopping).
+    *
+    * \sa \ref pageWriteBudget
+    */
+    void flush(void);
+#else
+   /**
+    * Send all the queued writes
+    *
+    * This does nothing as the write budget is not enabled.
+    *
+    * \sa \ref pageWriteBudget
+    */
+    void flush(void) {}
+#endif
+
+#if WRITE_BUDGET
+   /**
+    * Set the write budget
+    *
+    * Set the number of register writes sent to the device in each 
+    * millisecond. The default is the WRITE_BUDGET value.
+    *
+    * Only available when WRITE_BUDGET is enabled.
+    *
+    * \sa \ref pageWriteBudget
+    *
+    * \param perMs  the writes allowed per ms, 0 for no limit.
+    */
+    void setWriteBudget(uint8_t perMs);
+
+   /**
+    * Get the deferred write count
+    *
+    * \sa \ref pageWriteBudget
+    *
+    * \return the number of writes not sent when they were made.
+    */
+    uint16_t getDeferred(void) { return(_wDeferred); }
+
+   /**
+    * Get the merged write count
+    *
+    * \sa \ref pageWriteBudget
+    *
+    * \return the number of queued writes replaced by a later write to the same register.
+    */
+    uint16_t getMerged(void) { return(_wMerged); }
+
+   /**
+    * Get the forced write count
+    *
+    * \sa \ref pageWriteBudget
+    *
+    * \return the number of writes sent over the budget because the queue was full.
+    */
+    uint16_t getForced(void) { return(_wForced); }
+
+   /**
+    * Get the maximum key on latency
+    *
+    * \sa \ref pageWriteBudget
+    *
+    * \return the longest time in microseconds a key on write was queued.
+    */
+    uint32_t getKeyLatencyMax(void) { return(_wKeyLatencyMax); }
+
+   /**
+    * Reset the write budget statistics
+    *
+    * \sa \ref pageWriteBudget
+    */
+    void resetWriteStats(void);
+#endif
+
+#if LIB_STATS
+   /**
+    * Get the library statistics
+    *
+    * Copy the counters collected since begin() or resetStats().
+    *
+    * Only available when LIB_STATS is enabled.
+    *
+    * \sa stats_t, \ref pageStats
+    *
+    * \param s  the structure to copy the statistics into.
+    */
+    void getStats(stats_t& s);
+
+   /**
+    * Reset the library statistics
+    *
+    * Set all the counters to zero and restart the statistics time.
+    *
+    * \sa \ref pageStats
+    */
+    void resetStats(void);
+
+   /**
+    * Print the library statistics
+    *
+    * Print a table of the counters collected since begin() or resetStats()
+    * to a stream (eg, Serial). This is slow and should be done outside
+    * the timing the application is measuring.
+    *
+    * \sa \ref pageStats
+    *
+    * \param out  the stream to print to.
+    */
+    void printStats(Print& out);
+
+   /**
+    * Count a dropped note
+    *
+    * The library does not know when the application has no channel to
+    * play a note, so the application counts the notes dropped with this
+    * method (MD_YM2413_MIDI does this).
+    *
+    * \sa \ref pageStats
+    */
+    void countNoteDrop(void) { _stats.noteDrops++; }
+#endif
+
    /** @} */
 
    //--------------------------------------------------------------
@@ -511,7 +1586,7 @@ class MD_YM2413
     * \return the value of the instrument set for the channel.
     */
     instrument_t getInstrument(uint8_t chan) 
-    { if (chan < countChannels()) return(_C[chan].instrument); else return(I_UNDEFINED); }
+    { if (isValid(chan)) return((instrument_t)C(chan).instrument); else return(I_UNDEFINED); }
 
    /**
     * Get the volume for a channel.
@@ -521,7 +1596,7 @@ class MD_YM2413
     * \param chan  channel number on which volume is set [0..countChannels()-1].
     * \return the current volume in the range [VOL_MIN..VOL_MAX].
     */
-    uint8_t getVolume(uint8_t chan) { return(chan < countChannels() ? _C[chan].vol : 0); }
+    uint8_t getVolume(uint8_t chan) { return(isValid(chan) ? C(chan).vol : 0); }
 
    /**
     * Set the volume for a channel.
@@ -544,6 +1619,79 @@ class MD_YM2413
     */
     void setVolume(uint8_t v);
 
+   /**
+    * Fade the master volume.
+    *
+    * Change the master volume from the current level to the new level 
+    * over the specified time, in 3dB steps. The master volume attenuates 
+    * all the channels without changing the channel volume set points, so 
+    * getVolume() still returns the value last set by the application.
+    *
+    * The fade is worked by run(), which must be called frequently. The 
+    * changed volumes are sent over a number of run() calls, with no more 
+    * than setFadeWrites() register writes each time.
+    *
+    * \sa mute(), duck(), isFading(), setFadeWrites(), \ref pageFade
+    *
+    * \param level  the master volume in the range [VOL_OFF..VOL_MAX].
+    * \param ms     the fade time in ms, 0 to change as soon as possible.
+    */
+    void fadeTo(uint8_t level, uint16_t ms);
+
+   /**
+    * Mute the output.
+    *
+    * Fade the master volume to VOL_OFF. Use fadeTo() to restore the volume.
+    *
+    * \sa fadeTo()
+    *
+    * \param ms  the fade time in ms, 0 to mute as soon as possible.
+    */
+    void mute(uint16_t ms = 0) { fadeTo(VOL_OFF, ms); }
+
+   /**
+    * Duck a group of channels.
+    *
+    * Reduce the volume of the channels by the attenuation in dB, on top 
+    * of the master volume, over the specified time. The attenuation is 
+    * rounded to the nearest 3dB step. Only one group of channels can be 
+    * ducked, and a new call replaces the group. Channels removed from 
+    * the group return to their full volume.
+    *
+    * \sa fadeTo(), \ref pageFade
+    *
+    * \param chanMask  bit mask of the channels, bit 0 for channel 0, etc.
+    * \param dB        the attenuation in dB [0..45], 0 to end the ducking.
+    * \param ms        the time in ms to reach the attenuation.
+    */
+    void duck(uint16_t chanMask, uint8_t dB, uint16_t ms);
+
+   /**
+    * Return the fade state.
+    *
+    * \return true if a fade or duck is still changing the channel volumes.
+    */
+    bool isFading(void);
+
+   /**
+    * Get the master volume.
+    *
+    * \sa fadeTo()
+    *
+    * \return the current master volume in the range [VOL_OFF..VOL_MAX].
+    */
+    uint8_t getMasterVolume(void) { return(VOL_MAX - _fadeMaster.level); }
+
+   /**
+    * Set the fade write limit.
+    *
+    * Set the maximum number of volume register writes sent by each 
+    * run() call for fades and ducking. The default is FADE_WRITES_DEFAULT.
+    *
+    * \param n  the number of writes [1..255].
+    */
+    void setFadeWrites(uint8_t n) { _fadeWrites = (n == 0) ? 1 : n; }
+
    /**
     * Play a note (frequency)
     *
@@ -587,6 +1735,25 @@ class MD_YM2413
     */
     void noteOn(uint8_t chan, uint8_t octave, uint8_t note, uint8_t vol, uint16_t duration = 0);
 
+   /**
+    * Bend the pitch of a playing note
+    *
+    * Change the pitch of the note currently playing on the specified
+    * channel without retriggering the note. The bend is relative to the 
+    * octave and note number last passed to noteOn(), so this method has
+    * no effect for notes played by frequency or on percussion channels.
+    *
+    * The F-Num for the bent note is interpolated between the semitones
+    * in the note table, so no division is needed.
+    *
+    * \sa noteOn()
+    *
+    * \param chan    channel number of the playing note [0..countChannels()-1].
+    * \param bend    pitch offset from the note in 1/256 semitone units (eg, +512 
+    *                is 2 semitones up), 0 to restore the original pitch.
+    */
+    void bendNote(uint8_t chan, int16_t bend);
+
    /**
     * Stop playing a note
     *
@@ -608,6 +1775,30 @@ class MD_YM2413
     static const uint8_t PERC_CHANNELS = 5;       ///< Number of percussion channels if they are defined
     static const uint8_t MAX_CHANNELS = (PART_INSTR_CHANNELS+PERC_CHANNELS); ///< Worst case channel slots needed
     static const instrument_t DEFAULT_INSTRUMENT = I_PIANO;  ///< USed as the default instrument for initialization
+    static const uint8_t NOTES_PER_OCTAVE = 12;   ///< Number of semitones in an octave (block)
+    static const uint16_t FNUM_MAX = 0x1ff;       ///< Largest F-Num value (9 bits)
+    static const uint8_t WRITE_QUEUE_SIZE = 16;   ///< Number of writes queued by the write budget
+    static const uint8_t WG_PATCH = 0;            ///< writeBlock() group for the custom instrument and test registers
+    static const uint8_t WG_VOLUME = 1;           ///< writeBlock() group for the instrument and volume registers
+    static const uint8_t WG_FNUM = 2;             ///< writeBlock() group for the F-Num registers
+    static const uint8_t WG_KEY = 3;              ///< writeBlock() group for the block and key registers
+    static const uint8_t WG_RHYTHM = 4;           ///< writeBlock() group for the rhythm control register
+    static const uint8_t WG_COUNT = 5;            ///< number of writeBlock() groups
+    static const uint8_t WG_NONE = 0xff;          ///< writeBlock() group for addresses with no register
+    static const uint8_t BUS_CYCLES_ADDR = 12;    ///< Master clock cycles the device needs after an address write
+    static const uint8_t BUS_CYCLES_DATA = 84;    ///< Master clock cycles the device needs after a data write
+    static const uint8_t BUS_WE_PULSE_US = 1;     ///< Least time /WE is held LOW for a write, more than the datasheet 100ns minimum
+
+#if CHANNEL_MODE == CHANNEL_MODE_MELODY
+    static const uint8_t CHAN_SLOT_BASE = 0;                ///< Channel number held in the first slot
+    static const uint8_t CHAN_SLOTS = ALL_INSTR_CHANNELS;   ///< Number of channel slots allocated
+#elif CHANNEL_MODE == CHANNEL_MODE_RHYTHM
+    static const uint8_t CHAN_SLOT_BASE = PERC_CHAN_BASE;   ///< Channel number held in the first slot
+    static const uint8_t CHAN_SLOTS = PERC_CHANNELS;        ///< Number of channel slots allocated
+#else
+    static const uint8_t CHAN_SLOT_BASE = 0;                ///< Channel number held in the first slot
+    static const uint8_t CHAN_SLOTS = MAX_CHANNELS;         ///< Number of channel slots allocated
+#endif
 
     // Hardware register definitions
     static const uint8_t R_RHYTHM_CTL_REG = 0x0e;      ///< Rhythm control register address
@@ -642,22 +1833,22 @@ class MD_YM2413
       SUSTAIN,  ///< playing a note 
     };
 
+    // Fields are packed into the bits needed to hold their values
+    // and ordered so that no padding is needed between fields.
     struct channelData_t
     {
-      instrument_t instrument;  ///< the instrument assigned to this channel
-      bool sustain;             ///< true if the instrument needs to be sustained after playing
-      uint8_t vol;              ///< volume set point for this channel, 0-15 (map to attenuator 15-0)
-      uint16_t frequency;       ///< the frequency being played, 0 if not specified this way
-      uint8_t octave;           ///< the octave for this note
-      uint16_t fNum;            ///< the note frequency offset
+      uint32_t timeBase;        ///< base time for current time operation
       uint16_t duration;        ///< the total playing duration in ms
-
-      // FSM tracking variables
-      channelState_t  state;  ///< current note playing state
-      uint32_t timeBase;      ///< base time for current time operation
+      uint16_t fNum : 9;        ///< the note frequency offset
+      uint16_t note : 7;        ///< the note as semitones from block 0 C, NOTE_UNDEFINED if not specified this way
+      uint8_t instrument : 5;   ///< the instrument_t assigned to this channel
+      uint8_t sustain : 1;      ///< true if the instrument needs to be sustained after playing
+      uint8_t state : 1;        ///< current note playing state channelState_t
+      uint8_t vol : 4;          ///< volume set point for this channel, 0-15 (map to attenuator 15-0)
+      uint8_t octave : 3;       ///< the octave for this note
     };
     
-    channelData_t _C[MAX_CHANNELS];   ///< real-time tracking data for each channel
+    channelData_t _C[CHAN_SLOTS];   ///< real-time tracking data for each channel
 
     // Variables
     const uint8_t* _D; ///< YM2413 IC pins D0-D7 in that order
@@ -666,17 +1857,114 @@ class MD_YM2413
 
     bool _enablePercussion;   ///< true if percussion instruments are enabled
     uint8_t _lastAddress;     ///< used by send() to remember the last address and not repeat send if same
+    uint32_t _busTime;        ///< micros() time of the last bus write
+    uint8_t _busWait;         ///< us to wait after the last bus write before the next one
+    cbWrite_t _cbWrite;       ///< register write hook, nullptr if not set
+    cbWrite_t _cbDevice;      ///< software device for register writes, nullptr for the IC
+    bool _suspended;          ///< true if suspended, key on writes are held back
+    uint32_t _suspendTime;    ///< millis() time suspend() was invoked
+
+    // Master volume fade and ducking
+    struct fade_t
+    {
+      uint8_t level;      ///< current attenuation in 3dB steps
+      uint8_t target;     ///< target attenuation in 3dB steps
+      uint16_t stepTime;  ///< ms between steps
+      uint32_t timeLast;  ///< millis() time of the last step
+    };
+
+    fade_t _fadeMaster;       ///< master volume attenuation
+    fade_t _fadeDuck;         ///< ducked channels attenuation
+    uint16_t _duckMask;       ///< channels ducked, bit per channel
+    uint16_t _fadeDirty;      ///< channels with volume changes not yet sent, bit per channel
+    uint8_t _fadeWrites;      ///< writes allowed in each run()
+    uint8_t _fadeScan;        ///< last channel checked for volume changes
+
+#if WRITE_BUDGET
+    // Write budget queue
+    struct pendWrite_t
+    {
+      uint8_t addr;     ///< register address
+      uint8_t data;     ///< register data
+      uint32_t time;    ///< micros() time the write was made
+    };
+
+    pendWrite_t _W[WRITE_QUEUE_SIZE]; ///< queued writes, oldest first
+    uint8_t _wCount;          ///< number of queued writes
+    uint8_t _wBudget;         ///< writes allowed per ms, 0 for no limit
+    uint8_t _wTokens;         ///< writes left in the budget
+    uint32_t _wTime;          ///< millis() time the budget was last topped up
+    uint32_t _wNow;           ///< micros() time of the current send() or run()
+    uint16_t _wDeferred;      ///< statistics - writes deferred
+    uint16_t _wMerged;        ///< statistics - writes merged
+    uint16_t _wForced;        ///< statistics - writes forced by queue full
+    uint32_t _wKeyLatencyMax; ///< statistics - longest key on queue time
+#endif
+
+#if LIB_STATS
+    // Statistics
+    struct statCall_t   ///< times an application call to a method while in scope
+    {
+      MD_YM2413& s;     ///< the object counted
+      uint8_t method;   ///< STAT_* method index
+      uint32_t start;   ///< micros() time of the call
+
+      statCall_t(MD_YM2413& _s, uint8_t m);
+      ~statCall_t(void);
+    };
+
+    stats_t _stats;           ///< statistics counters
+    uint32_t _statsStart;     ///< millis() time the statistics were reset
+    uint8_t _statsDepth;      ///< library method calls in progress
+#endif
+
+#if CLOCK_RUNTIME
+    uint32_t _clockHz;        ///< master clock frequency in Hz
+    uint16_t _fNumRecip;      ///< clock reciprocal used to work out F-Num without dividing
+    uint16_t _fNumRAM[NOTES_PER_OCTAVE];  ///< F-Num for each note, worked out by begin()
+    uint8_t _busWaitAddr;     ///< us to wait after an address write
+    uint8_t _busWaitData;     ///< us to wait after a data write
+#endif
 
     // External static data
-    static const uint16_t _fNumTable[12];
-    static const uint16_t _blockTable[8];
+#if CLOCK_RUNTIME
+    static const uint16_t _noteTable[NOTES_PER_OCTAVE];
+#else
+    static const uint16_t _fNumTable[NOTES_PER_OCTAVE];
+#endif
 
     // Methods
+    inline channelData_t& C(uint8_t chan) { return(_C[chan - CHAN_SLOT_BASE]); }  ///< data slot for a channel
+    inline bool isValid(uint8_t chan) { return((uint8_t)(chan - CHAN_SLOT_BASE) < countChannels() - CHAN_SLOT_BASE); } ///< true if the channel has a slot
+#if CLOCK_RUNTIME
+    inline uint16_t fNumNote(uint8_t note) { return(_fNumRAM[note]); }   ///< F-Num for the note [0..11]
+    void initClock(void);
+#else
+    inline uint16_t fNumNote(uint8_t note) { return(pgm_read_word(&_fNumTable[note])); }   ///< F-Num for the note [0..11]
+#endif
+    inline uint16_t chanMask(void) { return(((1 << countChannels()) - 1) & ~((1 << CHAN_SLOT_BASE) - 1)); } ///< bit mask of valid channels
     void initChannels(void);
-    uint16_t calcFNum(uint16_t freq, uint8_t block);
-    uint8_t calcBlock(uint16_t freq);
+    uint8_t calcAtten(uint8_t chan);
+    void writeVolume(uint8_t chan);
+    void noteVolume(uint8_t chan, uint8_t vol);
+    void setFade(fade_t& f, uint8_t target, uint16_t ms);
+    bool stepFade(fade_t& f);
+    void runFade(void);
+    uint16_t calcFNum(uint16_t freq, uint8_t& block);
     uint8_t buildReg2x(bool susOn, bool keyOn, uint8_t octave, uint16_t fNum);
     uint8_t buildReg0e(bool enable, instrument_t instr, uint8_t keyOn);
+#if WRITE_BUDGET
+    bool isPriority(uint8_t addr);
+    bool isBarrier(uint8_t key, uint8_t i);
+    void queueWrite(uint8_t addr, uint8_t data);
+    void writeNext(void);
+    void flushWrites(void);
     void send(uint8_t addr, uint8_t data);
+#else
+    inline void send(uint8_t addr, uint8_t data) { busWrite(addr, data); }
+#endif
+    uint8_t writeGroup(uint8_t addr);
+    void busWrite(uint8_t addr, uint8_t data);
+    inline void busWait(void) { while (micros() - _busTime < _busWait) {} }  ///< wait until the device can take the next write
 };
 
@@ -0,0 +1,636 @@
+/*
+MD_YM2413 - Library for using a YM2413 sound generator
+
+See header file for copyright and licensing comments.
+*/
+#include <MD_YM2413_Emu.h>
+#include <MD_YM2413_lib.h>
+
+/**
+* \file
+* \brief Implements the software YM2413 synthesizer methods
+*/
+
+// Global data tables
+// Sine quarter wave as attenuation, round(-log2(sin((i + 0.5) * pi / 512)) * 256)
+const uint16_t PROGMEM MD_YM2413_Emu::_logSin[] =
+{
+  2137, 1731, 1543, 1419, 1326, 1252, 1190, 1137, 1091, 1050, 1013, 979, 949, 920, 894, 869,
+  846, 825, 804, 785, 767, 749, 732, 717, 701, 687, 672, 659, 646, 633, 621, 609,
+  598, 587, 576, 566, 556, 546, 536, 527, 518, 509, 501, 492, 484, 476, 468, 461,
+  453, 446, 439, 432, 425, 418, 411, 405, 399, 392, 386, 380, 375, 369, 363, 358,
+  352, 347, 341, 336, 331, 326, 321, 316, 311, 307, 302, 297, 293, 289, 284, 280,
+  276, 271, 267, 263, 259, 255, 251, 248, 244, 240, 236, 233, 229, 226, 222, 219,
+  215, 212, 209, 205, 202, 199, 196, 193, 190, 187, 184, 181, 178, 175, 172, 169,
+  167, 164, 161, 159, 156, 153, 151, 148, 146, 143, 141, 138, 136, 134, 131, 129,
+  127, 125, 122, 120, 118, 116, 114, 112, 110, 108, 106, 104, 102, 100, 98, 96,
+  94, 92, 91, 89, 87, 85, 83, 82, 80, 78, 77, 75, 74, 72, 70, 69,
+  67, 66, 64, 63, 62, 60, 59, 57, 56, 55, 53, 52, 51, 49, 48, 47,
+  46, 45, 43, 42, 41, 40, 39, 38, 37, 36, 35, 34, 33, 32, 31, 30,
+  29, 28, 27, 26, 25, 24, 23, 23, 22, 21, 20, 20, 19, 18, 17, 17,
+  16, 15, 15, 14, 13, 13, 12, 12, 11, 10, 10, 9, 9, 8, 8, 7,
+  7, 7, 6, 6, 5, 5, 5, 4, 4, 4, 3, 3, 3, 2, 2, 2,
+  2, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0,
+};
+
+// Attenuation to level, round(2^(i / 256) * 1024)
+const uint16_t PROGMEM MD_YM2413_Emu::_exp[] =
+{
+  1024, 1027, 1030, 1032, 1035, 1038, 1041, 1044, 1046, 1049, 1052, 1055, 1058, 1061, 1064, 1066,
+  1069, 1072, 1075, 1078, 1081, 1084, 1087, 1090, 1093, 1096, 1099, 1102, 1105, 1108, 1111, 1114,
+  1117, 1120, 1123, 1126, 1129, 1132, 1135, 1138, 1141, 1144, 1147, 1150, 1154, 1157, 1160, 1163,
+  1166, 1169, 1172, 1176, 1179, 1182, 1185, 1188, 1192, 1195, 1198, 1201, 1205, 1208, 1211, 1214,
+  1218, 1221, 1224, 1228, 1231, 1234, 1238, 1241, 1244, 1248, 1251, 1255, 1258, 1261, 1265, 1268,
+  1272, 1275, 1279, 1282, 1286, 1289, 1292, 1296, 1300, 1303, 1307, 1310, 1314, 1317, 1321, 1324,
+  1328, 1332, 1335, 1339, 1342, 1346, 1350, 1353, 1357, 1361, 1364, 1368, 1372, 1376, 1379, 1383,
+  1387, 1391, 1394, 1398, 1402, 1406, 1409, 1413, 1417, 1421, 1425, 1429, 1433, 1436, 1440, 1444,
+  1448, 1452, 1456, 1460, 1464, 1468, 1472, 1476, 1480, 1484, 1488, 1492, 1496, 1500, 1504, 1508,
+  1512, 1516, 1520, 1525, 1529, 1533, 1537, 1541, 1545, 1550, 1554, 1558, 1562, 1566, 1571, 1575,
+  1579, 1584, 1588, 1592, 1596, 1601, 1605, 1609, 1614, 1618, 1623, 1627, 1631, 1636, 1640, 1645,
+  1649, 1654, 1658, 1663, 1667, 1672, 1676, 1681, 1685, 1690, 1694, 1699, 1704, 1708, 1713, 1717,
+  1722, 1727, 1732, 1736, 1741, 1746, 1750, 1755, 1760, 1765, 1769, 1774, 1779, 1784, 1789, 1794,
+  1798, 1803, 1808, 1813, 1818, 1823, 1828, 1833, 1838, 1843, 1848, 1853, 1858, 1863, 1868, 1873,
+  1878, 1883, 1888, 1893, 1898, 1904, 1909, 1914, 1919, 1924, 1930, 1935, 1940, 1945, 1951, 1956,
+  1961, 1966, 1972, 1977, 1983, 1988, 1993, 1999, 2004, 2010, 2015, 2020, 2026, 2031, 2037, 2042,
+};
+
+// ROM instrument patches in register 0x00-0x07 format.
+// Instrument 0 (custom) is read from the registers.
+const uint8_t PROGMEM MD_YM2413_Emu::_patch[] =
+{
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,   // custom
+  0x71, 0x61, 0x1e, 0x17, 0xd0, 0x78, 0x00, 0x17,   // violin
+  0x13, 0x41, 0x1a, 0x0d, 0xd8, 0xf7, 0x23, 0x13,   // guitar
+  0x13, 0x01, 0x99, 0x00, 0xf2, 0xc4, 0x21, 0x23,   // piano
+  0x11, 0x61, 0x0e, 0x07, 0x8d, 0x64, 0x70, 0x27,   // flute
+  0x32, 0x21, 0x1e, 0x06, 0xe1, 0x76, 0x01, 0x28,   // clarinet
+  0x31, 0x22, 0x16, 0x05, 0xe0, 0x71, 0x00, 0x18,   // oboe
+  0x21, 0x61, 0x1d, 0x07, 0x82, 0x81, 0x11, 0x07,   // trumpet
+  0x33, 0x21, 0x2d, 0x13, 0xb0, 0x70, 0x00, 0x07,   // organ
+  0x61, 0x61, 0x1b, 0x06, 0x64, 0x65, 0x10, 0x17,   // horn
+  0x41, 0x61, 0x0b, 0x18, 0x85, 0xf0, 0x81, 0x07,   // synthesizer
+  0x33, 0x01, 0x83, 0x11, 0xea, 0xef, 0x10, 0x04,   // harpsichord
+  0x17, 0xc1, 0x24, 0x07, 0xf8, 0xf8, 0x22, 0x12,   // vibraphone
+  0x61, 0x50, 0x0c, 0x05, 0xd2, 0xf5, 0x40, 0x42,   // synthesizer bass
+  0x01, 0x01, 0x55, 0x03, 0xe9, 0x90, 0x03, 0x02,   // acoustic bass
+  0x41, 0x41, 0x89, 0x03, 0xf1, 0xe4, 0xc0, 0x13,   // electric guitar
+  0x01, 0x01, 0x18, 0x0f, 0xdf, 0xf8, 0x6a, 0x6d,   // bass drum
+  0x01, 0x01, 0x00, 0x00, 0xc8, 0xd8, 0xa7, 0x68,   // hi hat (modulator), snare drum (carrier)
+  0x05, 0x01, 0x00, 0x00, 0xf8, 0xaa, 0x59, 0x55,   // tom tom (modulator), top cymbal (carrier)
+};
+
+// Key scale level in 0.75dB steps for block 7
+const uint8_t PROGMEM MD_YM2413_Emu::_ksl[] =
+{
+  0, 24, 32, 37, 40, 43, 45, 47, 48, 50, 51, 52, 53, 54, 55, 56
+};
+
+const uint8_t PROGMEM MD_YM2413_Emu::_mul2[] =
+{
+  1, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 20, 24, 24, 30, 30
+};
+
+// Vibrato offset in 1/2 F-Num units
+const int8_t PROGMEM MD_YM2413_Emu::_pm[] =
+{
+  0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 1, 0, 0, 0, -1, 0,
+  0, 1, 2, 1, 0, -1, -2, -1,
+  0, 1, 3, 1, 0, -1, -3, -1,
+  0, 2, 4, 2, 0, -2, -4, -2,
+  0, 2, 5, 2, 0, -2, -5, -2,
+  0, 3, 6, 3, 0, -3, -6, -3,
+  0, 3, 7, 3, 0, -3, -7, -3,
+};
+
+// Rhythm operators are slots 12-17: BD, BD, HH, SD, TOM, TCY
+const uint8_t PROGMEM MD_YM2413_Emu::_rhythmKey[] =
+{
+  0x10, 0x10, 0x01, 0x08, 0x04, 0x02
+};
+
+// Envelope step patterns for the low 2 bits of the rate, one bit per step
+static const uint8_t egPattern[] = { 0xaa, 0xba, 0xee, 0xfe };
+
+void MD_YM2413_Emu::reset(void)
+{
+  memset(_reg, 0, sizeof(_reg));
+  memset(_S, 0, sizeof(_S));
+  for (uint8_t i = 0; i < SLOTS; i++)
+  {
+    _S[i].state = EG_OFF;
+    _S[i].env = ENV_MAX;
+  }
+
+  _active = 0;
+  _egCount = 0;
+  _noise = 1;
+  _amTick = _amPos = _amLevel = 0;
+  _pmTick = _pmPos = 0;
+
+  for (uint8_t ch = 0; ch < CHANNELS; ch++)
+    updateChannel(ch);
+}
+
+void MD_YM2413_Emu::write(uint8_t addr, uint8_t data)
+{
+  uint8_t old;
+
+  if (addr >= REGISTERS)
+    return;
+
+  old = _reg[addr];
+  _reg[addr] = data;
+
+  if (addr < 0x08)          // custom instrument
+  {
+    for (uint8_t ch = 0; ch < CHANNELS; ch++)
+      if ((_reg[0x30 + ch] >> 4) == MD_YM2413::I_CUSTOM)
+        updateChannel(ch);
+  }
+  else if (addr == 0x0e)    // rhythm
+  {
+    if ((old ^ data) & 0x20)
+      for (uint8_t ch = 6; ch < CHANNELS; ch++)
+        updateChannel(ch);
+    updateKeys();
+  }
+  else if (addr >= 0x10 && (addr & 0xf) < CHANNELS)
+  {
+    updateChannel(addr & 0xf);
+    if ((addr & 0xf0) == 0x20)
+      updateKeys();
+  }
+}
+
+void MD_YM2413_Emu::updateChannel(uint8_t ch)
+// Work out the operator settings from the registers for the channel
+{
+  uint8_t p[8];
+  uint16_t fnum = _reg[0x10 + ch] | ((_reg[0x20 + ch] & 1) << 8);
+  uint8_t block = (_reg[0x20 + ch] >> 1) & 7;
+  uint8_t kcode = (block << 1) | (fnum >> 8);
+  bool rhythm = isRhythm() && ch >= 6;
+
+  // get the patch
+  if (rhythm)
+    memcpy_P(p, &_patch[(16 + ch - 6) * 8], sizeof(p));
+  else if ((_reg[0x30 + ch] >> 4) == MD_YM2413::I_CUSTOM)
+    memcpy(p, _reg, sizeof(p));
+  else
+    memcpy_P(p, &_patch[(_reg[0x30 + ch] >> 4) * 8], sizeof(p));
+
+  _fb[ch] = p[3] & 7;
+
+  for (uint8_t op = 0; op < 2; op++)
+  {
+    emuSlot_t& s = _S[(ch * 2) + op];
+    uint8_t ksl = (op == 0 ? p[2] : p[3]) >> 6;
+    uint16_t tl;
+
+    s.fnum = fnum;
+    s.block = block;
+    s.mul2 = pgm_read_byte(&_mul2[p[op] & 0xf]);
+    s.inc = ((uint32_t)(fnum * s.mul2) << block) >> 1;
+    s.flags = (p[op] & 0xf0) | ((p[3] & (op == 0 ? 0x08 : 0x10)) ? F_HALF : 0);
+    s.rks = (p[op] & F_KSR) ? kcode : kcode >> 2;
+    s.ar = p[4 + op] >> 4;
+    s.dr = p[4 + op] & 0xf;
+    s.sl = (p[6 + op] >> 4) << 3;
+    s.rr = p[6 + op] & 0xf;
+
+    // level, in 0.75dB steps for total level or 3dB steps for volume
+    if (op == 0)
+    {
+      if (rhythm && ch == 7) tl = (_reg[0x37] >> 4) << 3;       // HH
+      else if (rhythm && ch == 8) tl = (_reg[0x38] >> 4) << 3;  // TOM
+      else tl = (p[2] & 0x3f) << 1;
+    }
+    else    // also BD, SD and TCY volumes in 0x36-0x38
+      tl = (_reg[0x30 + ch] & 0xf) << 3;
+
+    // key scale level is 1.5, 3 or 6dB per octave. The table and the
+    // 6dB per block are in 0.75dB steps, so double it to 0.375dB steps.
+    if (ksl != 0)
+    {
+      int16_t k = pgm_read_byte(&_ksl[fnum >> 5]) - ((7 - block) << 3);
+
+      if (k > 0)
+        tl += (k << 1) >> (3 - ksl);
+    }
+    s.tl = (tl > ENV_MAX) ? ENV_MAX : tl;
+
+    setRate((ch * 2) + op);
+  }
+}
+
+void MD_YM2413_Emu::updateKeys(void)
+// Key on or off the operators that have changed
+{
+  bool rhythm = isRhythm();
+
+  for (uint8_t i = 0; i < SLOTS; i++)
+  {
+    emuSlot_t& s = _S[i];
+    bool key = _reg[0x20 + (i >> 1)] & 0x10;
+
+    if (rhythm && i >= 12)
+      key = key || (_reg[0x0e] & pgm_read_byte(&_rhythmKey[i - 12]));
+
+    if (key == s.key)
+      continue;
+
+    s.key = key;
+    if (key)
+    {
+      s.phase = 0;
+      s.state = EG_ATTACK;
+      _active |= (1 << (i >> 1));
+    }
+    else if (s.state != EG_OFF)
+      s.state = EG_RELEASE;
+    setRate(i);
+  }
+}
+
+void MD_YM2413_Emu::setRate(uint8_t i)
+// Set the envelope rate for the current state of the operator
+{
+  emuSlot_t& s = _S[i];
+  uint8_t r;
+
+  switch (s.state)
+  {
+  case EG_ATTACK:   r = s.ar; break;
+  case EG_DECAY:    r = s.dr; break;
+  case EG_SUSTAIN:  r = (s.flags & F_EG) ? 0 : s.rr; break;
+  case EG_RELEASE:
+    if (_reg[0x20 + (i >> 1)] & 0x20) r = 5;    // channel sustain
+    else if (s.flags & F_EG) r = s.rr;
+    else r = 7;
+    break;
+  default:          r = 0; break;
+  }
+
+  s.rate = (r == 0) ? 0 : (r << 2) + s.rks;
+  if (s.rate > 63) s.rate = 63;
+
+  // the fastest attack is immediate
+  if (s.state == EG_ATTACK && s.rate >= 60)
+  {
+    s.env = 0;
+    s.state = EG_DECAY;
+    setRate(i);
+  }
+}
+
+uint8_t MD_YM2413_Emu::egStep(uint8_t rate)
+// Return the envelope step for this sample as a shift + 1, or 0 for no step.
+// Rates below 52 step every 2^(13 - rate/4) samples, faster rates every
+// sample with bigger steps.
+{
+  if (rate < 4)
+    return(0);
+
+  if (rate < 52)
+  {
+    uint8_t shift = 13 - (rate >> 2);
+
+    if (_egCount & ((1 << shift) - 1))
+      return(0);
+    return((egPattern[rate & 3] >> ((_egCount >> shift) & 7)) & 1);
+  }
+
+  return(((egPattern[rate & 3] >> (_egCount & 7)) & 1) ? (rate >> 2) - 12 : 0);
+}
+
+void MD_YM2413_Emu::stepEnvelope(uint8_t i)
+// Move the envelope on by one sample. Steps are only shifts and adds.
+{
+  emuSlot_t& s = _S[i];
+  uint8_t step;
+
+  if (s.state == EG_DECAY && s.env >= s.sl)
+  {
+    s.state = EG_SUSTAIN;
+    setRate(i);
+  }
+
+  if ((step = egStep(s.rate)) == 0)
+    return;
+  step--;
+
+  switch (s.state)
+  {
+  case EG_ATTACK:   // exponential approach to 0
+    {
+      uint8_t d = ((s.env << step) >> 3) + 1;
+
+      if (d >= s.env)
+      {
+        s.env = 0;
+        s.state = EG_DECAY;
+        setRate(i);
+      }
+      else
+        s.env -= d;
+    }
+    break;
+
+  case EG_DECAY:
+    s.env += (1 << step);
+    if (s.env >= s.sl)
+    {
+      s.env = s.sl;
+      s.state = EG_SUSTAIN;
+      setRate(i);
+    }
+    break;
+
+  case EG_SUSTAIN:
+  case EG_RELEASE:
+    s.env += (1 << step);
+    if (s.env >= ENV_MAX)
+    {
+      s.env = ENV_MAX;
+      s.state = EG_OFF;
+      setRate(i);
+      if (_S[i ^ 1].state == EG_OFF)    // both channel operators are silent
+        _active &= ~(1 << (i >> 1));
+    }
+    break;
+
+  default:
+    break;
+  }
+}
+
+void MD_YM2413_Emu::stepPhase(uint8_t i)
+// Move the operator phase on by one sample, with the vibrato if it is on
+{
+  emuSlot_t& s = _S[i];
+
+  if (s.flags & F_PM)
+  {
+    int16_t f = (s.fnum << 1) + (int8_t)pgm_read_byte(&_pm[((s.fnum >> 6) << 3) + _pmPos]);
+
+    s.phase += ((uint32_t)(f * s.mul2) << s.block) >> 2;
+  }
+  else
+    s.phase += s.inc;
+  s.phase &= 0x7ffff;
+}
+
+int16_t MD_YM2413_Emu::calcOutput(emuSlot_t& s, uint16_t phase)
+// Work out the operator output for the 10 bit phase, as a 13 bit signed value
+{
+  uint16_t att, l;
+  uint8_t i;
+  int16_t v;
+
+  if (s.state == EG_OFF)
+    return(0);
+  if ((phase & 0x200) && (s.flags & F_HALF))
+    return(0);
+
+  att = s.env + s.tl + ((s.flags & F_AM) ? _amLevel : 0);
+  i = (phase & 0x100) ? ~phase : phase;
+  l = pgm_read_word(&_logSin[i]) + (att << 4);    // 0.375dB is 16/256 of 6dB
+  if ((l >> 8) > 12)
+    return(0);
+
+  v = (pgm_read_word(&_exp[~l & 0xff]) << 1) >> (l >> 8);
+
+  return((phase & 0x200) ? -v : v);
+}
+
+int16_t MD_YM2413_Emu::calcChannel(uint8_t ch)
+// Work out the output of a 2 operator channel
+{
+  emuSlot_t& m = _S[ch * 2];
+  emuSlot_t& c = _S[(ch * 2) + 1];
+  int16_t fb = (_fb[ch] == 0) ? 0 : (m.out[0] + m.out[1]) >> (9 - _fb[ch]);
+
+  m.out[1] = m.out[0];
+#if EMU_SKIP_IDLE
+  if (!(_active & (1 << ch)))   // same as the operator outputs for EG_OFF
+  {
+    m.out[0] = 0;
+    return(0);
+  }
+#endif
+  m.out[0] = calcOutput(m, (m.phase >> 9) + fb);
+
+  return(calcOutput(c, (c.phase >> 9) + m.out[0]));
+}
+
+int32_t MD_YM2413_Emu::calcRhythm(void)
+// Work out the output of the rhythm operators. HH, SD and TCY phases
+// are made from bits of the HH and TCY phases and the noise generator.
+{
+  emuSlot_t& hh = _S[14];
+  emuSlot_t& sd = _S[15];
+  emuSlot_t& tom = _S[16];
+  emuSlot_t& tcy = _S[17];
+  uint16_t p7 = hh.phase >> 9;
+  uint16_t p8 = tcy.phase >> 9;
+  bool noise = _noise & 1;
+  bool ring = ((((p7 >> 2) ^ (p7 >> 7)) | (p7 >> 3)) & 1) || (((p8 >> 3) ^ (p8 >> 5)) & 1);
+  uint16_t ph;
+  int32_t mix;
+
+  mix = calcChannel(6);   // BD
+
+  ph = ring ? (0x200 | (0xd0 >> 2)) : 0xd0;
+  if (noise) ph = (ph & 0x200) ? (0x200 | 0xd0) : (0xd0 >> 2);
+  mix += calcOutput(hh, ph);
+
+  ph = (p7 & 0x100) ? 0x200 : 0x100;
+  if (noise) ph ^= 0x100;
+  mix += calcOutput(sd, ph);
+
+  mix += calcOutput(tom, tom.phase >> 9);
+  mix += calcOutput(tcy, ring ? 0x300 : 0x100);
+
+  return(mix << 1);
+}
+
+int16_t MD_YM2413_Emu::calcSample(void)
+// Work out the next sample
+{
+  bool rhythm = isRhythm();
+  int32_t mix = 0;
+
+  // LFOs and noise
+  if (++_amTick >= AM_TICKS)
+  {
+    uint8_t tri;
+
+    _amTick = 0;
+    _amPos = (_amPos + 1) & 0x3f;
+    tri = (_amPos < 32) ? _amPos : 63 - _amPos;
+    _amLevel = (tri * 13) >> 5;     // 4.8dB
+  }
+  if (++_pmTick >= PM_TICKS)
+  {
+    _pmTick = 0;
+    _pmPos = (_pmPos + 1) & 7;
+  }
+  if (_noise & 1) _noise ^= 0x800302;
+  _noise >>= 1;
+
+  // envelopes and phases
+  _egCount++;
+  for (uint8_t ch = 0; ch < CHANNELS; ch++)
+  {
+    uint8_t i = ch * 2;
+
+#if EMU_SKIP_IDLE
+    // Silent channels stay silent until key on, which resets the phases.
+    // The HH and TCY phases are also used for the other rhythm sounds.
+    if (!(_active & (1 << ch)))
+    {
+      if (ch == 7) stepPhase(14);
+      else if (ch == 8) stepPhase(17);
+      continue;
+    }
+#endif
+    stepEnvelope(i);
+    stepPhase(i);
+    stepEnvelope(i + 1);
+    stepPhase(i + 1);
+  }
+
+  // mix the channels
+  for (uint8_t ch = 0; ch < (rhythm ? 6 : CHANNELS); ch++)
+    mix += calcChannel(ch);
+  if (rhythm)
+    mix += calcRhythm();
+
+  if (mix > INT16_MAX) mix = INT16_MAX;
+  if (mix < INT16_MIN) mix = INT16_MIN;
+
+  return(mix);
+}
+
+bool MD_YM2413_Emu::isSilent(void)
+{
+  // carriers, and the HH and TOM modulators in rhythm mode
+  for (uint8_t i = 1; i < SLOTS; i += 2)
+    if (_S[i].state != EG_OFF)
+      return(false);
+
+  if (isRhythm() && (_S[14].state != EG_OFF || _S[16].state != EG_OFF))
+    return(false);
+
+  return(true);
+}
+
+void MD_YM2413_Emu::render(int16_t* buf, uint16_t count)
+{
+  while (count--)
+    *buf++ = calcSample();
+}
+
+// Snapshot layout, all values little endian
+// - 'Y', 'M', SNAPSHOT_VERSION
+// - registers 0x00-0x38
+// - for each operator, phase (3 bytes), out[0] and out[1] (2 bytes each),
+//   envelope state with the key in bit 7, envelope attenuation
+// - envelope counter (2), noise (3), AM tick, AM position, PM tick (2), PM position
+static uint8_t* putBytes(uint8_t* p, uint32_t v, uint8_t size)
+{
+  while (size--)
+  {
+    *p++ = v & 0xff;
+    v >>= 8;
+  }
+  return(p);
+}
+
+static const uint8_t* getBytes(const uint8_t* p, uint32_t& v, uint8_t size)
+{
+  v = 0;
+  for (uint8_t i = 0; i < size; i++)
+    v |= (uint32_t)*p++ << (i * 8);
+  return(p);
+}
+
+uint16_t MD_YM2413_Emu::saveState(uint8_t* buf)
+{
+  uint8_t* p = buf;
+
+  *p++ = 'Y';
+  *p++ = 'M';
+  *p++ = SNAPSHOT_VERSION;
+  memcpy(p, _reg, SNAPSHOT_REGS);
+  p += SNAPSHOT_REGS;
+
+  for (uint8_t i = 0; i < SLOTS; i++)
+  {
+    emuSlot_t& s = _S[i];
+
+    p = putBytes(p, s.phase, 3);
+    p = putBytes(p, (uint16_t)s.out[0], 2);
+    p = putBytes(p, (uint16_t)s.out[1], 2);
+    *p++ = s.state | (s.key ? 0x80 : 0);
+    *p++ = s.env;
+  }
+
+  p = putBytes(p, _egCount, 2);
+  p = putBytes(p, _noise, 3);
+  *p++ = _amTick;
+  *p++ = _amPos;
+  p = putBytes(p, _pmTick, 2);
+  *p++ = _pmPos;
+
+  return(p - buf);
+}
+
+bool MD_YM2413_Emu::restoreState(const uint8_t* buf)
+{
+  const uint8_t* p = buf;
+  uint32_t v;
+  uint8_t tri;
+
+  if (p[0] != 'Y' || p[1] != 'M' || p[2] != SNAPSHOT_VERSION)
+    return(false);
+  p += 3;
+
+  memset(_reg, 0, sizeof(_reg));
+  memcpy(_reg, p, SNAPSHOT_REGS);
+  p += SNAPSHOT_REGS;
+
+  for (uint8_t i = 0; i < SLOTS; i++)
+  {
+    emuSlot_t& s = _S[i];
+
+    p = getBytes(p, v, 3);  s.phase = v;
+    p = getBytes(p, v, 2);  s.out[0] = (int16_t)v;
+    p = getBytes(p, v, 2);  s.out[1] = (int16_t)v;
+    s.state = *p & 0x7f;
+    s.key = *p++ & 0x80;
+    s.env = *p++;
+  }
+
+  p = getBytes(p, v, 2);  _egCount = v;
+  p = getBytes(p, v, 3);  _noise = v;
+  _amTick = *p++;
+  _amPos = *p++;
+  p = getBytes(p, v, 2);  _pmTick = v;
+  _pmPos = *p++;
+
+  tri = (_amPos < 32) ? _amPos : 63 - _amPos;
+  _amLevel = (tri * 13) >> 5;
+
+  // work out everything else from the registers and envelope states
+  _active = 0;
+  for (uint8_t ch = 0; ch < CHANNELS; ch++)
+  {
+    if (_S[ch * 2].state != EG_OFF || _S[(ch * 2) + 1].state != EG_OFF)
+      _active |= (1 << ch);
+    updateChannel(ch);
+  }
+
+  return(true);
+}
@@ -0,0 +1,226 @@
+#pragma once
+
+#include <Arduino.h>
+#include <MD_YM2413.h>
+
+/**
+ * \file
+ * \brief Header file for the MD_YM2413_Emu software YM2413
+ */
+
+#ifndef EMU_SKIP_IDLE
+#define EMU_SKIP_IDLE 1   ///< Set to 1 to skip the silent channels when rendering. See \ref pageCompileSwitch
+#endif
+
+/**
+ * Software YM2413 (OPLL) synthesizer class for the MD_YM2413 library
+ *
+ * Works out the YM2413 sound from the register writes using integer
+ * arithmetic and lookup tables only, so it runs on MCUs without an FPU.
+ * The samples are rendered in blocks into a buffer supplied by the
+ * application for output to a DAC or I2S device.
+ * See \ref pageEmulator for how this is used.
+ */
+class MD_YM2413_Emu
+{
+  public:
+    static const uint8_t CLOCK_DIV = 72;    ///< master clock cycles for each output sample
+    static const uint8_t SNAPSHOT_VERSION = 1;  ///< snapshot format version, changed when the layout changes
+    static const uint16_t SNAPSHOT_SIZE = 232;  ///< bytes in a snapshot
+
+   /**
+    * Class Constructor.
+    *
+    * Instantiate a new instance of the class.
+    *
+    * \param clock  the master clock frequency in Hz, sets the sample rate.
+    */
+    MD_YM2413_Emu(uint32_t clock = CLOCK_HZ) : _clock(clock) {};
+
+   /**
+    * Class Destructor.
+    *
+    * Does the necessary to clean up once the object is no longer required.
+    */
+    ~MD_YM2413_Emu(void) {};
+
+   /**
+    * Initialize the object.
+    *
+    * Initialize the object data. This needs to be called during setup(), before
+    * the begin() for the MD_YM2413 object that writes to it.
+    */
+    void begin(void) { reset(); }
+
+   /**
+    * Reset the synthesizer.
+    *
+    * Set all the registers to 0 and silence all the channels, the same as
+    * the YM2413 IC after a reset.
+    */
+    void reset(void);
+
+   /**
+    * Write a register.
+    *
+    * Write the data to the register, with the same effect as a write to
+    * the YM2413 IC. This is usually called from the MD_YM2413 device
+    * callback (see \ref pageEmulator).
+    *
+    * \param addr  the register address [0x00..0x38].
+    * \param data  the data for the register.
+    */
+    void write(uint8_t addr, uint8_t data);
+
+   /**
+    * Get the sample rate.
+    *
+    * The YM2413 works out one sample every 72 master clock cycles, about
+    * 49.7kHz for the default clock.
+    *
+    * \return the sample rate in Hz.
+    */
+    uint32_t getSampleRate(void) { return(_clock / CLOCK_DIV); }
+
+   /**
+    * Render a block of samples.
+    *
+    * Work out the next count samples into the buffer as signed 16 bit
+    * mono values.
+    *
+    * \param buf    the buffer for the samples.
+    * \param count  the number of samples to work out.
+    */
+    void render(int16_t* buf, uint16_t count);
+
+   /**
+    * Get the active channels.
+    *
+    * A channel is active from key on until both its operators have
+    * released to silence. Only the active channels are worked out when
+    * rendering (see EMU_SKIP_IDLE in \ref pageCompileSwitch).
+    *
+    * \return bit field with bit n set if channel n is active, channels 6-8 for the rhythm operators.
+    */
+    uint16_t getActive(void) { return(_active); }
+
+   /**
+    * Check if the output is silent.
+    *
+    * The output is silent when all the operators that are heard have
+    * released to silence. A channel can be silent and still active, as
+    * some instruments hold the modulator envelope after the key off.
+    *
+    * \return true if the output is silent, false otherwise.
+    */
+    bool isSilent(void);
+
+   /**
+    * Save the synthesizer state.
+    *
+    * Copy everything needed to carry on rendering from this point into the
+    * buffer - the registers, the operator phases, envelopes and feedback,
+    * and the LFO and noise generator positions. Values that are worked out 
+    * from the registers are not saved.
+    *
+    * The snapshot starts with an identifier and SNAPSHOT_VERSION, so that
+    * snapshots kept in files can be checked when they are restored.
+    *
+    * \param buf  the buffer for the snapshot, at least SNAPSHOT_SIZE bytes.
+    * \return the number of bytes saved (SNAPSHOT_SIZE).
+    */
+    uint16_t saveState(uint8_t* buf);
+
+   /**
+    * Restore the synthesizer state.
+    *
+    * Set the state saved by saveState(), so the next samples rendered are 
+    * the same as those rendered after the snapshot was taken. The state is 
+    * unchanged if the snapshot is not for this SNAPSHOT_VERSION.
+    *
+    * The MD_YM2413 object writing to this object does not know about the
+    * change, so the application needs to set the notes, instruments and 
+    * volumes it uses again after the restore.
+    *
+    * \param buf  the snapshot saved by saveState().
+    * \return true if the state was restored, false otherwise.
+    */
+    bool restoreState(const uint8_t* buf);
+
+  private:
+    static const uint8_t CHANNELS = 9;      ///< YM2413 channels
+    static const uint8_t SLOTS = 18;        ///< operators, modulator and carrier for each channel
+    static const uint8_t REGISTERS = 0x40;  ///< register address space
+    static const uint8_t ENV_MAX = 127;     ///< maximum envelope attenuation
+    static const uint8_t AM_TICKS = 210;    ///< samples for each of 64 AM LFO steps, 3.7Hz
+    static const uint16_t PM_TICKS = 971;   ///< samples for each of 8 PM LFO steps, 6.4Hz
+    static const uint8_t SNAPSHOT_REGS = 0x39;  ///< registers saved in a snapshot
+
+    // Operator flags, same bits as the patch registers 0 and 1
+    static const uint8_t F_AM = 0x80;       ///< amplitude modulation
+    static const uint8_t F_PM = 0x40;       ///< vibrato
+    static const uint8_t F_EG = 0x20;       ///< sustained envelope
+    static const uint8_t F_KSR = 0x10;      ///< key scale rate
+    static const uint8_t F_HALF = 0x01;     ///< half wave rectified sine
+
+    // Envelope states
+    typedef enum { EG_ATTACK, EG_DECAY, EG_SUSTAIN, EG_RELEASE, EG_OFF } egState_t;
+
+    // Per operator data
+    struct emuSlot_t
+    {
+      uint32_t phase;     ///< phase accumulator, 19 bits
+      uint32_t inc;       ///< phase increment for each sample, without vibrato
+      int16_t out[2];     ///< last two outputs, for the feedback
+      uint16_t fnum;      ///< channel F-Num
+      uint8_t block;      ///< channel block
+      uint8_t mul2;       ///< frequency multiplier x 2
+      uint8_t flags;      ///< F_* flags from the patch
+      uint8_t state;      ///< envelope state
+      uint8_t env;        ///< envelope attenuation in 0.375dB steps [0..ENV_MAX]
+      uint8_t rate;       ///< envelope rate for the current state [0..63]
+      uint8_t tl;         ///< level attenuation (total level or volume and key scale level) in 0.375dB steps
+      uint8_t sl;         ///< sustain level in 0.375dB steps
+      uint8_t ar;         ///< attack rate [0..15]
+      uint8_t dr;         ///< decay rate [0..15]
+      uint8_t rr;         ///< release rate [0..15]
+      uint8_t rks;        ///< key scale rate offset
+      bool key;           ///< key on
+    };
+
+    uint32_t _clock;                ///< master clock in Hz
+    uint8_t _reg[REGISTERS];        ///< register values
+    emuSlot_t _S[SLOTS];            ///< operator data, modulator then carrier for each channel
+    uint8_t _fb[CHANNELS];          ///< channel modulator feedback [0..7]
+
+    uint16_t _active;               ///< bit set for each channel with an operator that is not EG_OFF
+    uint16_t _egCount;              ///< envelope generator sample counter
+    uint32_t _noise;                ///< rhythm noise generator shift register
+    uint8_t _amTick;                ///< samples to the next AM LFO step
+    uint8_t _amPos;                 ///< AM LFO position [0..63]
+    uint8_t _amLevel;               ///< AM LFO attenuation in 0.375dB steps
+    uint16_t _pmTick;               ///< samples to the next PM LFO step
+    uint8_t _pmPos;                 ///< PM LFO position [0..7]
+
+    // Tables
+    static const uint16_t _logSin[];    ///< -log2(sin) for a quarter wave, 8 fractional bits
+    static const uint16_t _exp[];       ///< 2^x for the fractional part, 10 fractional bits
+    static const uint8_t _patch[];      ///< ROM instrument patches, 8 bytes each
+    static const uint8_t _ksl[];        ///< key scale level by the top 4 F-Num bits
+    static const uint8_t _mul2[];       ///< frequency multiplier x 2
+    static const int8_t _pm[];          ///< vibrato F-Num offset by the top 3 F-Num bits and PM LFO position
+    static const uint8_t _rhythmKey[];  ///< register 0x0e key bit for the rhythm operators
+
+    // Methods
+    bool isRhythm(void) { return(_reg[0x0e] & 0x20); }
+    void updateChannel(uint8_t ch);
+    void updateKeys(void);
+    void setRate(uint8_t i);
+    uint8_t egStep(uint8_t rate);
+    void stepEnvelope(uint8_t i);
+    void stepPhase(uint8_t i);
+    int16_t calcOutput(emuSlot_t& s, uint16_t phase);
+    int16_t calcChannel(uint8_t ch);
+    int32_t calcRhythm(void);
+    int16_t calcSample(void);
+};
@@ -0,0 +1,89 @@
+/*
+MD_YM2413 - Library for using a YM2413 sound generator
+
+See header file for copyright and licensing comments.
+*/
+#include <MD_YM2413_EmuBatch.h>
+
+/**
+* \file
+* \brief Implements the multiple software YM2413 renderer methods
+*/
+
+void MD_YM2413_EmuBatch::begin(void)
+{
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    _emu[i].begin();
+    _wait[i] = 0;     // first event is due now
+  }
+  _time = 0;
+}
+
+void MD_YM2413_EmuBatch::renderOne(uint8_t i, int16_t* buf, uint16_t count)
+// Render the samples for one object, stopping at each event when it is due
+{
+  while (count != 0)
+  {
+    uint16_t n;
+
+    if (_wait[i] == 0)
+    {
+      _wait[i] = _cbEvent(i, _emu[i]);
+      if (_wait[i] == 0) _wait[i] = 1;  // always move on
+    }
+
+    n = (_wait[i] < count) ? _wait[i] : count;
+    _emu[i].render(buf, n);
+    buf += n;
+    count -= n;
+    if (_wait[i] != END) _wait[i] -= n;
+  }
+}
+
+void MD_YM2413_EmuBatch::render(int16_t* const* buf, uint16_t count)
+{
+  // Each object is rendered for the whole block in turn, so its state
+  // stays in the cache (or registers) rather than moving between objects
+  // for every sample.
+  for (uint8_t i = 0; i < _count; i++)
+    renderOne(i, buf[i], count);
+  _time += count;
+}
+
+void MD_YM2413_EmuBatch::mix(int16_t* buf, uint16_t count)
+{
+  while (count != 0)
+  {
+    uint16_t n = (count < MIX_BLOCK) ? count : MIX_BLOCK;
+
+    memset(_sum, 0, n * sizeof(_sum[0]));
+    for (uint8_t i = 0; i < _count; i++)
+    {
+      renderOne(i, _tmp, n);
+      for (uint16_t j = 0; j < n; j++)
+        _sum[j] += _tmp[j];
+    }
+
+    for (uint16_t j = 0; j < n; j++)
+    {
+      int32_t v = _sum[j];
+
+      if (v > INT16_MAX) v = INT16_MAX;
+      if (v < INT16_MIN) v = INT16_MIN;
+      *buf++ = v;
+    }
+
+    count -= n;
+    _time += n;
+  }
+}
+
+bool MD_YM2413_EmuBatch::isDone(void)
+{
+  for (uint8_t i = 0; i < _count; i++)
+    if (_wait[i] != END || !_emu[i].isSilent())
+      return(false);
+
+  return(true);
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <Arduino.h>
+#include <MD_YM2413_Emu.h>
+
+/**
+ * \file
+ * \brief Header file for the MD_YM2413_EmuBatch multiple software YM2413 renderer
+ */
+
+/**
+ * Multiple software YM2413 renderer class for the MD_YM2413 library
+ *
+ * Renders a number of MD_YM2413_Emu objects in step with each other. Each
+ * object is fed from its own stream of register writes by an application
+ * callback, so each one plays something different (eg, the two chips in a
+ * dual YM2413 VGM file or a number of short clips).
+ * See \ref pageEmulator for how this is used.
+ */
+class MD_YM2413_EmuBatch
+{
+  public:
+    static const uint8_t BATCH_MAX = 8;     ///< most MD_YM2413_Emu objects in a batch
+    static const uint16_t END = 0xffff;     ///< event callback return value for the end of the stream
+
+   /**
+    * Event callback function prototype.
+    *
+    * The function is called when the next register writes are due for one
+    * of the objects. The function writes the registers due now using the
+    * write() method for the object and returns the number of samples until
+    * the next writes are due, [1..0xfffe], or END if there are no more.
+    *
+    * \param inst  the index of the object in the batch [0..count-1].
+    * \param emu   the object to write to.
+    * \return the samples to the next event or END.
+    */
+    typedef uint16_t (*cbEvent_t)(uint8_t inst, MD_YM2413_Emu& emu);
+
+   /**
+    * Class Constructor.
+    *
+    * Instantiate a new instance of the class. The MD_YM2413_Emu objects
+    * are created by the application.
+    *
+    * \param emu    array of MD_YM2413_Emu objects.
+    * \param count  the number of objects in the array [1..BATCH_MAX].
+    * \param cb     the event callback function.
+    */
+    MD_YM2413_EmuBatch(MD_YM2413_Emu* emu, uint8_t count, cbEvent_t cb) :
+      _emu(emu), _count(count > BATCH_MAX ? BATCH_MAX : count), _cbEvent(cb) {};
+
+   /**
+    * Class Destructor.
+    *
+    * Does the necessary to clean up once the object is no longer required.
+    */
+    ~MD_YM2413_EmuBatch(void) {};
+
+   /**
+    * Initialize the object.
+    *
+    * Reset all the MD_YM2413_Emu objects and start the event streams. The
+    * first event for every object is requested before the first sample is
+    * rendered. This needs to be called during setup() and again to start
+    * new streams.
+    */
+    void begin(void);
+
+   /**
+    * Render a block of samples for each object.
+    *
+    * Work out the next count samples for each object into its own buffer.
+    * The register writes from the event callback are made at the sample
+    * they are due, whatever the block size.
+    *
+    * \param buf    array of buffers, one for each object.
+    * \param count  the number of samples to work out.
+    */
+    void render(int16_t* const* buf, uint16_t count);
+
+   /**
+    * Render a block of mixed samples.
+    *
+    * Work out the next count samples for all the objects and add them
+    * together into the buffer, limited to the 16 bit range.
+    *
+    * \param buf    the buffer for the samples.
+    * \param count  the number of samples to work out.
+    */
+    void mix(int16_t* buf, uint16_t count);
+
+   /**
+    * Get the samples rendered.
+    *
+    * \return the number of samples rendered for each object since begin().
+    */
+    uint32_t getTime(void) { return(_time); }
+
+   /**
+    * Check if the batch has finished.
+    *
+    * \return true if all the event streams have ended and all the objects are silent.
+    */
+    bool isDone(void);
+
+  private:
+    static const uint8_t MIX_BLOCK = 32;    ///< samples mixed at a time
+
+    MD_YM2413_Emu* _emu;          ///< the objects in the batch
+    uint8_t _count;               ///< number of objects
+    cbEvent_t _cbEvent;           ///< event callback
+    uint32_t _time;               ///< samples rendered since begin()
+    uint16_t _wait[BATCH_MAX];    ///< samples to the next event for each object, or END
+
+    int16_t _tmp[MIX_BLOCK];      ///< samples for one object to mix
+    int32_t _sum[MIX_BLOCK];      ///< mixed samples
+
+    void renderOne(uint8_t i, int16_t* buf, uint16_t count);
+};
@@ -0,0 +1,485 @@
+/*
+MD_YM2413 - Library for using a YM2413 sound generator
+
+See header file for copyright and licensing comments.
+*/
+#include <MD_YM2413_MIDI.h>
+#include <MD_YM2413_lib.h>
+
+/**
+* \file
+* \brief Implements the MIDI synthesizer methods
+*/
+
+// Global data tables
+// Default MIDI program to YM2413 instrument map. Programs are 
+// numbered from 0, so add 1 to agree with published lists.
+// All undefined after the end of this table.
+const uint8_t PROGMEM MD_YM2413_MIDI::_defIMap[] =
+{
+  // 1-8 Piano
+  MD_YM2413::I_PIANO, MD_YM2413::I_PIANO, MD_YM2413::I_PIANO, MD_YM2413::I_PIANO, 
+  MD_YM2413::I_PIANO, MD_YM2413::I_PIANO, MD_YM2413::I_HARPSICHORD, MD_YM2413::I_HARPSICHORD, 
+  // 9-16 Chrom Percussion
+  MD_YM2413::I_VIBRAPHONE, MD_YM2413::I_VIBRAPHONE, MD_YM2413::I_VIBRAPHONE, MD_YM2413::I_VIBRAPHONE, 
+  MD_YM2413::I_VIBRAPHONE, MD_YM2413::I_VIBRAPHONE, MD_YM2413::I_VIBRAPHONE, MD_YM2413::I_VIBRAPHONE, 
+  // 17-24 Organ
+  MD_YM2413::I_ORGAN, MD_YM2413::I_ORGAN, MD_YM2413::I_ORGAN, MD_YM2413::I_ORGAN, 
+  MD_YM2413::I_ORGAN, MD_YM2413::I_ORGAN, MD_YM2413::I_ORGAN, MD_YM2413::I_ORGAN, 
+  // 25-32 Guitar
+  MD_YM2413::I_GUITAR, MD_YM2413::I_GUITAR, MD_YM2413::I_EGUITAR, MD_YM2413::I_EGUITAR, 
+  MD_YM2413::I_EGUITAR, MD_YM2413::I_EGUITAR, MD_YM2413::I_EGUITAR, MD_YM2413::I_EGUITAR, 
+  // 33-40 Bass
+  MD_YM2413::I_ACOUSTIC_BASS, MD_YM2413::I_ACOUSTIC_BASS, MD_YM2413::I_ACOUSTIC_BASS, MD_YM2413::I_ACOUSTIC_BASS,
+  MD_YM2413::I_SYNTH_BASS, MD_YM2413::I_SYNTH_BASS, MD_YM2413::I_SYNTH_BASS, MD_YM2413::I_SYNTH_BASS, 
+  // 41-48 Strings
+  MD_YM2413::I_VIOLIN, MD_YM2413::I_VIOLIN, MD_YM2413::I_VIOLIN, MD_YM2413::I_ACOUSTIC_BASS, 
+  MD_YM2413::I_VIOLIN, MD_YM2413::I_VIOLIN, MD_YM2413::I_VIOLIN, MD_YM2413::I_HARPSICHORD,
+  // 49-56 Ensemble
+  MD_YM2413::I_VIOLIN, MD_YM2413::I_VIOLIN, MD_YM2413::I_VIOLIN, MD_YM2413::I_VIOLIN, 
+  MD_YM2413::I_ORGAN, MD_YM2413::I_ORGAN, MD_YM2413::I_SYNTH, MD_YM2413::I_SYNTH, 
+  // 57-64 Brass
+   MD_YM2413::I_TRUMPET, MD_YM2413::I_TRUMPET, MD_YM2413::I_HORN, MD_YM2413::I_TRUMPET, 
+   MD_YM2413::I_HORN, MD_YM2413::I_TRUMPET, MD_YM2413::I_SYNTH, MD_YM2413::I_SYNTH, 
+  // 65-72 Reed
+  MD_YM2413::I_CLARINET, MD_YM2413::I_CLARINET, MD_YM2413::I_CLARINET, MD_YM2413::I_CLARINET,
+  MD_YM2413::I_OBOE, MD_YM2413::I_HORN, MD_YM2413::I_HORN, MD_YM2413::I_CLARINET, 
+  // 73-80 Pipe
+  MD_YM2413::I_FLUTE, MD_YM2413::I_FLUTE, MD_YM2413::I_FLUTE, MD_YM2413::I_FLUTE, 
+  MD_YM2413::I_FLUTE, MD_YM2413::I_FLUTE, MD_YM2413::I_FLUTE, MD_YM2413::I_FLUTE,
+  // 81-88 Synth Lead
+  MD_YM2413::I_SYNTH, MD_YM2413::I_SYNTH, MD_YM2413::I_SYNTH, MD_YM2413::I_SYNTH, 
+  MD_YM2413::I_SYNTH, MD_YM2413::I_SYNTH, MD_YM2413::I_SYNTH, MD_YM2413::I_SYNTH,
+};
+
+// Default MIDI percussion note to YM2413 percussion map.
+// This table starts mapping at DEF_PMAP_BASE (ie index + 35 is the 
+// MIDI note number). All undefined after the end of this table.
+const uint8_t MD_YM2413_MIDI::DEF_PMAP_BASE = 35;
+const uint8_t PROGMEM MD_YM2413_MIDI::_defPMap[] =
+{
+  MD_YM2413::P_BASS_DRUM, MD_YM2413::P_BASS_DRUM, MD_YM2413::I_UNDEFINED, // 35-37
+  MD_YM2413::P_SNARE_DRUM, MD_YM2413::I_UNDEFINED, MD_YM2413::P_SNARE_DRUM, // 38-40
+  MD_YM2413::P_TOM_TOM, MD_YM2413::P_HI_HAT, MD_YM2413::P_TOM_TOM, // 41-43
+  MD_YM2413::P_HI_HAT, MD_YM2413::P_TOM_TOM, MD_YM2413::P_HI_HAT, // 44-46
+  MD_YM2413::P_TOM_TOM, MD_YM2413::P_TOM_TOM, MD_YM2413::P_TOP_CYMBAL, // 47-49
+  MD_YM2413::P_TOM_TOM, MD_YM2413::P_TOP_CYMBAL, MD_YM2413::P_TOP_CYMBAL, // 50-52
+  MD_YM2413::I_UNDEFINED, MD_YM2413::I_UNDEFINED, MD_YM2413::P_TOP_CYMBAL, // 53-55
+  MD_YM2413::I_UNDEFINED, MD_YM2413::P_TOP_CYMBAL, MD_YM2413::I_UNDEFINED, // 56-58
+  MD_YM2413::P_TOP_CYMBAL, MD_YM2413::P_TOM_TOM, MD_YM2413::P_TOM_TOM, // 59-61
+};
+
+// Attenuation curves for MIDI values [0..127] in 0.75dB units.
+// The YM2413 volume has 3dB steps, so 4 units per step.
+// Value 0 is always full attenuation.
+// Linear amplitude: 20*log10(v/127) dB
+const uint8_t PROGMEM MD_YM2413_MIDI::_curveLinear[] =
+{
+  255,  56,  48,  43,  40,  37,  35,  34,  32,  31,  29,  28,  27,  26,  26,  25,  // 0-15
+   24,  23,  23,  22,  21,  21,  20,  20,  19,  19,  18,  18,  18,  17,  17,  16,  // 16-31
+   16,  16,  15,  15,  15,  14,  14,  14,  13,  13,  13,  13,  12,  12,  12,  12,  // 32-47
+   11,  11,  11,  11,  10,  10,  10,  10,   9,   9,   9,   9,   9,   8,   8,   8,  // 48-63
+    8,   8,   8,   7,   7,   7,   7,   7,   7,   6,   6,   6,   6,   6,   6,   5,  // 64-79
+    5,   5,   5,   5,   5,   5,   5,   4,   4,   4,   4,   4,   4,   4,   3,   3,  // 80-95
+    3,   3,   3,   3,   3,   3,   3,   2,   2,   2,   2,   2,   2,   2,   2,   2,  // 96-111
+    1,   1,   1,   1,   1,   1,   1,   1,   1,   1,   0,   0,   0,   0,   0,   0,  // 112-127
+};
+
+// General MIDI recommended: 40*log10(v/127) dB
+const uint8_t PROGMEM MD_YM2413_MIDI::_curveGM[] =
+{
+  255, 112,  96,  87,  80,  75,  71,  67,  64,  61,  59,  57,  55,  53,  51,  49,  // 0-15
+   48,  47,  45,  44,  43,  42,  41,  40,  39,  38,  37,  36,  35,  34,  33,  33,  // 16-31
+   32,  31,  31,  30,  29,  29,  28,  27,  27,  26,  26,  25,  25,  24,  24,  23,  // 32-47
+   23,  22,  22,  21,  21,  20,  20,  19,  19,  19,  18,  18,  17,  17,  17,  16,  // 48-63
+   16,  16,  15,  15,  14,  14,  14,  13,  13,  13,  13,  12,  12,  12,  11,  11,  // 64-79
+   11,  10,  10,  10,  10,   9,   9,   9,   8,   8,   8,   8,   7,   7,   7,   7,  // 80-95
+    6,   6,   6,   6,   6,   5,   5,   5,   5,   4,   4,   4,   4,   4,   3,   3,  // 96-111
+    3,   3,   3,   2,   2,   2,   2,   2,   1,   1,   1,   1,   1,   0,   0,   0,  // 112-127
+};
+
+// Class methods
+MD_YM2413_MIDI::MD_YM2413_MIDI(MD_YM2413& ym) : _S(ym)
+{
+  setInstrumentMap(nullptr, 0);
+  setPercussionMap(nullptr, 0, 0);
+  _curveVel = _curveCtl = _curveGM;
+}
+
+const uint8_t* MD_YM2413_MIDI::curveTable(curve_t c, const uint8_t* custom)
+{
+  switch (c)
+  {
+  case CURVE_LINEAR: return(_curveLinear);
+  case CURVE_CUSTOM: if (custom != nullptr) return(custom); break;
+  default: break;
+  }
+
+  return(_curveGM);
+}
+
+void MD_YM2413_MIDI::setControllerCurve(curve_t c, const uint8_t* custom)
+{
+  _curveCtl = curveTable(c, custom);
+  for (uint8_t i = 0; i < MIDI_CHANNELS; i++)
+    updateVolume(i);
+}
+
+void MD_YM2413_MIDI::setInstrumentMap(const uint8_t* map, uint8_t size)
+{
+  if (map == nullptr)
+  {
+    _iMap = _defIMap;
+    _iMapSize = ARRAY_SIZE(_defIMap);
+  }
+  else
+  {
+    _iMap = map;
+    _iMapSize = size;
+  }
+}
+
+void MD_YM2413_MIDI::setPercussionMap(const uint8_t* map, uint8_t base, uint8_t size)
+{
+  if (map == nullptr)
+  {
+    _pMap = _defPMap;
+    _pMapBase = DEF_PMAP_BASE;
+    _pMapSize = ARRAY_SIZE(_defPMap);
+  }
+  else
+  {
+    _pMap = map;
+    _pMapBase = base;
+    _pMapSize = size;
+  }
+}
+
+void MD_YM2413_MIDI::reset(void)
+{
+  // turn off anything still playing
+  for (uint8_t v = 0; v < VOICES; v++)
+  {
+    if (v < _S.countChannels() && !_S.isIdle(v))
+      _S.noteOff(v);
+    _V[v].chan = CH_FREE;
+    _V[v].held = false;
+    _V[v].age = 0;
+  }
+
+  for (uint8_t i = 0; i < MIDI_CHANNELS; i++)
+  {
+    _M[i].instr = MD_YM2413::I_UNDEFINED;
+    _M[i].vol = MIDI_VOL_DEFAULT;
+    _M[i].expr = MIDI_EXPR_DEFAULT;
+    _M[i].pedal = false;
+    _M[i].bend = 0;
+    updateVolume(i);
+  }
+
+#if MIDI_NOTE_MAP
+  memset(_noteMap, 0xff, sizeof(_noteMap));
+#endif
+  _age = 0;
+  _dropped = 0;
+}
+
+void MD_YM2413_MIDI::setNoteMap(uint8_t chan, uint8_t note, uint8_t v)
+// Remember the voice for this note, CH_FREE to clear it.
+// Voices are stored in nibbles, with 0xf as the free value.
+{
+#if MIDI_NOTE_MAP
+  uint16_t idx = (chan * MIDI_NOTES) + note;
+  uint8_t* p = &_noteMap[idx >> 1];
+
+  if (idx & 1)
+    *p = (*p & 0x0f) | (v << 4);
+  else
+    *p = (*p & 0xf0) | (v & 0x0f);
+#else
+  (void)chan; (void)note; (void)v;
+#endif
+}
+
+uint8_t MD_YM2413_MIDI::findVoice(uint8_t chan, uint8_t note)
+// Return the voice playing this note or CH_FREE if none
+{
+#if MIDI_NOTE_MAP
+  uint16_t idx = (chan * MIDI_NOTES) + note;
+  uint8_t v = _noteMap[idx >> 1];
+
+  v = (idx & 1) ? (v >> 4) : (v & 0x0f);
+  if (v < VOICES && _V[v].chan == chan && _V[v].note == note)
+    return(v);
+#else
+  for (uint8_t v = 0; v < VOICES; v++)
+    if (_V[v].chan == chan && _V[v].note == note)
+      return(v);
+#endif
+
+  return(CH_FREE);
+}
+
+uint8_t MD_YM2413_MIDI::allocVoice(uint8_t instr)
+// Find a free melodic voice. Prefer one already set to the instrument,
+// as this saves changing it, otherwise the least recently used so that
+// any note still in the release phase has the longest time to finish.
+{
+#if CHANNEL_MODE == CHANNEL_MODE_RHYTHM
+  uint8_t count = 0;    // no melodic channels in this build
+#else
+  uint8_t count = _S.isPercussion() ? MD_YM2413::PERC_CHAN_BASE : _S.countChannels();
+#endif
+  uint8_t v = CH_FREE;
+  uint8_t oldest = 0;
+
+  for (uint8_t i = 0; i < count; i++)
+  {
+    if (_V[i].chan != CH_FREE)
+      continue;
+
+    if (instr != MD_YM2413::I_UNDEFINED && _S.getInstrument(i) == instr)
+      return(i);
+
+    if (v == CH_FREE || (uint8_t)(_age - _V[i].age) > oldest)
+    {
+      v = i;
+      oldest = _age - _V[i].age;
+    }
+  }
+
+  return(v);
+}
+
+uint8_t MD_YM2413_MIDI::percVoice(uint8_t note)
+// Return the percussion voice for the MIDI note or CH_FREE if none
+{
+  uint8_t instr;
+
+  if (!_S.isPercussion() || note < _pMapBase || note - _pMapBase >= _pMapSize)
+    return(CH_FREE);
+
+  instr = pgm_read_byte(_pMap + note - _pMapBase);
+  if (instr < MD_YM2413::P_HI_HAT || instr > MD_YM2413::P_BASS_DRUM)
+    return(CH_FREE);
+
+  // percussion instruments are in the same order as their channels
+  return(MD_YM2413::PERC_CHAN_BASE + instr - MD_YM2413::P_HI_HAT);
+}
+
+uint8_t MD_YM2413_MIDI::calcVolume(uint8_t v)
+// Combine the velocity and cached channel attenuation into the 
+// device volume, rounded to the nearest 3dB (4 unit) step
+{
+  uint16_t atten = _V[v].velAtten + _M[_V[v].chan].atten;
+
+  atten = (atten + 2) >> 2;
+  if (atten > MD_YM2413::VOL_MAX) atten = MD_YM2413::VOL_MAX;
+
+  return(MD_YM2413::VOL_MAX - atten);
+}
+
+void MD_YM2413_MIDI::updateVolume(uint8_t chan)
+// Recalculate the cached channel attenuation and rewrite the 
+// volume for voices on this channel, only if changed
+{
+  uint16_t atten = pgm_read_byte(_curveCtl + _M[chan].vol) + pgm_read_byte(_curveCtl + _M[chan].expr);
+
+  _M[chan].atten = (atten > 0xff ? 0xff : atten);
+
+  for (uint8_t v = 0; v < VOICES; v++)
+    if (_V[v].chan == chan)
+    {
+      uint8_t vol = calcVolume(v);
+
+      if (vol != _S.getVolume(v))
+        _S.setVolume(v, vol);
+    }
+}
+
+void MD_YM2413_MIDI::releaseVoice(uint8_t v)
+{
+  _S.noteOff(v);
+  setNoteMap(_V[v].chan, _V[v].note, CH_FREE);
+  _V[v].chan = CH_FREE;
+  _V[v].held = false;
+}
+
+void MD_YM2413_MIDI::noteOn(uint8_t chan, uint8_t note, uint8_t vel)
+{
+  uint8_t v, vol;
+  midiChannel_t* pm;
+
+  if (vel == 0)
+  {
+    noteOff(chan, note);
+    return;
+  }
+  if (chan >= MIDI_CHANNELS || note >= MIDI_NOTES)
+    return;
+
+  pm = &_M[chan];
+
+  // the same note on the same channel is retriggered
+  v = findVoice(chan, note);
+  if (v != CH_FREE)
+    releaseVoice(v);
+
+  if (chan == MIDI_PERC_CHANNEL)
+  {
+    v = percVoice(note);
+    if (v == CH_FREE)
+      return;                   // no YM2413 percussion for this
+    if (_V[v].chan != CH_FREE)  // percussion must key off to retrigger
+      releaseVoice(v);
+  }
+  else
+  {
+    v = allocVoice(pm->instr);
+    if (v == CH_FREE)
+    {
+      TRACE(EV_MIDI_DROP, chan, note);
+      _dropped++;
+#if LIB_STATS
+      _S.countNoteDrop();
+#endif
+      return; // not much we can do except skip this note
+    }
+  }
+
+  _V[v].chan = chan;
+  _V[v].note = note;
+  _V[v].velAtten = pgm_read_byte(_curveVel + (vel & 0x7f));
+  _V[v].held = false;
+  _V[v].age = _age++;
+  setNoteMap(chan, note, v);
+  vol = calcVolume(v);
+
+  TRACE(EV_MIDI_NOTE, chan, (note << 8) | v);
+
+  if (chan == MIDI_PERC_CHANNEL)
+    _S.noteOn(v, MD_YM2413::MIN_OCTAVE, 0, vol);
+  else
+  {
+    int8_t octave = (note / 12) - 1;   // MIDI note 60 is C4 (middle C)
+
+    // lazy program change - only when the channel is keyed
+    if (pm->instr != MD_YM2413::I_UNDEFINED && pm->instr != _S.getInstrument(v))
+      _S.setInstrument(v, (MD_YM2413::instrument_t)pm->instr, vol);
+
+    // notes outside the playable octaves are moved into range
+    if (octave < MD_YM2413::MIN_OCTAVE) octave = MD_YM2413::MIN_OCTAVE;
+    if (octave > MD_YM2413::MAX_OCTAVE) octave = MD_YM2413::MAX_OCTAVE;
+    _S.noteOn(v, octave, note % 12, vol);
+    if (pm->bend != 0)
+      _S.bendNote(v, pm->bend);
+  }
+}
+
+void MD_YM2413_MIDI::noteOff(uint8_t chan, uint8_t note)
+{
+  uint8_t v;
+
+  if (chan >= MIDI_CHANNELS || note >= MIDI_NOTES)
+    return;
+
+  v = findVoice(chan, note);
+  if (v == CH_FREE)
+    return;
+
+  if (_M[chan].pedal)
+    _V[v].held = true;
+  else
+    releaseVoice(v);
+}
+
+void MD_YM2413_MIDI::allNotesOff(uint8_t chan)
+{
+  for (uint8_t v = 0; v < VOICES; v++)
+    if (_V[v].chan == chan)
+      releaseVoice(v);
+}
+
+void MD_YM2413_MIDI::programChange(uint8_t chan, uint8_t program)
+// Only remember the instrument, it is set when the next note is played
+{
+  if (chan >= MIDI_CHANNELS || chan == MIDI_PERC_CHANNEL)
+    return;
+
+  if (program < _iMapSize)
+    _M[chan].instr = pgm_read_byte(_iMap + program);
+  else
+    _M[chan].instr = MD_YM2413::I_UNDEFINED;
+}
+
+void MD_YM2413_MIDI::controlChange(uint8_t chan, uint8_t ctl, uint8_t value)
+{
+  if (chan >= MIDI_CHANNELS)
+    return;
+
+  switch (ctl)
+  {
+  case 7:     // channel volume
+    _M[chan].vol = value & 0x7f;
+    updateVolume(chan);
+    break;
+
+  case 11:    // expression
+    _M[chan].expr = value & 0x7f;
+    updateVolume(chan);
+    break;
+
+  case 64:    // sustain pedal
+    _M[chan].pedal = (value >= 64);
+    if (!_M[chan].pedal)    // release the held notes
+    {
+      for (uint8_t v = 0; v < VOICES; v++)
+        if (_V[v].chan == chan && _V[v].held)
+          releaseVoice(v);
+    }
+    break;
+
+  case 121:   // reset all controllers
+    _M[chan].expr = MIDI_EXPR_DEFAULT;
+    updateVolume(chan);
+    controlChange(chan, 64, 0);
+    pitchBend(chan, 0x2000);
+    break;
+
+  case 120:   // all sound off
+  case 123:   // all notes off
+    allNotesOff(chan);
+    break;
+
+  default:
+    break;
+  }
+}
+
+void MD_YM2413_MIDI::pitchBend(uint8_t chan, uint16_t bend)
+{
+  if (chan >= MIDI_CHANNELS || chan == MIDI_PERC_CHANNEL)
+    return;
+
+  // convert 14 bit bend into 1/256 semitones (256/8192 = 1/32)
+  _M[chan].bend = ((int32_t)bend - 0x2000) * PITCHBEND_RANGE / 32;
+
+  for (uint8_t v = 0; v < VOICES; v++)
+    if (_V[v].chan == chan)
+      _S.bendNote(v, _M[chan].bend);
+}
+
+void MD_YM2413_MIDI::process(uint8_t status, uint8_t data1, uint8_t data2)
+{
+  uint8_t chan = status & 0x0f;
+
+  switch (status & 0xf0)
+  {
+  case 0x80: noteOff(chan, data1); break;
+  case 0x90: noteOn(chan, data1, data2); break;
+  case 0xb0: controlChange(chan, data1, data2); break;
+  case 0xc0: programChange(chan, data1); break;
+  case 0xe0: pitchBend(chan, (data2 << 7) | data1); break;
+  default: break;   // everything else is ignored
+  }
+}
@@ -0,0 +1,299 @@
+#pragma once
+
+#include <Arduino.h>
+#include <MD_YM2413.h>
+
+/**
+ * \file
+ * \brief Header file for the MD_YM2413_MIDI synthesizer
+ */
+
+#ifndef MIDI_NOTE_MAP
+#if defined(RAMEND) && (RAMEND <= 0x8ff)  // 2k RAM or less
+#define MIDI_NOTE_MAP 0   ///< Set to 1 to use the note lookup table. See \ref pageCompileSwitch
+#else
+#define MIDI_NOTE_MAP 1   ///< Set to 1 to use the note lookup table. See \ref pageCompileSwitch
+#endif
+#endif
+
+/**
+ * MIDI synthesizer class for the MD_YM2413 library
+ *
+ * Plays MIDI channel messages on a YM2413 through a MD_YM2413 object.
+ * See \ref pageMIDI for how this is used.
+ */
+class MD_YM2413_MIDI
+{
+  public:
+    static const uint8_t MIDI_CHANNELS = 16;    ///< Number of MIDI channels
+    static const uint8_t MIDI_NOTES = 128;      ///< Number of MIDI note numbers
+    static const uint8_t MIDI_PERC_CHANNEL = 9; ///< MIDI percussion channel 10 as zero based channel
+
+    static const uint8_t MIDI_VOL_DEFAULT = 100;    ///< Default CC7 channel volume
+    static const uint8_t MIDI_EXPR_DEFAULT = 127;   ///< Default CC11 channel expression
+    static const uint8_t PITCHBEND_RANGE = 2;       ///< Pitch bend +/- range in semitones
+
+   /**
+    * Attenuation curves
+    *
+    * Curves used to convert MIDI velocity, volume and expression values 
+    * into attenuation. Curve tables have 128 entries, one for each MIDI value,
+    * of the attenuation in 0.75dB units (1/4 of a YM2413 volume step). 
+    * Attenuations from all the curves are added and rounded to the nearest 
+    * YM2413 3dB volume step.
+    */
+    typedef enum
+    {
+      CURVE_LINEAR,   ///< amplitude proportional to value, 20*log10(v/127) dB
+      CURVE_GM,       ///< General MIDI recommended, 40*log10(v/127) dB
+      CURVE_CUSTOM,   ///< application defined table
+    } curve_t;
+
+   /**
+    * Class Constructor.
+    *
+    * Instantiate a new instance of the class.
+    *
+    * \param ym  the MD_YM2413 object used to play the notes.
+    */
+    MD_YM2413_MIDI(MD_YM2413& ym);
+
+   /**
+    * Class Destructor.
+    *
+    * Does the necessary to clean up once the object is no longer required.
+    */
+    ~MD_YM2413_MIDI(void) {};
+
+   /**
+    * Initialize the object.
+    *
+    * Initialize the object data. This needs to be called during setup(), after
+    * the begin() for the MD_YM2413 object. Percussion notes are only played if
+    * percussion is enabled in the MD_YM2413 object.
+    */
+    void begin(void) { reset(); }
+
+   /**
+    * Reset the synthesizer.
+    *
+    * Turn off all the notes and set all the channel controllers and programs
+    * to their default values.
+    */
+    void reset(void);
+
+   //--------------------------------------------------------------
+   /** \name MIDI Messages.
+    * @{
+    */
+   /**
+    * Process a MIDI channel message.
+    *
+    * Decode a MIDI channel message and invoke the relevant method. Unused
+    * data bytes are ignored. System messages are ignored.
+    *
+    * \param status  the message status byte including the channel.
+    * \param data1   the first data byte.
+    * \param data2   the second data byte.
+    */
+    void process(uint8_t status, uint8_t data1, uint8_t data2);
+
+   /**
+    * Note On message.
+    *
+    * Play the note on the first available YM2413 channel. A velocity of
+    * 0 is treated as a note off.
+    *
+    * \param chan  MIDI channel [0..15].
+    * \param note  MIDI note number [0..127].
+    * \param vel   note velocity [0..127].
+    */
+    void noteOn(uint8_t chan, uint8_t note, uint8_t vel);
+
+   /**
+    * Note Off message.
+    *
+    * Stop playing the note. If the sustain pedal is on for the channel
+    * the note is held until the pedal is released.
+    *
+    * \param chan  MIDI channel [0..15].
+    * \param note  MIDI note number [0..127].
+    */
+    void noteOff(uint8_t chan, uint8_t note);
+
+   /**
+    * Program Change message.
+    *
+    * Set the instrument for the channel from the instrument map. The
+    * YM2413 instrument is only changed when a note is next played on a
+    * YM2413 channel that is set to a different instrument.
+    *
+    * \param chan     MIDI channel [0..15].
+    * \param program  MIDI program number [0..127].
+    */
+    void programChange(uint8_t chan, uint8_t program);
+
+   /**
+    * Control Change message.
+    *
+    * Process the controller change. The controllers processed are
+    * 7 (volume), 11 (expression), 64 (sustain pedal), 120 (all sound off),
+    * 121 (reset all controllers) and 123 (all notes off).
+    * All other controllers are ignored.
+    *
+    * \param chan   MIDI channel [0..15].
+    * \param ctl    controller number [0..127].
+    * \param value  controller value [0..127].
+    */
+    void controlChange(uint8_t chan, uint8_t ctl, uint8_t value);
+
+   /**
+    * Pitch Bend message.
+    *
+    * Bend all the notes playing on the channel by up to PITCHBEND_RANGE
+    * semitones.
+    *
+    * \param chan  MIDI channel [0..15].
+    * \param bend  14 bit pitch bend value, 0x2000 is no bend.
+    */
+    void pitchBend(uint8_t chan, uint16_t bend);
+
+   /**
+    * Turn off all notes on a channel.
+    *
+    * \param chan  MIDI channel [0..15].
+    */
+    void allNotesOff(uint8_t chan);
+
+   /** @} */
+
+   //--------------------------------------------------------------
+   /** \name Configuration and Status.
+    * @{
+    */
+   /**
+    * Set the program to instrument map.
+    *
+    * The map is an array of instrument_t values in PROGMEM, one for each MIDI
+    * program number starting at 0. Programs past the end of the map or set to
+    * I_UNDEFINED are played using the current YM2413 channel instrument.
+    * A map for an OPL2 instrument bank can be generated by the script
+    * extras/YM2413_PatchMap.py (see \ref pageCustom).
+    *
+    * \param map   pointer to the PROGMEM map, nullptr for the library default.
+    * \param size  number of entries in the map.
+    */
+    void setInstrumentMap(const uint8_t* map, uint8_t size);
+
+   /**
+    * Set the percussion note map.
+    *
+    * The map is an array of P_* instrument_t values in PROGMEM, one for each
+    * MIDI note on the percussion channel starting from the base note number.
+    * Notes outside the map or set to I_UNDEFINED are not played.
+    *
+    * \param map   pointer to the PROGMEM map, nullptr for the library default.
+    * \param base  MIDI note number for the first entry in the map.
+    * \param size  number of entries in the map.
+    */
+    void setPercussionMap(const uint8_t* map, uint8_t base, uint8_t size);
+
+   /**
+    * Set the velocity curve.
+    *
+    * Set the curve used to convert the note on velocity into attenuation.
+    * The default is CURVE_GM. The new curve is used for the next note on.
+    *
+    * \sa curve_t
+    *
+    * \param c       the curve to use.
+    * \param custom  PROGMEM table with 128 entries for CURVE_CUSTOM, ignored otherwise.
+    */
+    void setVelocityCurve(curve_t c, const uint8_t* custom = nullptr) { _curveVel = curveTable(c, custom); }
+
+   /**
+    * Set the controller curve.
+    *
+    * Set the curve used to convert the volume (CC7) and expression (CC11) 
+    * controllers into attenuation. The default is CURVE_GM. Notes already 
+    * playing are updated if their volume changes.
+    *
+    * \sa curve_t
+    *
+    * \param c       the curve to use.
+    * \param custom  PROGMEM table with 128 entries for CURVE_CUSTOM, ignored otherwise.
+    */
+    void setControllerCurve(curve_t c, const uint8_t* custom = nullptr);
+
+   /**
+    * Get the dropped note count.
+    *
+    * Notes are dropped when there is no YM2413 channel available to play
+    * them. The count is reset by reset().
+    *
+    * \return the number of notes dropped.
+    */
+    uint16_t getDropped(void) { return(_dropped); }
+
+   /** @} */
+
+  private:
+    static const uint8_t CH_FREE = 0xff;    ///< voice not allocated to a MIDI channel
+    static const uint8_t VOICES = 11;       ///< maximum YM2413 channels
+
+    // Per MIDI channel data
+    struct midiChannel_t
+    {
+      uint8_t instr;      ///< YM2413 instrument for the current program
+      uint8_t vol;        ///< CC7 volume
+      uint8_t expr;       ///< CC11 expression
+      uint8_t atten;      ///< cached volume and expression attenuation in curve units
+      bool pedal;         ///< CC64 sustain pedal on
+      int16_t bend;       ///< current pitch bend in 1/256 semitone
+    };
+
+    // Per YM2413 channel (voice) data
+    struct midiVoice_t
+    {
+      uint8_t chan;       ///< MIDI channel playing on this voice, CH_FREE if none
+      uint8_t note;       ///< MIDI note playing on this voice
+      uint8_t velAtten;   ///< note velocity attenuation in curve units
+      bool held;          ///< note off received but held by the sustain pedal
+      uint8_t age;        ///< allocation sequence for least recently used
+    };
+
+    MD_YM2413& _S;                          ///< the YM2413 device
+    midiChannel_t _M[MIDI_CHANNELS];        ///< MIDI channel data
+    midiVoice_t _V[VOICES];                 ///< YM2413 voice data
+    uint8_t _age;                           ///< running voice allocation sequence
+    uint16_t _dropped;                      ///< count of notes dropped
+#if MIDI_NOTE_MAP
+    uint8_t _noteMap[MIDI_CHANNELS * MIDI_NOTES / 2];  ///< voice for each channel/note, packed in nibbles
+#endif
+
+    const uint8_t* _curveVel;   ///< velocity attenuation curve table
+    const uint8_t* _curveCtl;   ///< controller attenuation curve table
+
+    const uint8_t* _iMap;   ///< program to instrument map
+    uint8_t _iMapSize;      ///< number of entries in _iMap
+    const uint8_t* _pMap;   ///< percussion note to instrument map
+    uint8_t _pMapBase;      ///< first note number in _pMap
+    uint8_t _pMapSize;      ///< number of entries in _pMap
+
+    // Default maps
+    static const uint8_t _defIMap[];
+    static const uint8_t _defPMap[];
+    static const uint8_t DEF_PMAP_BASE;
+    static const uint8_t _curveLinear[];
+    static const uint8_t _curveGM[];
+
+    // Methods
+    uint8_t findVoice(uint8_t chan, uint8_t note);
+    uint8_t allocVoice(uint8_t instr);
+    uint8_t percVoice(uint8_t note);
+    void setNoteMap(uint8_t chan, uint8_t note, uint8_t v);
+    void releaseVoice(uint8_t v);
+    const uint8_t* curveTable(curve_t c, const uint8_t* custom);
+    uint8_t calcVolume(uint8_t v);
+    void updateVolume(uint8_t chan);
+};
@@ -0,0 +1,116 @@
+/*
+MD_YM2413 - Library for using a YM2413 sound generator
+
+See header file for copyright and licensing comments.
+*/
+#include <MD_YM2413_MIDIIn.h>
+#include <MD_YM2413_lib.h>
+
+/**
+* \file
+* \brief Implements the live MIDI input methods
+*/
+
+// Stop the compiler moving memory accesses across this point, so that 
+// a queue slot is complete before the index that publishes it changes.
+#define MEMORY_BARRIER() __asm__ __volatile__("" ::: "memory")
+
+void MD_YM2413_MIDIIn::begin(void)
+{
+  _head = _tail = 0;
+  _status = 0;
+  _count = 0;
+  _sysEx = false;
+  resetStats();
+}
+
+void MD_YM2413_MIDIIn::resetStats(void)
+{
+  _overflow = 0;
+  _latencyMax = 0;
+  _latencySum = 0;
+  _latencyCount = 0;
+}
+
+void MD_YM2413_MIDIIn::receive(uint8_t b)
+{
+  uint8_t len;
+
+  if (b >= 0xf8)          // real time, can be anywhere and changes nothing
+    return;
+
+  if (b & 0x80)           // status byte
+  {
+    _sysEx = (b == 0xf0);
+    _status = (b < 0xf0) ? b : 0;   // system messages cancel running status
+    _count = 0;
+    return;
+  }
+
+  // this is a data byte
+  if (_sysEx || _status == 0)
+    return;
+
+  _data[_count++] = b;
+  len = ((_status & 0xe0) == 0xc0) ? 1 : 2; // program change and channel pressure have 1 byte
+  if (_count >= len)
+  {
+    if (len == 1) _data[1] = 0;
+    queue();
+    _count = 0;           // running status is kept for the next message
+  }
+}
+
+void MD_YM2413_MIDIIn::queue(void)
+// Add the current message to the queue
+{
+  uint8_t next = (_head + 1) & (QUEUE_SIZE - 1);
+  midiEvent_t* pe = &_Q[_head];
+
+  if (next == _tail)      // full, this one is lost
+  {
+    _overflow++;
+    return;
+  }
+
+  pe->status = _status;
+  pe->data1 = _data[0];
+  pe->data2 = _data[1];
+  pe->time = micros();
+  MEMORY_BARRIER();
+  _head = next;
+}
+
+uint8_t MD_YM2413_MIDIIn::run(void)
+{
+  uint8_t n = 0;
+
+  while (_tail != _head)
+  {
+    midiEvent_t* pe = &_Q[_tail];
+
+    MEMORY_BARRIER();
+    _M.process(pe->status, pe->data1, pe->data2);
+
+    // note on latency statistics
+    if ((pe->status & 0xf0) == 0x90 && pe->data2 != 0)
+    {
+      uint32_t t = micros() - pe->time;
+
+      if (t > _latencyMax) _latencyMax = t;
+      if (_latencyCount == 0xffff)   // keep the average without overflow
+      {
+        _latencySum >>= 1;
+        _latencyCount >>= 1;
+      }
+      _latencySum += t;
+      _latencyCount++;
+    }
+
+    MEMORY_BARRIER();
+    _tail = (_tail + 1) & (QUEUE_SIZE - 1);
+    n++;
+  }
+
+  return(n);
+}
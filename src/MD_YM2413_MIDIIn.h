@@ -0,0 +1,145 @@
+#pragma once
+
+#include <Arduino.h>
+#include <MD_YM2413_MIDI.h>
+
+/**
+ * \file
+ * \brief Header file for the MD_YM2413_MIDIIn live MIDI input
+ */
+
+/**
+ * Live MIDI input class for the MD_YM2413 library
+ *
+ * Parses a MIDI byte stream into channel messages that are queued for
+ * a MD_YM2413_MIDI synthesizer. See \ref pageMIDIIn for how this is used.
+ */
+class MD_YM2413_MIDIIn
+{
+  public:
+    static const uint8_t QUEUE_SIZE = 16;   ///< Event queue size, must be a power of 2
+
+   /**
+    * Class Constructor.
+    *
+    * Instantiate a new instance of the class.
+    *
+    * \param synth  the MD_YM2413_MIDI object that plays the messages.
+    */
+    MD_YM2413_MIDIIn(MD_YM2413_MIDI& synth) : _M(synth) {};
+
+   /**
+    * Class Destructor.
+    *
+    * Does the necessary to clean up once the object is no longer required.
+    */
+    ~MD_YM2413_MIDIIn(void) {};
+
+   /**
+    * Initialize the object.
+    *
+    * Initialize the object data. This needs to be called during setup(),
+    * before any bytes are received.
+    */
+    void begin(void);
+
+   /**
+    * Receive a MIDI byte.
+    *
+    * Parse the next byte from the MIDI stream. Completed channel messages
+    * are queued for run(), time stamped with the time the byte was received.
+    * Running status, real time bytes in the middle of a message and
+    * System Exclusive messages are handled. Real time and system messages
+    * are not queued.
+    *
+    * This method is the only producer for the queue and is safe to call
+    * from an interrupt service routine (eg, the UART receive interrupt).
+    *
+    * \param b  the byte received.
+    */
+    void receive(uint8_t b);
+
+   /**
+    * Play the queued messages.
+    *
+    * Pass all the queued messages to the synthesizer. This should be called
+    * from the main loop() as frequently as possible. This method is the only
+    * consumer for the queue.
+    *
+    * \return the number of messages played.
+    */
+    uint8_t run(void);
+
+   //--------------------------------------------------------------
+   /** \name Statistics.
+    * @{
+    */
+   /**
+    * Get the maximum note on latency.
+    *
+    * The latency is the time from receiving the last byte of a note on
+    * message to the note on being written to the YM2413.
+    *
+    * \return the maximum latency in microseconds.
+    */
+    uint32_t getLatencyMax(void) { return(_latencyMax); }
+
+   /**
+    * Get the average note on latency.
+    *
+    * \sa getLatencyMax()
+    *
+    * \return the average latency in microseconds.
+    */
+    uint32_t getLatencyAvg(void) { return(_latencyCount == 0 ? 0 : _latencySum / _latencyCount); }
+
+   /**
+    * Get the lost message count.
+    *
+    * Messages are lost if the queue is full when they are received.
+    *
+    * \return the number of messages lost.
+    */
+    uint16_t getOverflow(void) { return(_overflow); }
+
+   /**
+    * Reset the statistics.
+    *
+    * Set all the statistics counters to zero.
+    */
+    void resetStats(void);
+
+   /** @} */
+
+  private:
+    // Queued event
+    struct midiEvent_t
+    {
+      uint8_t status;   ///< status byte including channel
+      uint8_t data1;    ///< first data byte
+      uint8_t data2;    ///< second data byte
+      uint32_t time;    ///< micros() time the message was received
+    };
+
+    MD_YM2413_MIDI& _M;   ///< the synthesizer
+
+    // Event queue. _head is only changed by the producer and _tail
+    // by the consumer, so no locking is needed.
+    midiEvent_t _Q[QUEUE_SIZE];   ///< event queue
+    volatile uint8_t _head;       ///< next queue slot to write
+    volatile uint8_t _tail;       ///< next queue slot to read
+
+    // Parser state, only used by the producer
+    uint8_t _status;      ///< running status, 0 if none
+    uint8_t _data[2];     ///< data bytes received for the current message
+    uint8_t _count;       ///< number of data bytes received
+    bool _sysEx;          ///< true while skipping a System Exclusive message
+
+    // Statistics
+    volatile uint16_t _overflow;  ///< messages lost due to queue full
+    uint32_t _latencyMax;         ///< maximum note on latency
+    uint32_t _latencySum;         ///< total note on latency
+    uint16_t _latencyCount;       ///< number of note on latencies in _latencySum
+
+    void queue(void);
+};
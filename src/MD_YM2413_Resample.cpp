@@ -0,0 +1,245 @@
+/*
+MD_YM2413 - Library for using a YM2413 sound generator
+
+See header file for copyright and licensing comments.
+*/
+#include <MD_YM2413_Resample.h>
+#if RESAMPLE_SSE2
+#include <emmintrin.h>
+#endif
+
+/**
+* \file
+* \brief Implements the sample rate converter methods
+*/
+
+// Global data tables
+// Kaiser windowed sinc (beta 7) with the cutoff at 19kHz for the 49716Hz
+// input rate, TAPS coefficients for each of the PHASES output positions
+// between input samples and one more for the next input sample, so that
+// the output can be interpolated between each pair of phases. Each phase
+// is scaled to sum to 32768 (unity gain).
+const int16_t PROGMEM MD_YM2413_Resample::_coef[] =
+{
+  22, -56, 50, 90, -398, 707, -616, -323, 2253, -4744, 6878, 25043,  // 0
+  6878, -4744, 2253, -323, -616, 707, -398, 90, 50, -56, 22, -3,
+  22, -54, 45, 98, -402, 694, -575, -387, 2299, -4681, 6485, 25037,  // 1
+  7274, -4801, 2204, -258, -657, 719, -393, 82, 55, -58, 22, -3,
+  22, -53, 40, 106, -405, 680, -533, -449, 2341, -4613, 6095, 25019,  // 2
+  7673, -4852, 2150, -192, -698, 730, -388, 73, 61, -60, 23, -2,
+  22, -51, 34, 113, -408, 666, -492, -509, 2378, -4539, 5709, 24989,  // 3
+  8074, -4897, 2092, -124, -738, 741, -382, 65, 66, -61, 23, -2,
+  21, -49, 29, 120, -410, 650, -450, -569, 2412, -4460, 5326, 24947,  // 4
+  8478, -4935, 2031, -56, -778, 750, -375, 55, 71, -63, 23, -2,
+  21, -47, 24, 127, -411, 634, -408, -626, 2442, -4376, 4947, 24893,  // 5
+  8883, -4968, 1966, 14, -817, 759, -368, 46, 76, -64, 23, -2,
+  21, -45, 19, 134, -412, 617, -366, -682, 2468, -4288, 4573, 24827,  // 6
+  9290, -4993, 1896, 84, -855, 766, -360, 37, 82, -66, 23, -2,
+  21, -43, 15, 140, -412, 600, -324, -736, 2490, -4195, 4204, 24749,  // 7
+  9697, -5012, 1823, 156, -893, 773, -351, 27, 87, -67, 22, -2,
+  20, -41, 10, 146, -412, 582, -282, -788, 2508, -4097, 3839, 24660,  // 8
+  10106, -5024, 1747, 228, -929, 778, -342, 17, 92, -69, 22, -2,
+  20, -39, 5, 151, -411, 563, -240, -839, 2522, -3996, 3479, 24559,  // 9
+  10515, -5029, 1666, 301, -965, 782, -332, 6, 98, -70, 22, -1,
+  19, -37, 1, 156, -409, 544, -199, -887, 2532, -3890, 3125, 24446,  // 10
+  10925, -5026, 1582, 374, -1001, 785, -321, -4, 103, -71, 22, -1,
+  19, -35, -4, 161, -407, 524, -158, -934, 2539, -3781, 2776, 24322,  // 11
+  11334, -5017, 1495, 448, -1035, 787, -310, -15, 108, -72, 22, -1,
+  18, -33, -8, 166, -404, 504, -117, -978, 2542, -3668, 2434, 24186,  // 12
+  11743, -4999, 1403, 522, -1068, 788, -298, -26, 113, -73, 21, -1,
+  18, -31, -13, 170, -401, 483, -77, -1021, 2541, -3552, 2097, 24039,  // 13
+  12151, -4974, 1309, 596, -1100, 788, -285, -37, 118, -74, 21, 0,
+  17, -29, -17, 174, -397, 462, -37, -1061, 2536, -3433, 1766, 23881,  // 14
+  12559, -4942, 1211, 671, -1131, 787, -272, -48, 123, -75, 20, 0,
+  17, -27, -21, 177, -393, 441, 3, -1100, 2528, -3311, 1442, 23712,  // 15
+  12964, -4901, 1109, 746, -1160, 784, -258, -59, 128, -75, 20, 0,
+  16, -25, -25, 180, -388, 419, 42, -1136, 2517, -3186, 1124, 23532,  // 16
+  13368, -4853, 1005, 821, -1188, 781, -244, -70, 133, -76, 19, 0,
+  16, -23, -28, 183, -382, 397, 80, -1170, 2502, -3059, 813, 23342,  // 17
+  13770, -4796, 898, 895, -1215, 776, -229, -82, 137, -77, 19, 1,
+  15, -21, -32, 186, -376, 375, 118, -1202, 2483, -2929, 509, 23141,  // 18
+  14170, -4731, 787, 969, -1241, 769, -213, -93, 142, -77, 18, 1,
+  15, -19, -36, 188, -370, 353, 155, -1232, 2461, -2798, 213, 22930,  // 19
+  14567, -4658, 674, 1043, -1265, 762, -197, -105, 146, -77, 17, 2,
+  14, -17, -39, 190, -363, 330, 191, -1260, 2437, -2665, -77, 22708,  // 20
+  14961, -4577, 558, 1117, -1287, 753, -180, -117, 151, -77, 17, 2,
+  14, -15, -42, 191, -356, 307, 226, -1285, 2408, -2530, -359, 22476,  // 21
+  15352, -4487, 439, 1189, -1308, 743, -163, -128, 155, -77, 16, 2,
+  13, -13, -45, 192, -348, 284, 261, -1308, 2377, -2394, -633, 22235,  // 22
+  15738, -4389, 318, 1261, -1328, 732, -145, -140, 159, -77, 15, 3,
+  13, -12, -48, 193, -340, 261, 294, -1330, 2343, -2256, -900, 21984,  // 23
+  16121, -4283, 194, 1333, -1345, 720, -126, -152, 163, -77, 14, 3,
+  12, -10, -51, 194, -332, 238, 327, -1348, 2306, -2118, -1159, 21724,  // 24
+  16500, -4167, 68, 1403, -1361, 706, -108, -163, 166, -76, 13, 4,
+  11, -8, -54, 194, -323, 215, 359, -1365, 2266, -1979, -1410, 21455,  // 25
+  16874, -4044, -60, 1472, -1375, 691, -88, -175, 170, -76, 12, 4,
+  11, -6, -56, 194, -314, 193, 390, -1379, 2224, -1839, -1653, 21177,  // 26
+  17243, -3911, -189, 1540, -1387, 675, -69, -187, 173, -75, 11, 4,
+  10, -5, -59, 194, -305, 170, 420, -1392, 2178, -1699, -1887, 20890,  // 27
+  17607, -3770, -321, 1607, -1398, 658, -49, -198, 176, -75, 10, 5,
+  10, -3, -61, 193, -295, 147, 449, -1402, 2131, -1559, -2114, 20595,  // 28
+  17965, -3620, -454, 1672, -1406, 640, -28, -210, 179, -74, 9, 5,
+  9, -1, -63, 192, -285, 124, 477, -1410, 2081, -1419, -2332, 20292,  // 29
+  18317, -3462, -589, 1736, -1413, 620, -7, -221, 182, -73, 7, 6,
+  9, 0, -65, 191, -275, 102, 503, -1415, 2028, -1279, -2542, 19981,  // 30
+  18664, -3295, -725, 1798, -1418, 599, 14, -232, 184, -71, 6, 6,
+  8, 2, -67, 190, -265, 79, 529, -1419, 1974, -1139, -2743, 19662,  // 31
+  19003, -3120, -862, 1859, -1420, 577, 36, -243, 186, -70, 5, 7,
+  8, 3, -68, 188, -254, 57, 553, -1421, 1917, -1000, -2935, 19336,  // 32
+  19336, -2935, -1000, 1917, -1421, 553, 57, -254, 188, -68, 3, 8,
+  7, 5, -70, 186, -243, 36, 577, -1420, 1859, -862, -3120, 19003,  // 33
+  19662, -2743, -1139, 1974, -1419, 529, 79, -265, 190, -67, 2, 8,
+  6, 6, -71, 184, -232, 14, 599, -1418, 1798, -725, -3295, 18664,  // 34
+  19981, -2542, -1279, 2028, -1415, 503, 102, -275, 191, -65, 0, 9,
+  6, 7, -73, 182, -221, -7, 620, -1413, 1736, -589, -3462, 18317,  // 35
+  20292, -2332, -1419, 2081, -1410, 477, 124, -285, 192, -63, -1, 9,
+  5, 9, -74, 179, -210, -28, 640, -1406, 1672, -454, -3620, 17965,  // 36
+  20595, -2114, -1559, 2131, -1402, 449, 147, -295, 193, -61, -3, 10,
+  5, 10, -75, 176, -198, -49, 658, -1398, 1607, -321, -3770, 17607,  // 37
+  20890, -1887, -1699, 2178, -1392, 420, 170, -305, 194, -59, -5, 10,
+  4, 11, -75, 173, -187, -69, 675, -1387, 1540, -189, -3911, 17243,  // 38
+  21177, -1653, -1839, 2224, -1379, 390, 193, -314, 194, -56, -6, 11,
+  4, 12, -76, 170, -175, -88, 691, -1375, 1472, -60, -4044, 16874,  // 39
+  21455, -1410, -1979, 2266, -1365, 359, 215, -323, 194, -54, -8, 11,
+  4, 13, -76, 166, -163, -108, 706, -1361, 1403, 68, -4167, 16500,  // 40
+  21724, -1159, -2118, 2306, -1348, 327, 238, -332, 194, -51, -10, 12,
+  3, 14, -77, 163, -152, -126, 720, -1345, 1333, 194, -4283, 16121,  // 41
+  21984, -900, -2256, 2343, -1330, 294, 261, -340, 193, -48, -12, 13,
+  3, 15, -77, 159, -140, -145, 732, -1328, 1261, 318, -4389, 15738,  // 42
+  22235, -633, -2394, 2377, -1308, 261, 284, -348, 192, -45, -13, 13,
+  2, 16, -77, 155, -128, -163, 743, -1308, 1189, 439, -4487, 15352,  // 43
+  22476, -359, -2530, 2408, -1285, 226, 307, -356, 191, -42, -15, 14,
+  2, 17, -77, 151, -117, -180, 753, -1287, 1117, 558, -4577, 14961,  // 44
+  22708, -77, -2665, 2437, -1260, 191, 330, -363, 190, -39, -17, 14,
+  2, 17, -77, 146, -105, -197, 762, -1265, 1043, 674, -4658, 14567,  // 45
+  22930, 213, -2798, 2461, -1232, 155, 353, -370, 188, -36, -19, 15,
+  1, 18, -77, 142, -93, -213, 769, -1241, 969, 787, -4731, 14170,  // 46
+  23141, 509, -2929, 2483, -1202, 118, 375, -376, 186, -32, -21, 15,
+  1, 19, -77, 137, -82, -229, 776, -1215, 895, 898, -4796, 13770,  // 47
+  23342, 813, -3059, 2502, -1170, 80, 397, -382, 183, -28, -23, 16,
+  0, 19, -76, 133, -70, -244, 781, -1188, 821, 1005, -4853, 13368,  // 48
+  23532, 1124, -3186, 2517, -1136, 42, 419, -388, 180, -25, -25, 16,
+  0, 20, -75, 128, -59, -258, 784, -1160, 746, 1109, -4901, 12964,  // 49
+  23712, 1442, -3311, 2528, -1100, 3, 441, -393, 177, -21, -27, 17,
+  0, 20, -75, 123, -48, -272, 787, -1131, 671, 1211, -4942, 12559,  // 50
+  23881, 1766, -3433, 2536, -1061, -37, 462, -397, 174, -17, -29, 17,
+  0, 21, -74, 118, -37, -285, 788, -1100, 596, 1309, -4974, 12151,  // 51
+  24039, 2097, -3552, 2541, -1021, -77, 483, -401, 170, -13, -31, 18,
+  -1, 21, -73, 113, -26, -298, 788, -1068, 522, 1403, -4999, 11743,  // 52
+  24186, 2434, -3668, 2542, -978, -117, 504, -404, 166, -8, -33, 18,
+  -1, 22, -72, 108, -15, -310, 787, -1035, 448, 1495, -5017, 11334,  // 53
+  24322, 2776, -3781, 2539, -934, -158, 524, -407, 161, -4, -35, 19,
+  -1, 22, -71, 103, -4, -321, 785, -1001, 374, 1582, -5026, 10925,  // 54
+  24446, 3125, -3890, 2532, -887, -199, 544, -409, 156, 1, -37, 19,
+  -1, 22, -70, 98, 6, -332, 782, -965, 301, 1666, -5029, 10515,  // 55
+  24559, 3479, -3996, 2522, -839, -240, 563, -411, 151, 5, -39, 20,
+  -2, 22, -69, 92, 17, -342, 778, -929, 228, 1747, -5024, 10106,  // 56
+  24660, 3839, -4097, 2508, -788, -282, 582, -412, 146, 10, -41, 20,
+  -2, 22, -67, 87, 27, -351, 773, -893, 156, 1823, -5012, 9697,  // 57
+  24749, 4204, -4195, 2490, -736, -324, 600, -412, 140, 15, -43, 21,
+  -2, 23, -66, 82, 37, -360, 766, -855, 84, 1896, -4993, 9290,  // 58
+  24827, 4573, -4288, 2468, -682, -366, 617, -412, 134, 19, -45, 21,
+  -2, 23, -64, 76, 46, -368, 759, -817, 14, 1966, -4968, 8883,  // 59
+  24893, 4947, -4376, 2442, -626, -408, 634, -411, 127, 24, -47, 21,
+  -2, 23, -63, 71, 55, -375, 750, -778, -56, 2031, -4935, 8478,  // 60
+  24947, 5326, -4460, 2412, -569, -450, 650, -410, 120, 29, -49, 21,
+  -2, 23, -61, 66, 65, -382, 741, -738, -124, 2092, -4897, 8074,  // 61
+  24989, 5709, -4539, 2378, -509, -492, 666, -408, 113, 34, -51, 22,
+  -2, 23, -60, 61, 73, -388, 730, -698, -192, 2150, -4852, 7673,  // 62
+  25019, 6095, -4613, 2341, -449, -533, 680, -405, 106, 40, -53, 22,
+  -3, 22, -58, 55, 82, -393, 719, -657, -258, 2204, -4801, 7274,  // 63
+  25037, 6485, -4681, 2299, -387, -575, 694, -402, 98, 45, -54, 22,
+  -3, 22, -56, 50, 90, -398, 707, -616, -323, 2253, -4744, 6878,  // 64
+  25043, 6878, -4744, 2253, -323, -616, 707, -398, 90, 50, -56, 22,
+};
+
+#if RESAMPLE_DSP
+static inline int32_t smlad(uint32_t x, uint32_t y, int32_t acc)
+// Dual 16 bit multiply with 32 bit accumulate, acc + x.lo*y.lo + x.hi*y.hi
+{
+  __asm__ ("smlad %0, %1, %2, %0" : "+r" (acc) : "r" (x), "r" (y));
+  return(acc);
+}
+#endif
+
+void MD_YM2413_Resample::begin(uint32_t inRate, uint32_t outRate)
+{
+  _step = (uint32_t)(((uint64_t)inRate << 16) / outRate);
+  _delay = (uint16_t)(((TAPS / 2) * 1000000UL) / inRate);
+  reset();
+}
+
+void MD_YM2413_Resample::reset(void)
+{
+  memset(_hist, 0, sizeof(_hist));
+  _histPos = 0;
+  _pos = 0;
+}
+
+int32_t MD_YM2413_Resample::filter(const int16_t* x, const int16_t* c)
+// Work out one output sample from TAPS input samples, oldest first
+{
+  int32_t acc = 1L << 14;   // rounding
+
+#if RESAMPLE_DSP
+  // two samples at a time, the tables are in directly addressed flash
+  for (uint8_t i = 0; i < TAPS; i += 2)
+  {
+    uint32_t xx, cc;
+
+    memcpy(&xx, &x[i], sizeof(xx));
+    memcpy(&cc, &c[i], sizeof(cc));
+    acc = smlad(xx, cc, acc);
+  }
+#elif RESAMPLE_SSE2
+  // eight samples at a time on the host, the sums are the same as the 
+  // 16x16 multiplies with a 32 bit total, so the output is the same
+  __m128i sum = _mm_setzero_si128();
+
+  for (uint8_t i = 0; i < TAPS; i += 8)
+  {
+    __m128i xx = _mm_loadu_si128((const __m128i*)&x[i]);
+    __m128i cc = _mm_loadu_si128((const __m128i*)&c[i]);
+
+    sum = _mm_add_epi32(sum, _mm_madd_epi16(xx, cc));
+  }
+  sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+  sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+  acc += _mm_cvtsi128_si32(sum);
+#else
+  for (uint8_t i = 0; i < TAPS; i++)
+    acc += (int32_t)x[i] * (int16_t)pgm_read_word(&c[i]);
+#endif
+
+  return(acc >> 15);
+}
+
+uint16_t MD_YM2413_Resample::process(const int16_t* in, uint16_t count, int16_t* out)
+{
+  int16_t* p = out;
+
+  while (count--)
+  {
+    // add the sample to both copies of the history
+    _hist[_histPos] = _hist[_histPos + TAPS] = *in++;
+    if (++_histPos >= TAPS) _histPos = 0;
+
+    // the output samples up to the next input sample
+    while (_pos < POS_ONE)
+    {
+      const int16_t* c = &_coef[(_pos >> POS_SHIFT) * TAPS];
+      int32_t y0 = filter(&_hist[_histPos], c);
+      int32_t y1 = filter(&_hist[_histPos], c + TAPS);
+
+      // interpolate between the phases either side of the position
+      y0 += ((y1 - y0) * (int32_t)(_pos & POS_FRAC)) >> POS_SHIFT;
+      if (y0 > INT16_MAX) y0 = INT16_MAX;
+      if (y0 < INT16_MIN) y0 = INT16_MIN;
+      *p++ = y0;
+      _pos += _step;
+    }
+    _pos -= POS_ONE;
+  }
+
+  return(p - out);
+}
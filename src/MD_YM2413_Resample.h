@@ -0,0 +1,130 @@
+#pragma once
+
+#include <Arduino.h>
+
+/**
+ * \file
+ * \brief Header file for the MD_YM2413_Resample sample rate converter
+ */
+
+#ifndef RESAMPLE_DSP
+#if defined(__ARM_FEATURE_DSP)    // Cortex-M4/M7 with the DSP instructions
+#define RESAMPLE_DSP 1  ///< Set to 1 to use the SMLAD dual multiply accumulate instruction. See \ref pageCompileSwitch
+#else
+#define RESAMPLE_DSP 0  ///< Set to 1 to use the SMLAD dual multiply accumulate instruction. See \ref pageCompileSwitch
+#endif
+#endif
+
+#ifndef RESAMPLE_SSE2
+#if defined(__SSE2__) && !RESAMPLE_DSP  // x86 host build
+#define RESAMPLE_SSE2 1 ///< Set to 1 to use the SSE2 8 way multiply accumulate instructions. See \ref pageCompileSwitch
+#else
+#define RESAMPLE_SSE2 0 ///< Set to 1 to use the SSE2 8 way multiply accumulate instructions. See \ref pageCompileSwitch
+#endif
+#endif
+
+/**
+ * Sample rate converter class for the MD_YM2413 library
+ *
+ * Converts the samples from the MD_YM2413_Emu sample rate (about 49.7kHz)
+ * to the rate used by the audio output (usually 44.1kHz or 48kHz) using a
+ * polyphase FIR filter with a fixed table of integer coefficients.
+ * The samples are read from and written to buffers supplied by the
+ * application, one block at a time.
+ * See \ref pageEmulator for how this is used.
+ */
+class MD_YM2413_Resample
+{
+  public:
+    static const uint8_t TAPS = 24;         ///< filter length in input samples
+    static const uint8_t PHASE_BITS = 6;    ///< bits for the filter phase
+    static const uint8_t PHASES = (1 << PHASE_BITS); ///< filter phases between input samples
+
+   /**
+    * Class Constructor.
+    *
+    * Instantiate a new instance of the class.
+    */
+    MD_YM2413_Resample(void) : _step(0) {};
+
+   /**
+    * Class Destructor.
+    *
+    * Does the necessary to clean up once the object is no longer required.
+    */
+    ~MD_YM2413_Resample(void) {};
+
+   /**
+    * Initialize the object.
+    *
+    * Set the input and output sample rates and clear the filter. This needs
+    * to be called during setup() and may be called again to change the rates.
+    *
+    * The filter is flat to about 16kHz, so the output rate should be 44.1kHz
+    * or more.
+    *
+    * \param inRate   the input sample rate in Hz, usually getSampleRate() for the MD_YM2413_Emu object.
+    * \param outRate  the output sample rate in Hz.
+    */
+    void begin(uint32_t inRate, uint32_t outRate);
+
+   /**
+    * Clear the filter.
+    *
+    * Set the input history to silence, for example when the audio output
+    * restarts after a gap.
+    */
+    void reset(void);
+
+   /**
+    * Get the output buffer size.
+    *
+    * The number of output samples for each block of input changes with
+    * the position of the output samples between the input samples. This is
+    * the most samples that process() can write for the block.
+    *
+    * \param count  the number of input samples.
+    * \return the largest number of output samples.
+    */
+    uint16_t getOutputSize(uint16_t count) { return((uint16_t)(((uint32_t)count << 16) / _step) + 1); }
+
+   /**
+    * Get the filter delay.
+    *
+    * The filter delays the audio by half its length in input samples.
+    * This is added to the time for the block to play to give the latency
+    * of the audio output.
+    *
+    * \return the delay in microseconds.
+    */
+    uint16_t getDelay(void) { return(_delay); }
+
+   /**
+    * Convert a block of samples.
+    *
+    * All the input samples are used and the output samples are written to
+    * the output buffer, which must have space for getOutputSize(count)
+    * samples. The input and output buffers must not overlap.
+    *
+    * \param in     the input samples.
+    * \param count  the number of input samples.
+    * \param out    the buffer for the output samples.
+    * \return the number of samples written to the output buffer.
+    */
+    uint16_t process(const int16_t* in, uint16_t count, int16_t* out);
+
+  private:
+    static const uint32_t POS_ONE = 0x10000UL;  ///< one input sample in the position fixed point
+    static const uint8_t POS_SHIFT = 16 - PHASE_BITS; ///< position to filter phase
+    static const uint16_t POS_FRAC = (1 << POS_SHIFT) - 1; ///< position between filter phases
+
+    uint32_t _step;               ///< input samples for each output sample, 16.16 fixed point
+    uint32_t _pos;                ///< next output position after the filter center, 16.16 fixed point
+    uint16_t _delay;              ///< filter delay in us
+    uint8_t _histPos;             ///< oldest sample in the history
+    int16_t _hist[2 * TAPS];      ///< input history, held twice so the filter reads it in one run
+
+    static const int16_t _coef[]; ///< filter coefficients, TAPS for each of PHASES+1 phases, Q15
+
+    int32_t filter(const int16_t* x, const int16_t* c);
+};
@@ -0,0 +1,252 @@
+/*
+MD_YM2413 - Library for using a YM2413 sound generator
+
+See header file for copyright and licensing comments.
+*/
+#include <MD_YM2413_Seq.h>
+#include <MD_YM2413_lib.h>
+
+/**
+* \file
+* \brief Implements the pattern sequencer methods
+*/
+
+void MD_YM2413_Seq::begin(void)
+{
+  _loop = false;
+  setTempo(BPM_DEFAULT);
+  resetStats();
+}
+
+void MD_YM2413_Seq::resetStats(void)
+{
+  _jitterMax = 0;
+  _jitterSum = 0;
+  _jitterCount = 0;
+  _late = 0;
+}
+
+void MD_YM2413_Seq::setTempo(uint8_t bpm, uint8_t speed)
+{
+  if (bpm < 32) bpm = 32;
+  if (speed == 0) speed = 1;
+
+  _tickPeriod = 2500000UL / bpm;   // 2/5 bpm ticks per second
+  _speed = _speedStart = speed;
+}
+
+void MD_YM2413_Seq::start(void)
+{
+  if (_order == nullptr || _orderSize == 0)
+    return;
+
+  for (uint8_t i = 0; i < MAX_CHAN; i++)
+  {
+    _C[i].vol = MD_YM2413::VOL_MAX;
+    _C[i].fx = FX_NONE;
+    _C[i].bend = 0;
+  }
+
+  _orderIdx = 0;
+  startPattern();
+  _speed = _speedStart;
+  _tick = 0;
+  _timeNext = micros();
+  _playing = true;
+}
+
+void MD_YM2413_Seq::stop(void)
+{
+  if (_playing)
+  {
+    for (uint8_t i = 0; i < _S.countChannels(); i++)
+      if (!_S.isIdle(i))
+        _S.noteOff(i);
+  }
+  _playing = false;
+}
+
+void MD_YM2413_Seq::startPattern(void)
+// Set up to read the pattern at the current order list entry
+{
+  _p = (const uint8_t*)pgm_read_ptr(&_order[_orderIdx]);
+  _rows = pgm_read_byte(_p++);
+  _row = 0;
+  _skip = 0;
+}
+
+bool MD_YM2413_Seq::run(void)
+{
+  uint32_t now, jitter;
+
+  if (!_playing)
+    return(false);
+
+  now = micros();
+  if ((int32_t)(now - _timeNext) < 0)   // not time yet
+    return(true);
+
+  // timing statistics
+  jitter = now - _timeNext;
+  if (jitter > _jitterMax) _jitterMax = jitter;
+  _jitterSum += jitter;
+  _jitterCount++;
+  if (jitter >= _tickPeriod)
+  {
+    _late++;
+    if (jitter >= RESYNC_TICKS * _tickPeriod)   // too far behind to catch up
+      _timeNext = now;
+  }
+  _timeNext += _tickPeriod;
+
+  // play the tick
+  if (_tick == 0)
+    playRow();
+  else
+    playEffects();
+
+  // move on to the next tick
+  if (++_tick >= _speed)
+  {
+    _tick = 0;
+    if (++_row >= _rows)
+    {
+      if (++_orderIdx >= _orderSize)
+      {
+        _orderIdx = 0;
+        if (!_loop)
+          stop();
+      }
+      if (_playing)
+        startPattern();
+    }
+  }
+
+  return(_playing);
+}
+
+void MD_YM2413_Seq::playRow(void)
+// Read the cells for this row and send all the changes, with the key
+// offs before any key on so that repeated notes restart cleanly.
+{
+  uint8_t flags[MAX_CHAN] = { 0 };
+  uint8_t note[MAX_CHAN];
+  uint8_t inst[MAX_CHAN];
+  uint8_t b, c;
+
+  // effects only last for their row
+  for (c = 0; c < MAX_CHAN; c++)
+  {
+    if (_C[c].fx == FX_ARPEGGIO)    // back to the note pitch
+      _S.bendNote(c, _C[c].bend);
+    _C[c].fx = FX_NONE;
+  }
+
+  if (_skip != 0)   // empty row
+  {
+    _skip--;
+    return;
+  }
+
+  // read the cells
+  while (((b = pgm_read_byte(_p++)) & CELL_CHAN) != ROW_END)
+  {
+    uint8_t n = 0, i = 0, v = 0, fx = FX_NONE, param = 0;
+
+    if (b & CELL_NOTE) n = pgm_read_byte(_p++);
+    if (b & CELL_INST) i = pgm_read_byte(_p++);
+    if (b & CELL_VOL) v = pgm_read_byte(_p++);
+    if (b & CELL_FX) { fx = pgm_read_byte(_p++); param = pgm_read_byte(_p++); }
+
+    c = b & CELL_CHAN;
+    if (c >= MAX_CHAN)
+      continue;
+
+    flags[c] = b;
+    note[c] = n;
+    inst[c] = i;
+    if (b & CELL_VOL) _C[c].vol = (v > MD_YM2413::VOL_MAX) ? MD_YM2413::VOL_MAX : v;
+    if (b & CELL_FX) { _C[c].fx = fx; _C[c].param = param; }
+  }
+  _skip = b >> 4;
+
+  // key offs
+  for (c = 0; c < MAX_CHAN; c++)
+    if ((flags[c] & CELL_NOTE) && !_S.isIdle(c))
+      _S.noteOff(c);
+
+  // instrument and volume changes
+  for (c = 0; c < MAX_CHAN; c++)
+  {
+    if (flags[c] & CELL_INST)
+      _S.setInstrument(c, (MD_YM2413::instrument_t)inst[c], _C[c].vol);
+    else if ((flags[c] & (CELL_VOL | CELL_NOTE)) == CELL_VOL)   // note on sets the volume
+      _S.setVolume(c, _C[c].vol);
+
+    if (_C[c].fx == FX_SPEED && _C[c].param != 0)
+      _speed = _C[c].param;
+  }
+
+  // key ons
+  for (c = 0; c < MAX_CHAN; c++)
+    if ((flags[c] & CELL_NOTE) && note[c] != NOTE_OFF)
+    {
+      _C[c].bend = 0;
+      _S.noteOn(c, (uint8_t)(note[c] >> 4), (uint8_t)(note[c] & 0xf), _C[c].vol);
+    }
+}
+
+void MD_YM2413_Seq::playEffects(void)
+// Apply the row effects for the ticks after the first in the row
+{
+  for (uint8_t c = 0; c < MAX_CHAN; c++)
+  {
+    seqChan_t* pc = &_C[c];
+
+    switch (pc->fx)
+    {
+    case FX_ARPEGGIO:
+      {
+        uint8_t t = _tick % 3;
+        uint8_t semi = (t == 0) ? 0 : (t == 1) ? (pc->param >> 4) : (pc->param & 0xf);
+
+        _S.bendNote(c, pc->bend + (semi << 8));
+      }
+      break;
+
+    case FX_SLIDE_UP:
+      pc->bend += pc->param << 4;
+      if (pc->bend > BEND_MAX) pc->bend = BEND_MAX;
+      _S.bendNote(c, pc->bend);
+      break;
+
+    case FX_SLIDE_DOWN:
+      pc->bend -= pc->param << 4;
+      if (pc->bend < -BEND_MAX) pc->bend = -BEND_MAX;
+      _S.bendNote(c, pc->bend);
+      break;
+
+    case FX_VOL_SLIDE:
+      {
+        int8_t v = pc->vol + (pc->param >> 4) - (pc->param & 0xf);
+
+        if (v < MD_YM2413::VOL_OFF) v = MD_YM2413::VOL_OFF;
+        if (v > MD_YM2413::VOL_MAX) v = MD_YM2413::VOL_MAX;
+        if (v != pc->vol)
+        {
+          pc->vol = v;
+          _S.setVolume(c, v);
+        }
+      }
+      break;
+
+    case FX_CUT:
+      if (_tick == pc->param && !_S.isIdle(c))
+        _S.noteOff(c);
+      break;
+
+    default:
+      break;
+    }
+  }
+}
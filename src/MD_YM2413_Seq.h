@@ -0,0 +1,226 @@
+#pragma once
+
+#include <Arduino.h>
+#include <MD_YM2413.h>
+
+/**
+ * \file
+ * \brief Header file for the MD_YM2413_Seq pattern sequencer
+ */
+
+/**
+ * Pattern sequencer class for the MD_YM2413 library
+ *
+ * Plays tracker style patterns from PROGMEM at a fixed tick rate.
+ * See \ref pageSequencer for how this is used and the pattern format.
+ */
+class MD_YM2413_Seq
+{
+  public:
+    static const uint8_t MAX_CHAN = 11;         ///< Number of YM2413 channels in a pattern row
+    static const uint8_t SPEED_DEFAULT = 6;     ///< Default ticks per row
+    static const uint8_t BPM_DEFAULT = 125;     ///< Default tempo, 50 ticks per second
+
+    // Pattern cell header byte
+    static const uint8_t CELL_CHAN = 0x0f;      ///< Cell header channel number mask
+    static const uint8_t CELL_NOTE = 0x10;      ///< Cell header flag, note byte follows
+    static const uint8_t CELL_INST = 0x20;      ///< Cell header flag, instrument byte follows
+    static const uint8_t CELL_VOL = 0x40;       ///< Cell header flag, volume byte follows
+    static const uint8_t CELL_FX = 0x80;        ///< Cell header flag, effect and parameter bytes follow
+    static const uint8_t ROW_END = 0x0f;        ///< Cell header channel for the end of a row, high nibble is the empty rows that follow
+
+    static const uint8_t NOTE_OFF = 0xff;       ///< Note byte to turn the note off
+
+   /**
+    * Pattern effects
+    *
+    * Effects are applied on the ticks of the row they are set in.
+    */
+    typedef enum
+    {
+      FX_NONE = 0,      ///< no effect
+      FX_ARPEGGIO = 1,  ///< cycle note, +x, +y semitones each tick, parameter 0xXY
+      FX_SLIDE_UP = 2,  ///< slide pitch up each tick, parameter in 1/16 semitones
+      FX_SLIDE_DOWN = 3,///< slide pitch down each tick, parameter in 1/16 semitones
+      FX_VOL_SLIDE = 4, ///< change the volume each tick, parameter 0xXY is up X or down Y
+      FX_CUT = 5,       ///< turn the note off at tick parameter of the row
+      FX_SPEED = 6,     ///< set the ticks per row to parameter
+    } effect_t;
+
+   /**
+    * Class Constructor.
+    *
+    * Instantiate a new instance of the class.
+    *
+    * \param ym  the MD_YM2413 object used to play the notes.
+    */
+    MD_YM2413_Seq(MD_YM2413& ym) : _S(ym), _order(nullptr), _orderSize(0), _playing(false) {};
+
+   /**
+    * Class Destructor.
+    *
+    * Does the necessary to clean up once the object is no longer required.
+    */
+    ~MD_YM2413_Seq(void) {};
+
+   /**
+    * Initialize the object.
+    *
+    * Initialize the object data. This needs to be called during setup(), after
+    * the begin() for the MD_YM2413 object.
+    */
+    void begin(void);
+
+   //--------------------------------------------------------------
+   /** \name Song Control.
+    * @{
+    */
+   /**
+    * Set the song to play.
+    *
+    * The song is an order list of patterns held in PROGMEM. Each entry is a
+    * pointer to a PROGMEM pattern, and a pattern can be used more than once.
+    *
+    * \param order  PROGMEM array of pointers to the PROGMEM patterns.
+    * \param size   number of entries in the order list.
+    */
+    void setSong(const uint8_t* const* order, uint8_t size) { stop(); _order = order; _orderSize = size; }
+
+   /**
+    * Set the tempo.
+    *
+    * The tick rate is set by the tempo, in the same way as tracker programs,
+    * as (bpm * 2 / 5) ticks per second. A row is played every speed ticks,
+    * and the effects are applied each tick.
+    *
+    * \param bpm    the tempo in beats per minute [32..255].
+    * \param speed  the number of ticks per row [1..255].
+    */
+    void setTempo(uint8_t bpm, uint8_t speed = SPEED_DEFAULT);
+
+   /**
+    * Set the song repeat.
+    *
+    * \param loop  true to restart the song at the end, false to stop.
+    */
+    void setLoop(bool loop) { _loop = loop; }
+
+   /**
+    * Start playing the song.
+    *
+    * Play the song from the first pattern in the order list.
+    */
+    void start(void);
+
+   /**
+    * Stop playing the song.
+    *
+    * Stop the song and turn off all the notes.
+    */
+    void stop(void);
+
+   /**
+    * Return the playing state.
+    *
+    * \return true if the song is playing.
+    */
+    bool isPlaying(void) { return(_playing); }
+
+   /**
+    * Run the sequencer.
+    *
+    * Play the ticks that are due. This should be called from the main loop()
+    * as frequently as possible, as the time taken between calls is the timing
+    * jitter for the ticks.
+    *
+    * \return true if the song is playing.
+    */
+    bool run(void);
+
+   /** @} */
+
+   //--------------------------------------------------------------
+   /** \name Statistics.
+    * @{
+    */
+   /**
+    * Get the maximum tick jitter.
+    *
+    * The jitter is the time between when a tick is due and when it is played.
+    *
+    * \return the maximum jitter in microseconds.
+    */
+    uint32_t getJitterMax(void) { return(_jitterMax); }
+
+   /**
+    * Get the average tick jitter.
+    *
+    * \sa getJitterMax()
+    *
+    * \return the average jitter in microseconds.
+    */
+    uint32_t getJitterAvg(void) { return(_jitterCount == 0 ? 0 : _jitterSum / _jitterCount); }
+
+   /**
+    * Get the late tick count.
+    *
+    * A tick is late if it is played more than a whole tick period after
+    * it was due.
+    *
+    * \return the number of late ticks.
+    */
+    uint16_t getLate(void) { return(_late); }
+
+   /**
+    * Reset the statistics.
+    *
+    * Set all the statistics counters to zero.
+    */
+    void resetStats(void);
+
+   /** @} */
+
+  private:
+    static const uint8_t RESYNC_TICKS = 4;  ///< ticks late before the tick timing is restarted
+    static const int16_t BEND_MAX = 96 << 8; ///< pitch bend limit for slides, the full range of notes
+
+    // Per channel data
+    struct seqChan_t
+    {
+      uint8_t vol;        ///< current volume
+      uint8_t fx;         ///< effect for the current row
+      uint8_t param;      ///< effect parameter for the current row
+      int16_t bend;       ///< current pitch bend in 1/256 semitone
+    };
+
+    MD_YM2413& _S;                  ///< the YM2413 device
+    seqChan_t _C[MAX_CHAN];         ///< channel data
+
+    const uint8_t* const* _order;   ///< PROGMEM pattern order list
+    uint8_t _orderSize;             ///< number of entries in the order list
+    bool _loop;                     ///< repeat the song at the end
+    bool _playing;                  ///< song is playing
+
+    uint8_t _orderIdx;              ///< current entry in the order list
+    const uint8_t* _p;              ///< next byte to read in the current pattern
+    uint8_t _rows;                  ///< number of rows in the current pattern
+    uint8_t _row;                   ///< current row in the pattern
+    uint8_t _skip;                  ///< empty rows to play before reading the pattern
+    uint8_t _speed;                 ///< ticks per row
+    uint8_t _speedStart;            ///< ticks per row at the start of the song
+    uint8_t _tick;                  ///< current tick in the row
+
+    uint32_t _tickPeriod;           ///< tick period in microseconds
+    uint32_t _timeNext;             ///< micros() time the next tick is due
+
+    // Statistics
+    uint32_t _jitterMax;            ///< maximum tick jitter
+    uint32_t _jitterSum;            ///< total tick jitter
+    uint32_t _jitterCount;          ///< number of ticks in _jitterSum
+    uint16_t _late;                 ///< number of late ticks
+
+    // Methods
+    void startPattern(void);
+    void playRow(void);
+    void playEffects(void);
+};
@@ -0,0 +1,90 @@
+/*
+MD_YM2413 - Library for using a YM2413 sound generator
+
+See header file for copyright and licensing comments.
+*/
+#include <MD_YM2413_Trace.h>
+
+/**
+* \file
+* \brief Implements the library trace buffer methods
+*/
+
+#if LIB_TRACE
+static_assert((LIB_TRACE & (LIB_TRACE - 1)) == 0, "LIB_TRACE must be a power of 2");
+
+#define TRACE_VERSION 1     // dump format version checked by the host decoder
+
+MD_YM2413_Trace::record_t MD_YM2413_Trace::_R[LIB_TRACE];
+uint16_t MD_YM2413_Trace::_head = 0;
+uint16_t MD_YM2413_Trace::_count = 0;
+uint16_t MD_YM2413_Trace::_lost = 0;
+
+void MD_YM2413_Trace::log(uint8_t event, uint8_t chan, uint16_t arg)
+// Kept short as this is called in the library timing path
+{
+  record_t* pr = &_R[_head];
+
+  pr->time = micros();
+  pr->event = event;
+  pr->chan = chan;
+  pr->arg = arg;
+
+  _head = (_head + 1) & (LIB_TRACE - 1);
+  if (_count < LIB_TRACE)
+    _count++;
+  else
+    _lost++;      // the oldest record has been overwritten
+}
+
+bool MD_YM2413_Trace::read(record_t& r)
+{
+  if (_count == 0)
+    return(false);
+
+  r = _R[(_head - _count) & (LIB_TRACE - 1)];
+  _count--;
+
+  return(true);
+}
+
+void MD_YM2413_Trace::clear(void)
+{
+  _count = 0;
+  _lost = 0;
+}
+
+void MD_YM2413_Trace::printHex(Print& out, uint32_t v, uint8_t digits)
+// Fixed width hex with leading zeros
+{
+  while (digits-- != 0)
+    out.print((v >> (digits * 4)) & 0xf, HEX);
+}
+
+void MD_YM2413_Trace::dump(Print& out)
+// One line for each record, "time event chan arg" in hex, between
+// a header line with the format version and lost count, and an end line.
+{
+  record_t r;
+
+  out.print(F("\n#YM2413 TRACE "));
+  out.print(TRACE_VERSION);
+  out.print(F(" "));
+  out.print(_lost);
+  _lost = 0;
+
+  while (read(r))
+  {
+    out.print(F("\n"));
+    printHex(out, r.time, 8);
+    out.print(F(" "));
+    printHex(out, r.event, 2);
+    out.print(F(" "));
+    printHex(out, r.chan, 2);
+    out.print(F(" "));
+    printHex(out, r.arg, 4);
+  }
+
+  out.print(F("\n#END\n"));
+}
+#endif
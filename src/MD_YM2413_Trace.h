@@ -0,0 +1,128 @@
+#pragma once
+
+#include <Arduino.h>
+#include <MD_YM2413.h>
+
+/**
+ * \file
+ * \brief Header file for the MD_YM2413_Trace library trace buffer
+ */
+
+#if LIB_TRACE
+
+/**
+ * Trace buffer class for the MD_YM2413 library
+ *
+ * When LIB_TRACE is enabled the library logs fixed size binary records of
+ * what it is doing into a RAM ring buffer. Logging a record takes a few
+ * microseconds, so the library timing is close to that of a production
+ * build. The buffer is drained by the application when the timing does
+ * not matter, and the dump is decoded on the host.
+ * See \ref pageTrace for how this is used.
+ *
+ * All the methods are static, as there is one buffer for the library.
+ * The class is only available when LIB_TRACE is enabled.
+ */
+class MD_YM2413_Trace
+{
+  public:
+   /**
+    * Trace event identifiers.
+    *
+    * The chan and arg values for each event are shown in \ref pageTrace.
+    */
+    static const uint8_t EV_NOTE_ON_FREQ = 1;   ///< noteOn() by frequency, arg is the frequency
+    static const uint8_t EV_NOTE_ON = 2;        ///< noteOn() by note, arg is octave in the high byte, note in the low byte
+    static const uint8_t EV_FNUM = 3;           ///< note F-Num worked out by noteOn(), arg is block << 9 | F-Num
+    static const uint8_t EV_BEND = 4;           ///< bendNote(), arg is block << 9 | F-Num
+    static const uint8_t EV_NOTE_OFF = 5;       ///< noteOff(), arg is 0
+    static const uint8_t EV_WRITE = 6;          ///< register write sent, chan is the address and arg the data
+    static const uint8_t EV_SUSPEND = 7;        ///< suspend(), chan and arg are 0
+    static const uint8_t EV_RESUME = 8;         ///< resume(), chan and arg are 0
+    static const uint8_t EV_MIDI_NOTE = 9;      ///< MD_YM2413_MIDI note on, chan is the MIDI channel, arg is note << 8 | voice
+    static const uint8_t EV_MIDI_DROP = 10;     ///< MD_YM2413_MIDI note dropped, chan is the MIDI channel, arg is the note
+    static const uint8_t EV_USER = 0x80;        ///< first event identifier for application events
+
+   /**
+    * Trace record.
+    *
+    * One event in the trace buffer, 8 bytes.
+    */
+    struct record_t
+    {
+      uint32_t time;    ///< micros() time of the event
+      uint8_t event;    ///< event identifier EV_*
+      uint8_t chan;     ///< channel, or as defined for the event
+      uint16_t arg;     ///< event argument
+    };
+
+   /**
+    * Log a trace record.
+    *
+    * Add a record to the buffer. If the buffer is full the oldest record
+    * is overwritten and counted as lost. The library logs its own events,
+    * and the application can log events with identifiers from EV_USER to
+    * line them up with the library events.
+    *
+    * The buffer is not protected from interrupts, so this must only be
+    * used from the same context as the library (ie, not from interrupt
+    * handlers).
+    *
+    * \param event  the event identifier.
+    * \param chan   the channel, or as defined for the event.
+    * \param arg    the event argument.
+    */
+    static void log(uint8_t event, uint8_t chan, uint16_t arg);
+
+   /**
+    * Get the number of records in the buffer.
+    *
+    * \return the number of records not yet read.
+    */
+    static uint16_t available(void) { return(_count); }
+
+   /**
+    * Read the oldest record.
+    *
+    * Copy the oldest record and remove it from the buffer.
+    *
+    * \param r  the record to copy into.
+    * \return true if there was a record, false if the buffer is empty.
+    */
+    static bool read(record_t& r);
+
+   /**
+    * Get the lost record count.
+    *
+    * \return the number of records overwritten before they were read.
+    */
+    static uint16_t getLost(void) { return(_lost); }
+
+   /**
+    * Clear the buffer.
+    *
+    * Remove all the records and set the lost count to zero.
+    */
+    static void clear(void);
+
+   /**
+    * Dump the buffer.
+    *
+    * Read all the records in the buffer and print them as lines of hex
+    * text to a stream (eg, Serial), in the format read by the host decoder
+    * extras/YM2413_TraceDecode.py. This is slow and should only be used
+    * outside the timing being traced.
+    *
+    * \param out  the stream to print to.
+    */
+    static void dump(Print& out);
+
+  private:
+    static record_t _R[LIB_TRACE];  ///< ring buffer
+    static uint16_t _head;          ///< next record to write
+    static uint16_t _count;         ///< records in the buffer
+    static uint16_t _lost;          ///< records overwritten before they were read
+
+    static void printHex(Print& out, uint32_t v, uint8_t digits);
+};
+#endif
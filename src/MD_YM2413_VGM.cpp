@@ -0,0 +1,202 @@
+/*
+MD_YM2413 - Library for using a YM2413 sound generator
+
+See header file for copyright and licensing comments.
+*/
+#include <MD_YM2413_VGM.h>
+#include <MD_YM2413_lib.h>
+
+/**
+* \file
+* \brief Implements the VGM recorder methods
+*/
+
+void MD_YM2413_VGM::begin(uint32_t clockHz)
+{
+  _bufLen = 0;
+  _offset = 0;
+  _samples = _samplesWait = 0;
+  _timeFrac = 0;
+
+  // Header is written with the fixed values and the rest 
+  // as zeros. The sizes and sample counts are filled in by end().
+  putDword(0x206d6756);           // 0x00 "Vgm " ident
+  putDword(0);                    // 0x04 EOF offset
+  putDword(VGM_VERSION);          // 0x08 version
+  putDword(0);                    // 0x0c SN76489 clock
+  putDword(clockHz);              // 0x10 YM2413 clock
+  putDword(0);                    // 0x14 GD3 offset
+  putDword(0);                    // 0x18 total samples
+  while (getSize() < 0x34)        // 0x1c..0x33 loop, rate and other chips
+    put(0);
+  putDword(HEADER_SIZE - 0x34);   // 0x34 VGM data offset
+  while (getSize() < HEADER_SIZE) // 0x38.. other chips
+    put(0);
+
+  _timeLast = micros();
+  _recording = true;
+}
+
+void MD_YM2413_VGM::updateTime(void)
+// Convert the time since the last write into samples waiting to be 
+// written. 1e6 us/sec at 44100 samples/sec = 441/10000 samples per us.
+// The remainder is carried forward so the total time does not drift.
+{
+  uint32_t now = micros();
+  uint32_t elapsed = now - _timeLast;
+  uint32_t t;
+
+  _timeLast = now;
+  while (elapsed >= 1000000UL)   // whole seconds first to avoid overflow below
+  {
+    _samplesWait += SAMPLE_RATE;
+    elapsed -= 1000000UL;
+  }
+  t = (elapsed * (SAMPLE_RATE / 100)) + _timeFrac;
+  _samplesWait += t / 10000;
+  _timeFrac = t % 10000;
+}
+
+void MD_YM2413_VGM::flushWait(void)
+// Write out the waiting samples using the shortest wait commands
+{
+  while (_samplesWait != 0)
+  {
+    uint16_t n;
+
+    if (_samplesWait == 735)
+    {
+      n = 735;
+      put(CMD_WAIT_60);
+    }
+    else if (_samplesWait == 882)
+    {
+      n = 882;
+      put(CMD_WAIT_50);
+    }
+    else if (_samplesWait <= 16)
+    {
+      n = _samplesWait;
+      put(CMD_WAIT_N | (n - 1));
+    }
+    else
+    {
+      n = (_samplesWait > 0xffff ? 0xffff : _samplesWait);
+      put(CMD_WAIT);
+      put(n & 0xff);
+      put(n >> 8);
+    }
+    _samplesWait -= n;
+    _samples += n;
+  }
+}
+
+void MD_YM2413_VGM::write(uint8_t addr, uint8_t data)
+{
+  if (!_recording)
+    return;
+
+  updateTime();
+  flushWait();
+  put(CMD_YM2413);
+  put(addr);
+  put(data);
+}
+
+void MD_YM2413_VGM::end(const char* title, const char* author)
+{
+  uint32_t offsetGD3 = 0;
+
+  if (!_recording)
+    return;
+
+  updateTime();
+  flushWait();
+  put(CMD_END);
+
+  if (title != nullptr)
+  {
+    uint32_t offsetLen;
+
+    offsetGD3 = getSize();
+    putDword(0x20336447);     // "Gd3 " ident
+    putDword(0x100);          // version
+    putDword(0);              // data length, updated below
+    offsetLen = getSize();
+    putGD3String(title);      // track name
+    putGD3String(nullptr);    // track name (Japanese)
+    putGD3String(nullptr);    // game name
+    putGD3String(nullptr);    // game name (Japanese)
+    putGD3String("YM2413");   // system name
+    putGD3String(nullptr);    // system name (Japanese)
+    putGD3String(author);     // author
+    putGD3String(nullptr);    // author (Japanese)
+    putGD3String(nullptr);    // release date
+    putGD3String("MD_YM2413");// VGM converter
+    putGD3String(nullptr);    // notes
+    flush();
+    patchDword(offsetLen - 4, getSize() - offsetLen);
+  }
+  flush();
+
+  // now fix up the header, offsets are relative to the field
+  patchDword(0x04, getSize() - 0x04);
+  if (offsetGD3 != 0)
+    patchDword(0x14, offsetGD3 - 0x14);
+  patchDword(0x18, _samples);
+
+  _recording = false;
+}
+
+void MD_YM2413_VGM::put(uint8_t b)
+{
+  _buf[_bufLen++] = b;
+  if (_bufLen == BUF_SIZE)
+    flush();
+}
+
+void MD_YM2413_VGM::putDword(uint32_t v)
+// VGM values are written little endian
+{
+  for (uint8_t i = 0; i < 4; i++)
+  {
+    put(v & 0xff);
+    v >>= 8;
+  }
+}
+
+void MD_YM2413_VGM::putGD3String(const char* s)
+// GD3 strings are null terminated UTF-16 little endian
+{
+  if (s != nullptr)
+    while (*s != '\0')
+    {
+      put(*s++);
+      put(0);
+    }
+  put(0);
+  put(0);
+}
+
+void MD_YM2413_VGM::patchDword(uint32_t offset, uint32_t v)
+// Write a value directly at an earlier file offset
+{
+  uint8_t data[4];
+
+  for (uint8_t i = 0; i < ARRAY_SIZE(data); i++)
+  {
+    data[i] = v & 0xff;
+    v >>= 8;
+  }
+  _cbOutput(offset, data, ARRAY_SIZE(data));
+}
+
+void MD_YM2413_VGM::flush(void)
+{
+  if (_bufLen == 0)
+    return;
+
+  _cbOutput(_offset, _buf, _bufLen);
+  _offset += _bufLen;
+  _bufLen = 0;
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <Arduino.h>
+#include <MD_YM2413.h>
+
+/**
+ * \file
+ * \brief Header file for the MD_YM2413_VGM recorder
+ */
+
+/**
+ * VGM recorder class for the MD_YM2413 library
+ *
+ * Records the register writes made to a YM2413 as a VGM file.
+ * See \ref pageVGMCapture for how this is used.
+ */
+class MD_YM2413_VGM
+{
+  public:
+    static const uint16_t VGM_VERSION = 0x151;    ///< VGM version written in the file header
+    static const uint8_t HEADER_SIZE = 0x80;      ///< Size of the VGM header for the version
+    static const uint8_t BUF_SIZE = 32;           ///< Size of the output buffer in bytes
+
+   /**
+    * Output callback type.
+    *
+    * Prototype for the function invoked to write the VGM data to the output.
+    * The data must be written to the file at the specified offset, which
+    * is the end of the file except when the VGM header is updated by end().
+    *
+    * \param offset  the file offset for the data.
+    * \param data    pointer to the data bytes to write.
+    * \param len     number of data bytes to write.
+    */
+    typedef void (*cbOutput_t)(uint32_t offset, const uint8_t* data, uint16_t len);
+
+   /**
+    * Class Constructor.
+    *
+    * Instantiate a new instance of the class.
+    *
+    * \param cb  the callback function used to output the VGM data.
+    */
+    MD_YM2413_VGM(cbOutput_t cb) : _cbOutput(cb), _recording(false) {};
+
+   /**
+    * Class Destructor.
+    *
+    * Does the necessary to clean up once the object is no longer required.
+    */
+    ~MD_YM2413_VGM(void) {};
+
+   /**
+    * Start a new recording.
+    *
+    * Outputs the VGM file header and starts timing the register writes.
+    * The header is incomplete until end() is called.
+    *
+    * \sa end(), MD_YM2413::getClock()
+    *
+    * \param clockHz  the YM2413 master clock in Hz written to the header, 
+    *                 the clock the MD_YM2413 object is working with.
+    */
+    void begin(uint32_t clockHz = CLOCK_HZ);
+
+   /**
+    * Record a register write.
+    *
+    * Record the register write as a VGM command, preceded by the wait since
+    * the previous write. This method is normally called from the function
+    * set by the MD_YM2413::setWriteHook() method.
+    *
+    * \param addr  the 8 bit device address written.
+    * \param data  the 8 bit data value written.
+    */
+    void write(uint8_t addr, uint8_t data);
+
+   /**
+    * End the current recording.
+    *
+    * Output the end of data command and the optional GD3 tag, flush the
+    * buffered data and update the VGM header with the final values.
+    *
+    * \sa begin()
+    *
+    * \param title   the GD3 track name, nullptr for no GD3 tag.
+    * \param author  the GD3 author name, nullptr if not specified.
+    */
+    void end(const char* title = nullptr, const char* author = nullptr);
+
+   /**
+    * Return the recording state.
+    *
+    * \return true if a recording is in progress.
+    */
+    bool isRecording(void) { return(_recording); }
+
+   /**
+    * Return the recording length.
+    *
+    * \return the number of 44.1kHz samples in the recording so far.
+    */
+    uint32_t getSamples(void) { return(_samples + _samplesWait); }
+
+   /**
+    * Return the recording size.
+    *
+    * \return the current size of the VGM file in bytes.
+    */
+    uint32_t getSize(void) { return(_offset + _bufLen); }
+
+  private:
+    // VGM commands used by the recorder
+    static const uint8_t CMD_YM2413 = 0x51;     ///< YM2413 register write
+    static const uint8_t CMD_WAIT = 0x61;       ///< wait n samples
+    static const uint8_t CMD_WAIT_60 = 0x62;    ///< wait 735 samples
+    static const uint8_t CMD_WAIT_50 = 0x63;    ///< wait 882 samples
+    static const uint8_t CMD_END = 0x66;        ///< end of sound data
+    static const uint8_t CMD_WAIT_N = 0x70;     ///< wait n+1 samples (n is low nibble)
+
+    static const uint32_t SAMPLE_RATE = 44100;  ///< VGM sample rate
+
+    cbOutput_t _cbOutput;   ///< output callback function
+    bool _recording;        ///< true when recording is in progress
+
+    uint8_t _buf[BUF_SIZE]; ///< output buffer
+    uint8_t _bufLen;        ///< number of bytes in the output buffer
+    uint32_t _offset;       ///< file offset for the start of the buffer
+
+    uint32_t _timeLast;     ///< micros() time of the last write
+    uint16_t _timeFrac;     ///< fraction of a sample carried between writes (in 1/10000 samples)
+    uint32_t _samples;      ///< samples already written to the file
+    uint32_t _samplesWait;  ///< samples waiting to be written to the file
+
+    void updateTime(void);
+    void flushWait(void);
+    void put(uint8_t b);
+    void putDword(uint32_t v);
+    void putGD3String(const char* s);
+    void patchDword(uint32_t offset, uint32_t v);
+    void flush(void);
+};
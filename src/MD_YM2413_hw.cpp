@@ -11,55 +11,111 @@ See header file for copyright and licensing comments.
 * \brief Implements hardware related methods
 */
 
-// Global data tables
-// FNum lookup table for note play within a block (octave)
-// The data is organized by note number [0..11] corresponding to 
-// notes C, C# .. A, A#, B
-const uint16_t PROGMEM MD_YM2413::_fNumTable[] =
-{
-  // C,  C#,   D,  D#,   E,   F,  F#,   G,  G#,   A,  A#,   B
-   172, 183, 194, 205, 217, 230, 244, 258, 274, 290, 307, 326
-};
+// F-Num conversion
+// The YM2413 application manual formula is
+//   FNum = freq * (2^18/fsam) * 1/2^(block-1)
+// with fsam = (Clock Freq/72), which simplifies to
+//   FNum = freq * 72 * 2^(19-block) / Clock Freq
+// The division by the clock is replaced by a multiplication by its
+// reciprocal, scaled by 2^(FNUM_SHIFT+19) to keep the precision, so
+//   FNum = (freq * FNUM_RECIP(clock)) >> (block + FNUM_SHIFT)
+// FNUM_RECIP fits 16 bits for clocks above 1.2MHz.
+#define FNUM_SHIFT  11
+#define FNUM_RECIP(clk) ((uint16_t)((72UL << 24) / ((clk) >> 6)))
+
+// F-Num for a note frequency in 1/100 Hz in block 4 (the middle C octave)
+// rounded to the nearest integer.
+#define FNUM_NOTE(f, recip) ((uint16_t)(((((uint32_t)(f) * (recip)) >> (4 + FNUM_SHIFT)) + 50) / 100))
 
-// Define the upper boundary frequency for each block 0 through 7.
-// These boundaries are the Hz frequency for the first C of the 
-// next block. Anything above the highest boundary is taken to 
-// be one above the highest defined. 
-// 3 bits allowed for in the hardware --> blocks 1 through 7 only
-const uint16_t PROGMEM MD_YM2413::_blockTable[] =
+// Bus write pacing
+// After each write the device needs BUS_CYCLES_ADDR or BUS_CYCLES_DATA 
+// master clock cycles before the next write. The time of the last write 
+// is kept and only the part of the wait that has not already passed is
+// spent before the next write. The waits are rounded up to whole us and
+// the micros() resolution is added, as micros() may step just after the
+// write time is taken.
+#if defined(__AVR__)
+#define MICROS_RES  (64 / clockCyclesPerMicrosecond())  // micros() counts Timer0 prescaler steps
+#else
+#define MICROS_RES  1
+#endif
+#define BUS_WAIT(cycles, clk) ((uint8_t)(((((cycles) * 1000000UL) + (clk) - 1) / (clk)) + MICROS_RES))
+
+#if CLOCK_RUNTIME
+#define WAIT_ADDR _busWaitAddr
+#define WAIT_DATA _busWaitData
+#else
+#define WAIT_ADDR BUS_WAIT(BUS_CYCLES_ADDR, CLOCK_HZ)
+#define WAIT_DATA BUS_WAIT(BUS_CYCLES_DATA, CLOCK_HZ)
+#endif
+
+// Note frequencies for the middle C octave in 1/100 Hz
+#define HZ_C  26163
+#define HZ_CS 27718
+#define HZ_D  29366
+#define HZ_DS 31113
+#define HZ_E  32963
+#define HZ_F  34923
+#define HZ_FS 36999
+#define HZ_G  39200
+#define HZ_GS 41530
+#define HZ_A  44000
+#define HZ_AS 46616
+#define HZ_B  49388
+
+#if CLOCK_RUNTIME
+// Note frequency table used to build the F-Num table in RAM
+// when the clock is set at run time.
+const uint16_t PROGMEM MD_YM2413::_noteTable[] =
 {
-// 0,   1,   2,   3,   4,    5,    6,    7
-   0,  65, 130, 261, 523, 1046, 2093, 4186
+  HZ_C, HZ_CS, HZ_D, HZ_DS, HZ_E, HZ_F, HZ_FS, HZ_G, HZ_GS, HZ_A, HZ_AS, HZ_B
 };
 
-uint8_t MD_YM2413::calcBlock(uint16_t freq)
-// look up the block table to determine where this frequency sits
+void MD_YM2413::initClock(void)
+// Work out the F-Num table and bus waits for the current clock. 
+// The divisions happen once here and not when notes are played.
 {
-  uint8_t block = ARRAY_SIZE(_blockTable) - 1;
-
-  for (uint8_t i = 0; i < ARRAY_SIZE(_blockTable); i++)
-    if (freq < pgm_read_word(&_blockTable[i]))
-    {
-      block = i;
-      break;
-    }
-
-  //DEBUG("\nBlock: F", freq); DEBUG(" = ", block);
+  _fNumRecip = FNUM_RECIP(_clockHz);
+  for (uint8_t i = 0; i < NOTES_PER_OCTAVE; i++)
+    _fNumRAM[i] = FNUM_NOTE(pgm_read_word(&_noteTable[i]), _fNumRecip);
 
-  return(block);
+  _busWaitAddr = BUS_WAIT(BUS_CYCLES_ADDR, _clockHz);
+  _busWaitData = BUS_WAIT(BUS_CYCLES_DATA, _clockHz);
 }
+#else
+// FNum lookup table for note play within a block (octave), worked 
+// out by the compiler for CLOCK_HZ.
+// The data is organized by note number [0..11] corresponding to 
+// notes C, C# .. A, A#, B
+#define R FNUM_RECIP(CLOCK_HZ)
+const uint16_t PROGMEM MD_YM2413::_fNumTable[] =
+{
+  FNUM_NOTE(HZ_C, R),  FNUM_NOTE(HZ_CS, R), FNUM_NOTE(HZ_D, R),  FNUM_NOTE(HZ_DS, R),
+  FNUM_NOTE(HZ_E, R),  FNUM_NOTE(HZ_F, R),  FNUM_NOTE(HZ_FS, R), FNUM_NOTE(HZ_G, R),
+  FNUM_NOTE(HZ_GS, R), FNUM_NOTE(HZ_A, R),  FNUM_NOTE(HZ_AS, R), FNUM_NOTE(HZ_B, R)
+};
+#undef R
+#endif
 
-uint16_t MD_YM2413::calcFNum(uint16_t freq, uint8_t block)
-// FNum is calculated using the formula in the YM2413 application manual
-// FNum = freq * (2^18/fsam) * 1/2^(block-1))
-// and fsam = (Clock Freq/72)
-// and octave = block_data - 1
+uint16_t MD_YM2413::calcFNum(uint16_t freq, uint8_t& block)
+// Work out the block and F-Num for the frequency. The block is the 
+// lowest one where the F-Num fits in its 9 bits, as this gives the 
+// best frequency resolution. Anything above the highest block is 
+// played in the highest block.
 {
-  const uint32_t fsam = (CLOCK_HZ / 72UL);
-  uint32_t fn = freq * (1UL << (19-block)) / fsam;
+#if CLOCK_RUNTIME
+  uint32_t fn = ((uint32_t)freq * _fNumRecip) >> FNUM_SHIFT;   // F-Num for block 0
+#else
+  uint32_t fn = ((uint32_t)freq * FNUM_RECIP(CLOCK_HZ)) >> FNUM_SHIFT;   // F-Num for block 0
+#endif
 
-  //DEBUG("\nFNum: F", freq); DEBUG(" B", block);
-  //DEBUG(" = ", fn); DEBUGX(" (0x", fn); DEBUGS(")");
+  block = 0;
+  while (fn > FNUM_MAX && block < MAX_OCTAVE)
+  {
+    fn >>= 1;
+    block++;
+  }
+  if (fn > FNUM_MAX) fn = FNUM_MAX;
 
   return(fn);
 }
@@ -87,7 +143,7 @@ uint8_t MD_YM2413::buildReg0e(bool enable, instrument_t instr, uint8_t keyOn)
     // set the current state for this.
     // Note percussion channels are defined in the right order for this
     for (uint8_t i = 0; i < PERC_CHANNELS; i++)
-      if (_C[PERC_CHAN_BASE+i].state != IDLE)
+      if (C(PERC_CHAN_BASE+i).state != IDLE)
         b |= (1 << i);
 
     // now set the new state
@@ -95,11 +151,174 @@ uint8_t MD_YM2413::buildReg0e(bool enable, instrument_t instr, uint8_t keyOn)
     if (keyOn) b |= (1 << x);  // set it if required
   }
 
-  //DEBUGX(" Reg0e: 0x", b);
   return(b);
 }
 
+#if WRITE_BUDGET
+void MD_YM2413::setWriteBudget(uint8_t perMs)
+{
+  _wBudget = perMs;
+  _wTokens = perMs;
+  _wTime = millis();
+}
+
+void MD_YM2413::resetWriteStats(void)
+{
+  _wDeferred = 0;
+  _wMerged = 0;
+  _wForced = 0;
+  _wKeyLatencyMax = 0;
+}
+
+bool MD_YM2413::isPriority(uint8_t addr)
+// Key on/off and F-Num writes are sent before the others as 
+// they set when the notes are heard.
+{
+  return(addr == R_RHYTHM_CTL_REG || (addr >= R_FNUM_BASE_REG && addr < R_CHAN_CTL_BASE_REG));
+}
+
+bool MD_YM2413::isBarrier(uint8_t key, uint8_t i)
+// A key on must not overtake the queued writes that set how its note
+// sounds. These are the channel instrument and volume (0x30+ch) and the
+// custom instrument (0x00-0x07) for a channel playing it, or the 
+// percussion volumes (0x36-0x38) for a rhythm key on.
+// Return true if the queued write i is one of these for the write at key.
+{
+  uint8_t addr = _W[key].addr;
+  uint8_t a = _W[i].addr;
+  uint8_t ch = addr - R_INST_CTL_BASE_REG;
+
+  if (addr == R_RHYTHM_CTL_REG)
+    return((_W[key].data & ((1 << PERC_CHANNELS) - 1)) && a >= R_PERC_VOL_BD_REG && a <= R_PERC_VOL_TOMTCY_REG);
+
+  if (ch >= ALL_INSTR_CHANNELS || !(_W[key].data & (1 << R_INST_KEY_BIT)))
+    return(false);
+
+  // channels the library does not track could be using the custom instrument
+  return(a == R_CHAN_CTL_BASE_REG + ch || (a < 8 && (!isValid(ch) || C(ch).instrument == I_CUSTOM)));
+}
+
+void MD_YM2413::queueWrite(uint8_t addr, uint8_t data)
+// Add the write to the queue, replacing a lower priority write to 
+// the same register that has not been sent yet. A write a queued 
+// key on depends on is not replaced, as the key on needs the old value.
+{
+  if (!isPriority(addr))
+  {
+    for (uint8_t i = _wCount; i-- > 0; )
+      if (_W[i].addr == addr)
+      {
+        bool keyed = false;
+
+        for (uint8_t j = i + 1; j < _wCount && !keyed; j++)
+          keyed = isBarrier(j, i);
+
+        if (!keyed)
+        {
+          _W[i].data = data;
+          _wMerged++;
+          return;
+        }
+        break;
+      }
+  }
+
+  if (_wCount >= WRITE_QUEUE_SIZE)  // full, make space regardless of budget
+  {
+    writeNext();
+    _wForced++;
+  }
+
+  _W[_wCount].addr = addr;
+  _W[_wCount].data = data;
+  _W[_wCount].time = _wNow;
+  _wCount++;
+}
+
+void MD_YM2413::writeNext(void)
+// Send the oldest priority write, or the oldest write if there
+// are no priority writes, and remove it from the queue. Writes a
+// key on depends on are sent ahead of it.
+{
+  uint8_t n = 0;
+
+  for (uint8_t i = 0; i < _wCount; i++)
+    if (isPriority(_W[i].addr))
+    {
+      n = i;
+      break;
+    }
+
+  for (uint8_t i = 0; i < n; i++)
+    if (isBarrier(n, i))
+    {
+      n = i;
+      break;
+    }
+
+  // statistics
+  if (_W[n].time != _wNow)
+    _wDeferred++;
+  if ((_W[n].addr >= R_INST_CTL_BASE_REG && _W[n].addr < R_CHAN_CTL_BASE_REG && (_W[n].data & (1 << R_INST_KEY_BIT))) ||
+      (_W[n].addr == R_RHYTHM_CTL_REG && (_W[n].data & ((1 << PERC_CHANNELS) - 1))))
+  {
+    uint32_t latency = micros() - _W[n].time;
+
+    if (latency > _wKeyLatencyMax) _wKeyLatencyMax = latency;
+  }
+
+  busWrite(_W[n].addr, _W[n].data);
+
+  _wCount--;
+  for (uint8_t i = n; i < _wCount; i++)
+    _W[i] = _W[i + 1];
+}
+
+void MD_YM2413::flushWrites(void)
+// Send the queued writes allowed by the budget
+{
+  uint32_t now = millis();
+
+  if (_wBudget == 0)    // no budget
+  {
+    while (_wCount != 0)
+      writeNext();
+    return;
+  }
+
+  // top up the budget for the time passed, up to one ms worth
+  if (now != _wTime)
+  {
+    uint32_t t = _wTokens + ((now - _wTime) * _wBudget);
+
+    _wTokens = (t > _wBudget) ? _wBudget : t;
+    _wTime = now;
+  }
+
+  while (_wCount != 0 && _wTokens != 0)
+  {
+    writeNext();
+    _wTokens--;
+  }
+}
+
+void MD_YM2413::flush(void)
+{
+  _wNow = micros();
+  while (_wCount != 0)
+    writeNext();
+}
+
 void MD_YM2413::send(uint8_t addr, uint8_t data)
+// Queue the write and send what the budget allows
+{
+  _wNow = micros();
+  queueWrite(addr, data);
+  flushWrites();
+}
+#endif
+
+void MD_YM2413::busWrite(uint8_t addr, uint8_t data)
 {
   // From the datasheet
   //  /WE A0
@@ -107,33 +326,73 @@ void MD_YM2413::send(uint8_t addr, uint8_t data)
   //   0  0  = Write register address
   //   0  1  = Write register content 
 
-  //DEBUGS("\nsend");
+  // hold back the key ons while suspended
+  if (_suspended)
+  {
+    if (addr == R_RHYTHM_CTL_REG)
+      data &= ~((1 << PERC_CHANNELS) - 1);
+    else if ((uint8_t)(addr - R_INST_CTL_BASE_REG) < ALL_INSTR_CHANNELS)
+      data &= ~(1 << R_INST_KEY_BIT);
+  }
+
+#if LIB_STATS
+  uint32_t statTime = micros();
+  uint8_t g = writeGroup(addr);
+
+  if (g < STAT_GROUPS) _stats.writes[g]++;
+#endif
+
+  TRACE(EV_WRITE, addr, data);
+
+  if (_cbWrite != nullptr)
+    _cbWrite(addr, data);
+
+  if (_D == nullptr)    // software device
+  {
+    if (_cbDevice != nullptr)
+      _cbDevice(addr, data);
+    return;
+  }
+
+#if LIB_STATS
+  if (_lastAddress == addr) _stats.addrSaved++; else _stats.addrWrites++;
+#endif
 
   if (_lastAddress != addr)
   {
-    //DEBUGX(" A 0x", addr);
     // write register address
     digitalWrite(_a0, LOW);
     for (uint8_t i = 0; i < DATA_BITS; i++)
       digitalWrite(_D[i], (addr & (1 << i)) ? HIGH : LOW);
 
-    // Toggle !WE LOW then HIGH to latch it in the IC
-    // wait for 12 master clock cycles (@3.6Mhz ~ 4us)
+    // Toggle !WE LOW then HIGH to latch it in the IC once the 
+    // last write is done, then the IC needs 12 master clock cycles.
+    // On fast MCUs back to back digitalWrite() calls can be a few 
+    // ns apart, so /WE is held LOW for the write pulse width.
+    busWait();
     digitalWrite(_we, LOW);
-    delayMicroseconds(4);
+    delayMicroseconds(BUS_WE_PULSE_US);
     digitalWrite(_we, HIGH);
+    _busTime = micros();
+    _busWait = WAIT_ADDR;
 
     _lastAddress = addr;    // remember for next time
   }
 
-  //DEBUGX(" D 0x", data);
   digitalWrite(_a0, HIGH);
   for (uint8_t i = 0; i < DATA_BITS; i++)
     digitalWrite(_D[i], (data & (1 << i)) ? HIGH : LOW);
 
-  // Toggle !WE LOW then HIGH to latch it in the IC
-  // wait for 84 master clock cycles (@3.6Mhz ~ 25us)
+  // Toggle !WE LOW then HIGH to latch it in the IC once the
+  // address is done, then the IC needs 84 master clock cycles
+  busWait();
   digitalWrite(_we, LOW);
-  delayMicroseconds(25);
+  delayMicroseconds(BUS_WE_PULSE_US);
   digitalWrite(_we, HIGH);
+  _busTime = micros();
+  _busWait = WAIT_DATA;
+
+#if LIB_STATS
+  _stats.busTime += _busTime - statTime;
+#endif
 }
@@ -7,22 +7,20 @@
  * \brief Library only definitions for the MD_YM2413 library
  */
 
-#ifndef LIBDEBUG
-#define LIBDEBUG 0    ///< Control debugging output. See \ref pageCompileSwitch
+#if LIB_TRACE
+#include <MD_YM2413_Trace.h>
+#define TRACE(e, c, a) MD_YM2413_Trace::log(MD_YM2413_Trace::e, c, a)   ///< log a trace record. See \ref pageTrace
+#else
+#define TRACE(e, c, a)
 #endif
 
-#if LIBDEBUG
-#define DEBUGS(s) { Serial.print(F(s)); }
-#define DEBUGX(s, v) { Serial.print(F(s)); Serial.print(v, HEX); }
-#define DEBUG(s, v) { Serial.print(F(s)); Serial.print(v); }
+#if LIB_STATS
+#define STAT_CALL(m) statCall_t _statCall(*this, m)   ///< count and time this method call
 #else
-#define DEBUGS(s)
-#define DEBUGX(s, v)
-#define DEBUG(s, v)
+#define STAT_CALL(m)
 #endif
 
 // Miscellaneous defines
 #define VOL(v) (15-v)           ///< internal volume [0..15] mapped to hardware attenuation [15..0]
 #define DATA_BITS 8             ///< Number of bits in the byte (for loops)
-#define CLOCK_HZ  3579545UL     ///< Nominal 3.6MHz clock (3.579545MHz)
 
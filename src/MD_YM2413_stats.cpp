@@ -0,0 +1,123 @@
+/*
+MD_YM2413 - Library for using a YM2413 sound generator
+
+See header file for copyright and licensing comments.
+*/
+#include <MD_YM2413.h>
+#include <MD_YM2413_lib.h>
+
+/**
+* \file
+* \brief Implements the optional library statistics
+*/
+
+#if LIB_STATS
+MD_YM2413::statCall_t::statCall_t(MD_YM2413& _s, uint8_t m) : s(_s), method(m)
+{
+  s._statsDepth++;
+  start = micros();
+}
+
+MD_YM2413::statCall_t::~statCall_t(void)
+// Only the outermost call is counted, so library methods that use
+// other library methods are counted once, for the application call.
+{
+  if (--s._statsDepth == 0)
+  {
+    uint32_t t = micros() - start;
+
+    s._stats.calls[method]++;
+    s._stats.callTime[method] += t;
+    if (t > s._stats.callMax[method])
+      s._stats.callMax[method] = t;
+  }
+}
+
+void MD_YM2413::getStats(stats_t& s)
+{
+  s = _stats;
+  s.time = millis() - _statsStart;
+}
+
+void MD_YM2413::resetStats(void)
+{
+  memset(&_stats, 0, sizeof(_stats));
+  _statsStart = millis();
+}
+
+void MD_YM2413::printStats(Print& out)
+{
+  stats_t s;
+  uint32_t total = 0;
+
+  getStats(s);    // copy first so the printing is not counted
+
+  out.print(F("\nStats over "));
+  out.print(s.time);
+  out.print(F(" ms"));
+
+  out.print(F("\nMethod\t\tcalls\tavg us\tmax us"));
+  for (uint8_t i = 0; i < STAT_METHODS; i++)
+  {
+    if (s.calls[i] == 0)
+      continue;
+
+    out.print(F("\n"));
+    switch (i)
+    {
+      case STAT_NOTE_ON:    out.print(F("noteOn\t"));        break;
+      case STAT_NOTE_OFF:   out.print(F("noteOff\t"));       break;
+      case STAT_BEND:       out.print(F("bendNote"));        break;
+      case STAT_INSTRUMENT: out.print(F("setInstrument"));   break;
+      case STAT_VOLUME:     out.print(F("setVolume"));       break;
+      case STAT_LOAD:       out.print(F("loadInstrument"));  break;
+      case STAT_PERCUSSION: out.print(F("setPercussion"));   break;
+      case STAT_WRITE:      out.print(F("write\t"));         break;
+      case STAT_RUN:        out.print(F("run\t"));           break;
+      case STAT_SUSPEND:    out.print(F("suspend\t"));       break;
+    }
+    out.print(F("\t"));
+    out.print(s.calls[i]);
+    out.print(F("\t"));
+    out.print(s.callTime[i] / s.calls[i]);
+    out.print(F("\t"));
+    out.print(s.callMax[i]);
+  }
+
+  out.print(F("\nWrites patch "));
+  out.print(s.writes[WG_PATCH]);
+  out.print(F(", volume "));
+  out.print(s.writes[WG_VOLUME]);
+  out.print(F(", F-Num "));
+  out.print(s.writes[WG_FNUM]);
+  out.print(F(", key "));
+  out.print(s.writes[WG_KEY]);
+  out.print(F(", rhythm "));
+  out.print(s.writes[WG_RHYTHM]);
+  for (uint8_t i = 0; i < STAT_GROUPS; i++)
+    total += s.writes[i];
+  out.print(F("\nWrites/s "));
+  out.print(s.time == 0 ? 0 : (uint32_t)(((uint64_t)total * 1000) / s.time));
+
+  out.print(F("\nAddress writes "));
+  out.print(s.addrWrites);
+  out.print(F(", saved "));
+  out.print(s.addrSaved);
+  out.print(F("\nBus us "));
+  out.print(s.busTime);
+
+#if WRITE_BUDGET
+  out.print(F("\nDeferred "));
+  out.print(getDeferred());
+  out.print(F(", merged "));
+  out.print(getMerged());
+  out.print(F(", forced "));
+  out.print(getForced());
+  out.print(F(", key latency max us "));
+  out.print(getKeyLatencyMax());
+#endif
+
+  out.print(F("\nNotes dropped "));
+  out.print(s.noteDrops);
+}
+#endif